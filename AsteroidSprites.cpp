@@ -0,0 +1,137 @@
+#include "AsteroidSprites.h"
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+static const float TWO_PI = 6.2831853f;
+static const int RADIUS_COUNT = ASTEROID_SPRITE_MAX_RADIUS - ASTEROID_SPRITE_MIN_RADIUS + 1;
+
+// Vertex distances from the center, as a fraction of the radius
+static float outlineRadius[ASTEROID_SHAPES][ASTEROID_OUTLINE_POINTS];
+
+static std::vector<SpanSprite> sprites; // by shape, then radius, then rotation
+static std::vector<SpriteSpan> spans;
+static bool built = false;
+
+static int sprite_index(int shape, int radius, int rotation) {
+    return (shape * RADIUS_COUNT + radius - ASTEROID_SPRITE_MIN_RADIUS) * ASTEROID_ROTATIONS + rotation;
+}
+
+// The same outlines every run, whatever the game's seed
+static void generate_outlines() {
+    uint32_t state = 0x2545F491u;
+    for (int s = 0; s < ASTEROID_SHAPES; s++) {
+        float largest = 0;
+        for (int k = 0; k < ASTEROID_OUTLINE_POINTS; k++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            float unit = (float)(state >> 8) * (1.0f / 16777216.0f);
+            outlineRadius[s][k] = ASTEROID_INNER_RADIUS + (1.0f - ASTEROID_INNER_RADIUS) * unit;
+            largest = std::max(largest, outlineRadius[s][k]);
+        }
+        // stretch the outline so its outermost vertex is on the radius
+        for (int k = 0; k < ASTEROID_OUTLINE_POINTS; k++) {
+            outlineRadius[s][k] /= largest;
+        }
+    }
+}
+
+void asteroid_outline(int shape, float radius, float angle, float* x, float* y) {
+    for (int k = 0; k < ASTEROID_OUTLINE_POINTS; k++) {
+        float a = angle + TWO_PI * k / ASTEROID_OUTLINE_POINTS;
+        float r = radius * outlineRadius[shape][k];
+        x[k] = cosf(a) * r;
+        y[k] = sinf(a) * r;
+    }
+}
+
+// Appends the spans of the outline, one per row from its top row to its
+// bottom one. Like the circles, pixels are sampled at their integer
+// coordinates, relative to the center.
+static void rasterize_outline(const float* x, const float* y, int radius, SpanSprite& sprite) {
+    sprite.x0 = sprite.y0 = radius + 1;
+    sprite.x1 = sprite.y1 = -radius - 1;
+
+    size_t rowsStart = spans.size();
+    for (int py = -radius; py <= radius; py++) {
+        // where the row crosses the outline's edges; the outline is star
+        // shaped around the center, so rows cross it a few times at most
+        float left = 1e30f, right = -1e30f;
+        for (int k = 0; k < ASTEROID_OUTLINE_POINTS; k++) {
+            int next = (k + 1) % ASTEROID_OUTLINE_POINTS;
+            float ay = y[k], by = y[next];
+            if (!((ay <= py && py < by) || (by <= py && py < ay))) continue;
+
+            float crossing = x[k] + (py - ay) * (x[next] - x[k]) / (by - ay);
+            left = std::min(left, crossing);
+            right = std::max(right, crossing);
+        }
+
+        // the outermost crossings bound the row's one run; a row that dips
+        // into a notch has the gap filled, which the shallow notches (see
+        // ASTEROID_INNER_RADIUS) keep to the odd pixel
+        SpriteSpan run = { 0, 0 };
+        if (left <= right) {
+            int x0 = (int)ceilf(left), x1 = (int)floorf(right);
+            if (x0 <= x1) {
+                run.x = (int8_t)x0;
+                run.length = (uint8_t)(x1 - x0 + 1);
+                sprite.x0 = std::min(sprite.x0, x0);
+                sprite.x1 = std::max(sprite.x1, x1 + 1);
+                sprite.y0 = std::min(sprite.y0, py);
+                sprite.y1 = std::max(sprite.y1, py + 1);
+            }
+        }
+        spans.push_back(run);
+    }
+
+    // keep the rows from the first filled one to the last
+    if (sprite.y0 > sprite.y1) sprite.x0 = sprite.x1 = sprite.y0 = sprite.y1 = 0;
+    size_t first = rowsStart + (sprite.y0 + radius);
+    spans.erase(spans.begin() + first + (sprite.y1 - sprite.y0), spans.end());
+    spans.erase(spans.begin() + rowsStart, spans.begin() + first);
+}
+
+void asteroid_sprites_build() {
+    if (built) return;
+    generate_outlines();
+
+    sprites.assign(ASTEROID_SHAPES * RADIUS_COUNT * ASTEROID_ROTATIONS, SpanSprite());
+    std::vector<size_t> firstSpan(sprites.size());
+    float x[ASTEROID_OUTLINE_POINTS], y[ASTEROID_OUTLINE_POINTS];
+    for (int s = 0; s < ASTEROID_SHAPES; s++) {
+        for (int r = ASTEROID_SPRITE_MIN_RADIUS; r <= ASTEROID_SPRITE_MAX_RADIUS; r++) {
+            for (int a = 0; a < ASTEROID_ROTATIONS; a++) {
+                int i = sprite_index(s, r, a);
+                asteroid_outline(s, (float)r, TWO_PI * a / ASTEROID_ROTATIONS, x, y);
+                firstSpan[i] = spans.size();
+                rasterize_outline(x, y, r, sprites[i]);
+            }
+        }
+    }
+
+    // spans stopped moving, so the sprites can point into them now
+    spans.shrink_to_fit();
+    for (size_t i = 0; i < sprites.size(); i++) {
+        sprites[i].spans = spans.data() + firstSpan[i];
+    }
+    built = true;
+}
+
+const SpanSprite* asteroid_sprite(int shape, float radius, float angle) {
+    int r = (int)lroundf(radius);
+    if (!built || r < ASTEROID_SPRITE_MIN_RADIUS || r > ASTEROID_SPRITE_MAX_RADIUS) return nullptr;
+
+    int rotation = (int)lroundf(angle * (ASTEROID_ROTATIONS / TWO_PI));
+    rotation &= ASTEROID_ROTATIONS - 1; // also wraps negative angles; the count is a power of two
+    return &sprites[sprite_index(shape % ASTEROID_SHAPES, r, rotation)];
+}
+
+AsteroidSpriteStats asteroid_sprite_stats() {
+    AsteroidSpriteStats stats;
+    stats.sprites = (int)sprites.size();
+    stats.spans = (int)spans.size();
+    stats.bytes = sprites.size() * sizeof(SpanSprite) + spans.size() * sizeof(SpriteSpan);
+    return stats;
+}
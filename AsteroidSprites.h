@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Raster.h"
+#include <stddef.h>
+
+//
+//  Jagged, spinning asteroids drawn from pre-rasterized sprites.
+//
+//  Every asteroid has one of ASTEROID_SHAPES outlines, generated once from
+//  a fixed seed. asteroid_sprites_build() rasterizes each outline at every
+//  whole radius from ASTEROID_SPRITE_MIN_RADIUS to ASTEROID_SPRITE_MAX_RADIUS,
+//  the sizes spawning (15 to 29) and two rounds of splitting (0.6 times,
+//  down to 9.36) produce once rounded, at ASTEROID_ROTATIONS angles into
+//  one run-length encoded span per row (see SpanSprite in Raster.h).
+//  Drawing an asteroid fills the spans of its nearest sprite. Filling the
+//  pixels is most of the cost, so a sprite costs about what a circle of
+//  the same radius does, and the outline is never rasterized during a
+//  frame.
+//
+//  Outline vertices lie between ASTEROID_INNER_RADIUS and 1 times the
+//  radius, with one of them at exactly 1, so an asteroid's collision circle
+//  is the tightest circle around its outline. The inner radius keeps every
+//  edge, not only every vertex, at least 0.85 times the radius out (an edge
+//  between two vertices at r dips to r * cos(pi / 11)), so the circle
+//  collisions use never reaches more than 15% into an empty notch.
+//
+
+const int ASTEROID_SHAPES = 4;
+const int ASTEROID_OUTLINE_POINTS = 11;
+const float ASTEROID_INNER_RADIUS = 0.89f;
+const int ASTEROID_ROTATIONS = 64;
+const int ASTEROID_SPRITE_MIN_RADIUS = 9;
+const int ASTEROID_SPRITE_MAX_RADIUS = 29;
+
+// Builds the cache; later calls do nothing
+void asteroid_sprites_build();
+
+// The sprite nearest an outline at that radius and angle (radians); null
+// if the radius is outside the cache or the cache is not built
+const SpanSprite* asteroid_sprite(int shape, float radius, float angle);
+
+// Vertices of an outline at that radius and angle, relative to its center;
+// x and y hold ASTEROID_OUTLINE_POINTS each
+void asteroid_outline(int shape, float radius, float angle, float* x, float* y);
+
+struct AsteroidSpriteStats {
+    int sprites;
+    int spans;
+    size_t bytes; // sprites and spans together
+};
+
+AsteroidSpriteStats asteroid_sprite_stats();
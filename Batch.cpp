@@ -0,0 +1,31 @@
+#include "Batch.h"
+#include "Profile.h"
+
+struct BatchJob {
+    std::vector<World>* worlds;
+    const BatchConfig* config;
+};
+
+static void step_one_world(int index, void* context) {
+    const BatchJob& job = *(const BatchJob*)context;
+    const BatchConfig& config = *job.config;
+    World& world = (*job.worlds)[index];
+
+    for (uint64_t step = 0; step < config.steps; step++) {
+        uint64_t at = config.firstStep + step;
+        uint8_t input = config.input ? config.input(index, at, world, config.inputContext) : 0;
+        step_world(world, config.dt, input);
+    }
+}
+
+BatchStats run_batch(JobPool& pool, std::vector<World>& worlds, const BatchConfig& config) {
+    BatchJob job = { &worlds, &config };
+
+    uint64_t start = profile_now_ns();
+    pool.parallel_for((int)worlds.size(), step_one_world, &job);
+
+    BatchStats stats;
+    stats.worldSteps = (uint64_t)worlds.size() * config.steps;
+    stats.wallSeconds = (profile_now_ns() - start) / 1e9;
+    return stats;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Game.h"
+#include "JobPool.h"
+#include <stdint.h>
+#include <vector>
+
+//
+//  Batched simulation of many independent worlds, for offline tooling
+//  (balance testing, bot training). Worlds are stepped without drawing,
+//  spread over a JobPool; a world is only ever stepped by one thread at a
+//  time, and worlds share nothing, so results do not depend on the thread
+//  count.
+//
+
+// Input bits for one step of one world, called on the thread stepping it
+typedef uint8_t (*BatchInput)(int worldIndex, uint64_t step, const World& world, void* context);
+
+struct BatchConfig {
+    float dt;            // frame time of every step
+    uint64_t firstStep;  // step index passed to input for the first step
+    uint64_t steps;      // steps per world
+    BatchInput input;    // null: no keys held
+    void* inputContext;
+
+    BatchConfig() : dt(1.0f / 60.0f), firstStep(0), steps(1), input(nullptr), inputContext(nullptr) {}
+};
+
+struct BatchStats {
+    uint64_t worldSteps;
+    double wallSeconds;
+};
+
+// Advances every world by config.steps calls of step_world()
+BatchStats run_batch(JobPool& pool, std::vector<World>& worlds, const BatchConfig& config);
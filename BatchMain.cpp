@@ -0,0 +1,210 @@
+//
+//  Batch runner: steps many independent worlds in parallel and reports
+//  throughput in world-steps per second.
+//
+//  Every world is seeded with seed + its index and driven by either a
+//  scripted input timeline (the same for every world, in the headless
+//  script format) or a built-in bot. With a list of thread counts the same
+//  batch is run once per count, from the same start, and the combined state
+//  hash shows that the result does not depend on the thread count.
+//
+
+#include "Engine.h"
+#include "Batch.h"
+#include "Game.h"
+#include "Headless.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Key state per step, resolved from a script the way run_headless() does:
+// an event applies from the first frame starting at or after its time
+static std::vector<uint8_t> script_input(const InputScript& script, float dt, uint64_t steps) {
+    struct KeyChange {
+        uint64_t frame;
+        bool down;
+        uint8_t bit;
+    };
+    std::vector<KeyChange> changes;
+    for (const InputEvent& e : script.events) {
+        if (e.type != InputEvent::KEY_DOWN && e.type != InputEvent::KEY_UP) continue;
+        uint64_t frame = e.frame >= 0 ? (uint64_t)e.frame : (uint64_t)ceil(e.time / dt - 1e-6);
+        changes.push_back({ frame, e.type == InputEvent::KEY_DOWN, input_bit(e.code) });
+    }
+    std::stable_sort(changes.begin(), changes.end(),
+                     [](const KeyChange& a, const KeyChange& b) { return a.frame < b.frame; });
+
+    std::vector<uint8_t> input(steps, 0);
+    uint8_t keys = 0;
+    size_t next = 0;
+    for (uint64_t step = 0; step < steps; step++) {
+        for (; next < changes.size() && changes[next].frame <= step; next++) {
+            if (changes[next].down) keys |= changes[next].bit;
+            else keys &= ~changes[next].bit;
+        }
+        input[step] = keys;
+    }
+    return input;
+}
+
+static uint8_t scripted(int, uint64_t step, const World&, void* context) {
+    const std::vector<uint8_t>& input = *(const std::vector<uint8_t>*)context;
+    return input[step];
+}
+
+// Turns towards the nearest asteroid and fires when roughly facing it;
+// restarts finished games
+static uint8_t bot(int, uint64_t, const World& world, void*) {
+    if (world.gameOver || world.gameWon) return INPUT_RETURN;
+    if (!world.ships[0].alive || world.asteroids.count() == 0) return 0;
+
+    const Ship& ship = world.ships[0];
+    int nearest = 0;
+    float nearestDistance = 1e30f;
+    for (int i = 0; i < world.asteroids.count(); i++) {
+        float dx = world.asteroids.x[i] - ship.position.x;
+        float dy = world.asteroids.y[i] - ship.position.y;
+        float distance = dx * dx + dy * dy;
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = i;
+        }
+    }
+
+    float target = atan2f(world.asteroids.y[nearest] - ship.position.y, world.asteroids.x[nearest] - ship.position.x);
+    float turn = remainderf(target - ship.angle, 6.2831853f);
+
+    uint8_t input = 0;
+    if (turn < -0.05f) input |= INPUT_LEFT;
+    if (turn > 0.05f) input |= INPUT_RIGHT;
+    if (fabsf(turn) < 0.2f) input |= INPUT_SPACE;
+    if (nearestDistance > 300.0f * 300.0f) input |= INPUT_UP;
+    return input;
+}
+
+static void reset_worlds(std::vector<World>& worlds, uint32_t seed) {
+    for (size_t i = 0; i < worlds.size(); i++) {
+        worlds[i].seed = seed + (uint32_t)i;
+        reset_world(worlds[i]);
+    }
+}
+
+static uint32_t combined_hash(const std::vector<World>& worlds) {
+    uint32_t hash = 2166136261u;
+    for (const World& world : worlds) {
+        hash = (hash ^ hash_world(world)) * 16777619u;
+    }
+    return hash;
+}
+
+static void print_usage() {
+    fprintf(stderr,
+        "usage: asteroids_batch [options]\n"
+        "  --worlds N        worlds in the batch (default 1000)\n"
+        "  --steps N         steps per world (default 600)\n"
+        "  --dt SECONDS      frame time of a step (default 0.016667)\n"
+        "  --threads A,B,... thread counts to run the batch with (default: all cores)\n"
+        "  --seed N          seed of world 0, world i gets N + i (default 1)\n"
+        "  --script FILE     drive every world from a script instead of the bot\n"
+        "  --idle            no input at all\n");
+}
+
+int main(int argc, char** argv) {
+    int worldCount = 1000;
+    uint64_t steps = 600;
+    float dt = 1.0f / 60.0f;
+    uint32_t seed = 1;
+    std::vector<int> threadCounts;
+    InputScript script;
+    bool useScript = false, idle = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--worlds") == 0 && value) {
+            worldCount = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--steps") == 0 && value) {
+            steps = strtoull(value, nullptr, 10);
+            i++;
+        } else if (strcmp(arg, "--dt") == 0 && value) {
+            dt = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--threads") == 0 && value) {
+            for (const char* p = value; *p; ) {
+                threadCounts.push_back(atoi(p));
+                p = strchr(p, ',');
+                if (!p) break;
+                p++;
+            }
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            seed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else if (strcmp(arg, "--script") == 0 && value) {
+            std::string error;
+            if (!script.load(value, &error)) {
+                fprintf(stderr, "%s: %s\n", value, error.c_str());
+                return 1;
+            }
+            useScript = true;
+            i++;
+        } else if (strcmp(arg, "--idle") == 0) {
+            idle = true;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (worldCount <= 0 || steps == 0 || dt <= 0.0f) {
+        print_usage();
+        return 1;
+    }
+    if (threadCounts.empty()) {
+        threadCounts.push_back(std::max(1, (int)std::thread::hardware_concurrency()));
+    }
+
+    BatchConfig config;
+    config.dt = dt;
+    config.steps = steps;
+    std::vector<uint8_t> scriptedInput;
+    if (useScript) {
+        scriptedInput = script_input(script, dt, steps);
+        config.input = scripted;
+        config.inputContext = &scriptedInput;
+    } else if (!idle) {
+        config.input = bot;
+    }
+
+    std::vector<World> worlds(worldCount);
+    JobPool pool;
+    double baseline = 0;
+
+    for (int threads : threadCounts) {
+        reset_worlds(worlds, seed);
+        pool.resize(threads);
+
+        BatchStats stats = run_batch(pool, worlds, config);
+        double rate = stats.wallSeconds > 0 ? stats.worldSteps / stats.wallSeconds : 0;
+        if (baseline == 0) baseline = rate;
+
+        long long totalScore = 0;
+        for (const World& world : worlds) totalScore += world.score;
+
+        printf("threads=%d worlds=%d steps=%llu world_steps=%llu wall_seconds=%.3f "
+               "world_steps_per_second=%.0f speedup=%.2f mean_score=%.1f state_hash=%08x\n",
+               threads, worldCount, (unsigned long long)steps, (unsigned long long)stats.worldSteps,
+               stats.wallSeconds, rate, baseline > 0 ? rate / baseline : 0.0,
+               (double)totalScore / worldCount, combined_hash(worlds));
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,618 @@
+//
+//  Frame-time benchmark for act() and draw().
+//
+//  Seeds the game with N asteroids and N/10 bullets for every scenario size,
+//  runs a fixed number of frames with a fixed dt and prints per-phase
+//  p50/p99/max timings as CSV (or JSON lines with --json).
+//  Every frame starts from the same seeded state, so each sample measures
+//  the same workload. Every row names its unit: timings are in "us" unless
+//  the row says "ns", and the "allocations" row is a "count" of heap
+//  allocations per frame.
+//
+//  --replay FILE plays a recorded session instead (see Replay.h) and times
+//  every frame of it; the run fails if the game no longer reproduces the
+//  session's state hashes, since the timings would not be comparable.
+//
+//  --kernels N times the integrate-and-wrap kernel alone on N objects at
+//  every SIMD level the CPU supports and checks that all levels agree; the
+//  same for the blend kernels on a full-screen layer, next to a memcpy.
+//
+//  --particles N times the update and the drawing of N live particles.
+//
+//  --sprites N draws N asteroids from the sprite cache, and the same ones as
+//  circles and as outline polygons rasterized per frame, and prints the
+//  cost per asteroid in nanoseconds and the cache's size in bytes.
+//
+//  --lookahead N clones a game in progress into N futures per frame and
+//  simulates each LOOKAHEAD_TICKS ticks ahead (see WorldState.h), after
+//  checking that a restored state steps exactly like the world it was saved
+//  from. It prints the cost of a state save, restore and copy and of a
+//  lookahead tick in nanoseconds, what they come to per second, and the
+//  state's size in bytes.
+//
+//  Build with -DASTEROIDS_PROFILE, otherwise the phase timers are empty.
+//
+
+#include "Engine.h"
+#include "Game.h"
+#include "Headless.h"
+#include "Profile.h"
+#include "Render.h"
+#include "Replay.h"
+#include "Simd.h"
+#include "WorldState.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+struct Scenario {
+    int asteroidCount;
+    int bulletCount;
+};
+
+struct PhaseSamples {
+    std::vector<uint64_t> ns[PHASE_COUNT];
+    std::vector<uint64_t> actNs;
+    std::vector<uint64_t> drawNs;
+    std::vector<uint64_t> allocations;
+};
+
+static void seed_world(const Scenario& scenario, uint32_t seed,
+                       AsteroidArray& seededAsteroids, BulletArray& seededBullets) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> px(0.0f, (float)SCREEN_WIDTH);
+    std::uniform_real_distribution<float> py(0.0f, (float)SCREEN_HEIGHT);
+    std::uniform_real_distribution<float> speed(-33.0f, 33.0f);
+    std::uniform_real_distribution<float> direction(0.0f, 6.2831853f);
+    std::uniform_int_distribution<int> size(15, 29);
+
+    // room for the splits of one bullet hit each, and for the ship's shots
+    seededAsteroids.clear();
+    seededAsteroids.reserve(scenario.asteroidCount + 2 * scenario.bulletCount);
+    for (int i = 0; i < scenario.asteroidCount; i++) {
+        Vector2 position(px(rng), py(rng));
+        Vector2 velocity(speed(rng), speed(rng));
+        seededAsteroids.add(position, velocity, (float)size(rng));
+    }
+
+    seededBullets.clear();
+    seededBullets.reserve(scenario.bulletCount + MAX_BULLETS);
+    for (int i = 0; i < scenario.bulletCount; i++) {
+        float angle = direction(rng);
+        Vector2 position(px(rng), py(rng));
+        seededBullets.add(position, Vector2(cosf(angle), sinf(angle)) * BULLET_SPEED, 3.0f);
+    }
+}
+
+static void restore_world(const AsteroidArray& seededAsteroids, const BulletArray& seededBullets) {
+    World& world = gameWorld;
+    world.shipCount = 1;
+    world.ships[0] = Ship();
+    world.asteroids = seededAsteroids;
+    world.bullets = seededBullets;
+    world.playerLives = 3;
+    world.score = 0;
+    world.gameOver = false;
+    world.gameWon = false;
+    world.tickAccumulator = 0;
+}
+
+static uint64_t percentile(std::vector<uint64_t>& values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+// Samples are nanoseconds, reported in microseconds, unless unit says otherwise
+// Samples are nanoseconds and printed as microseconds when unit is "us";
+// other units (counts, bytes, rates) are printed as they are
+static void report(const char* format, const Scenario& scenario, const char* phase, int frames,
+                   std::vector<uint64_t>& samples, const char* unit = "us") {
+    double scale = strcmp(unit, "us") == 0 ? 1000.0 : 1.0;
+    double p50 = percentile(samples, 0.50) / scale;
+    double p99 = percentile(samples, 0.99) / scale;
+    double max = samples.empty() ? 0.0 : samples.back() / scale;
+
+    if (strcmp(format, "json") == 0) {
+        printf("{\"asteroids\":%d,\"bullets\":%d,\"phase\":\"%s\",\"frames\":%d,\"unit\":\"%s\","
+               "\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}\n",
+               scenario.asteroidCount, scenario.bulletCount, phase, frames, unit, p50, p99, max);
+    } else {
+        printf("%d,%d,%s,%d,%s,%.3f,%.3f,%.3f\n",
+               scenario.asteroidCount, scenario.bulletCount, phase, frames, unit, p50, p99, max);
+    }
+}
+
+static void run_scenario(const Scenario& scenario, int frames, float dt, uint32_t seed, const char* format) {
+    AsteroidArray seededAsteroids;
+    BulletArray seededBullets;
+    seed_world(scenario, seed, seededAsteroids, seededBullets);
+
+    // restoring the world then copies into storage that is large enough
+    gameWorld.asteroids.reserve(seededAsteroids.capacity());
+    gameWorld.bullets.reserve(seededBullets.capacity());
+    world_systems(); // built on first use, outside the timed frames
+
+    PhaseSamples samples;
+    for (int frame = 0; frame < frames; frame++) {
+        restore_world(seededAsteroids, seededBullets);
+        gameWorld.random.seed(seed + (uint32_t)frame);
+        profile_reset_phases();
+
+        uint64_t allocationsBefore = profile_allocation_count();
+        uint64_t t0 = profile_now_ns();
+        act(dt);
+        uint64_t t1 = profile_now_ns();
+        draw();
+        uint64_t t2 = profile_now_ns();
+        samples.allocations.push_back(profile_allocation_count() - allocationsBefore);
+
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            samples.ns[phase].push_back(profilePhaseNs[phase]);
+        samples.actNs.push_back(t1 - t0);
+        samples.drawNs.push_back(t2 - t1);
+    }
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        report(format, scenario, profile_phase_name(phase), frames, samples.ns[phase]);
+    report(format, scenario, "act", frames, samples.actNs);
+    report(format, scenario, "draw", frames, samples.drawNs);
+    report(format, scenario, "allocations", frames, samples.allocations, "count");
+}
+
+// Times a recorded session frame by frame. The scenario columns report the
+// largest asteroid and bullet counts seen. Returns false if the replay
+// diverged from the recording.
+static bool run_replay(const char* path, const char* format) {
+    std::string error;
+    if (!replay_begin_playback(path, &error)) {
+        fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return false;
+    }
+    initialize();
+
+    PhaseSamples samples;
+    Scenario peak = { 0, 0 };
+    for (;;) {
+        profile_reset_phases();
+
+        uint64_t allocationsBefore = profile_allocation_count();
+        uint64_t t0 = profile_now_ns();
+        act(0.0f); // dt comes from the recording
+        uint64_t t1 = profile_now_ns();
+        if (headless_quit_scheduled()) break;
+        draw();
+        uint64_t t2 = profile_now_ns();
+        samples.allocations.push_back(profile_allocation_count() - allocationsBefore);
+
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            samples.ns[phase].push_back(profilePhaseNs[phase]);
+        samples.actNs.push_back(t1 - t0);
+        samples.drawNs.push_back(t2 - t1);
+        peak.asteroidCount = std::max(peak.asteroidCount, gameWorld.asteroids.count());
+        peak.bulletCount = std::max(peak.bulletCount, gameWorld.bullets.count());
+    }
+
+    ReplayStats stats = replay_stats();
+    replay_finish();
+
+    int frames = (int)samples.actNs.size();
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        report(format, peak, profile_phase_name(phase), frames, samples.ns[phase]);
+    report(format, peak, "act", frames, samples.actNs);
+    report(format, peak, "draw", frames, samples.drawNs);
+    report(format, peak, "allocations", frames, samples.allocations, "count");
+
+    if (stats.mismatches) {
+        fprintf(stderr, "%s: %llu of %llu frames diverged, first at frame %lld\n", path,
+                (unsigned long long)stats.mismatches, (unsigned long long)stats.frames,
+                (long long)stats.firstMismatch);
+        return false;
+    }
+    return true;
+}
+
+// Times compositing one full-screen layer with every blend kernel at every
+// SIMD level, next to a plain memcpy of the same pixels. Returns false if a
+// level disagrees with the scalar kernels.
+static bool run_blend_kernels(int frames, uint32_t seed, const char* format) {
+    const int pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    Scenario scenario = { pixels, 0 };
+
+    // a premultiplied layer of random colors and alphas over a random frame
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> layer(pixels), frame(pixels), target(pixels);
+    for (int i = 0; i < pixels; i++) {
+        layer[i] = premultiply(rng());
+        frame[i] = rng();
+    }
+    uint32_t color = premultiply(make_color(40, 80, 160, 128));
+
+    std::vector<uint64_t> samples;
+    for (int f = 0; f < frames; f++) {
+        uint64_t t0 = profile_now_ns();
+        memcpy(target.data(), layer.data(), pixels * sizeof(uint32_t));
+        samples.push_back(profile_now_ns() - t0);
+    }
+    report(format, scenario, "memcpy", frames, samples);
+
+    static const char* names[] = { "blend_span_over", "blend_span_add", "blend_over", "blend_add" };
+    std::vector<uint32_t> expected[4];
+    bool identical = true;
+    SimdLevel best = simd_detect();
+
+    for (int level = SIMD_SCALAR; level <= best; level++) {
+        simd_select((SimdLevel)level);
+        for (int kernel = 0; kernel < 4; kernel++) {
+            // every frame blends onto a fresh copy of the same frame
+            samples.clear();
+            for (int f = 0; f < frames; f++) {
+                target = frame;
+                uint64_t t0 = profile_now_ns();
+                switch (kernel) {
+                    case 0: blend_span_over(target.data(), pixels, color); break;
+                    case 1: blend_span_add(target.data(), pixels, color); break;
+                    case 2: blend_over(target.data(), layer.data(), pixels); break;
+                    case 3: blend_add(target.data(), layer.data(), pixels); break;
+                }
+                samples.push_back(profile_now_ns() - t0);
+            }
+
+            if (level == SIMD_SCALAR) {
+                expected[kernel] = target;
+            } else if (target != expected[kernel]) {
+                fprintf(stderr, "%s %s differs from scalar\n", simd_level_name((SimdLevel)level), names[kernel]);
+                identical = false;
+            }
+
+            char phase[40];
+            snprintf(phase, sizeof(phase), "%s_%s", names[kernel], simd_level_name((SimdLevel)level));
+            report(format, scenario, phase, frames, samples);
+        }
+    }
+
+    simd_select(best);
+    return identical;
+}
+
+// Keeps count particles alive all over the screen and times their update
+// and their drawing (the frame's clear included) on their own. The
+// scenario columns report the particle count.
+static void run_particles(int count, int frames, float dt, const char* format) {
+    Scenario scenario = { count, 0 };
+    ParticleSystem particles;
+    particles.reserve(count);
+
+    // lifetimes far beyond the run, so the count holds; slow enough that
+    // most stay on screen, fast enough that some draw as streaks
+    ParticleEmitter emitter = { 0.0f, 120.0f, 6.2831853f, 1000.0f, 2000.0f, make_color(60, 40, 20) };
+    const int perBurst = 256;
+    for (int emitted = 0; emitted < count; emitted += perBurst) {
+        float x = (float)((emitted / perBurst * 97) % SCREEN_WIDTH);
+        float y = (float)((emitted / perBurst * 61) % SCREEN_HEIGHT);
+        particles.emit(emitter, std::min(perBurst, count - emitted), x, y, 0.0f, 0.0f, 0.0f);
+    }
+
+    std::vector<uint64_t> updateNs, drawNs;
+    for (int frame = 0; frame < frames; frame++) {
+        uint64_t t0 = profile_now_ns();
+        particles.update(dt);
+        uint64_t t1 = profile_now_ns();
+        render_begin_frame();
+        particles.draw();
+        render_end_frame();
+        uint64_t t2 = profile_now_ns();
+        updateNs.push_back(t1 - t0);
+        drawNs.push_back(t2 - t1);
+    }
+    report(format, scenario, "particle_update", frames, updateNs);
+    report(format, scenario, "particle_draw", frames, drawNs);
+}
+
+static void run_sprites(int count, int frames, uint32_t seed, const char* format) {
+    Scenario scenario = { count, 0 };
+    asteroid_sprites_build();
+
+    // the sizes spawning and splitting produce, anywhere on screen
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> px(0.0f, (float)SCREEN_WIDTH);
+    std::uniform_real_distribution<float> py(0.0f, (float)SCREEN_HEIGHT);
+    std::uniform_real_distribution<float> radius(9.0f, 29.0f);
+    std::uniform_real_distribution<float> angle(0.0f, TWO_PI);
+    std::vector<Vector2> positions(count);
+    std::vector<float> radii(count), angles(count);
+    std::vector<int> shapes(count);
+    for (int i = 0; i < count; i++) {
+        positions[i] = Vector2(px(rng), py(rng));
+        radii[i] = radius(rng);
+        angles[i] = angle(rng);
+        shapes[i] = i % ASTEROID_SHAPES;
+    }
+
+    const uint32_t color = make_color(128, 128, 128);
+    const char* modes[] = { "asteroid_sprite_ns", "asteroid_circle_ns", "asteroid_polygon_ns" };
+    for (int mode = 0; mode < 3; mode++) {
+        std::vector<uint64_t> samples;
+        for (int frame = 0; frame < frames; frame++) {
+            render_begin_frame();
+            uint64_t t0 = profile_now_ns();
+            for (int i = 0; i < count; i++) {
+                int x = (int)positions[i].x, y = (int)positions[i].y;
+                if (mode == 0) {
+                    draw_sprite(x, y, asteroid_sprite(shapes[i], radii[i], angles[i]), color);
+                } else if (mode == 1) {
+                    draw_circle(x, y, (int)radii[i], color);
+                } else {
+                    // the outline as a fan of triangles around its center
+                    float vx[ASTEROID_OUTLINE_POINTS], vy[ASTEROID_OUTLINE_POINTS];
+                    asteroid_outline(shapes[i], radii[i], angles[i], vx, vy);
+                    for (int k = 0; k < ASTEROID_OUTLINE_POINTS; k++) {
+                        int next = (k + 1) % ASTEROID_OUTLINE_POINTS;
+                        draw_triangle(positions[i], positions[i] + Vector2(vx[k], vy[k]),
+                                      positions[i] + Vector2(vx[next], vy[next]), color);
+                    }
+                }
+            }
+            samples.push_back((profile_now_ns() - t0) / count);
+            render_end_frame();
+        }
+        report(format, scenario, modes[mode], frames, samples, "ns");
+    }
+
+    std::vector<uint64_t> bytes(1, asteroid_sprite_stats().bytes);
+    report(format, scenario, "sprite_cache_bytes", 1, bytes, "bytes");
+}
+
+// Half a second ahead, the horizon of a bot choosing its next move
+static const int LOOKAHEAD_TICKS = 60;
+
+// Returns false if a restored state does not step like the original world
+static bool run_lookahead(int futures, int frames, uint32_t seed, const char* format) {
+    // a game in progress: the ship has turned, fired and split asteroids
+    World root;
+    root.seed = seed;
+    reset_world(root);
+    uint8_t firing[MAX_SHIPS] = { INPUT_LEFT | INPUT_SPACE };
+    for (int t = 0; t < 240 && !root.gameOver && !root.gameWon; t++) simulate_tick(root, firing);
+    Scenario scenario = { root.asteroids.count(), root.bullets.count() };
+
+    World scratch;
+    reset_world(scratch);
+    StateArena arena;
+    arena.reserve(2);
+    arena.save(root, 0);
+
+    // the round trip loses nothing, and a restored state steps like the world
+    arena.restore(0, scratch);
+    World reference = root;
+    for (int t = 0; t < LOOKAHEAD_TICKS; t++) {
+        simulate_tick(reference, firing);
+        simulate_tick(scratch, firing);
+    }
+    if (hash_world(reference) != hash_world(scratch)) {
+        fprintf(stderr, "lookahead: a restored state diverged from the world it was saved from\n");
+        return false;
+    }
+
+    // every future holds one of these inputs all the way
+    const uint8_t moves[] = { 0, INPUT_LEFT, INPUT_RIGHT, INPUT_UP, INPUT_SPACE,
+                              INPUT_LEFT | INPUT_SPACE, INPUT_RIGHT | INPUT_SPACE, INPUT_UP | INPUT_SPACE };
+    const int moveCount = (int)(sizeof(moves) / sizeof(moves[0]));
+    const int copies = 1000;
+
+    // reserved up front, so recording a frame allocates nothing while the
+    // futures are counted
+    std::vector<uint64_t> saveNs, restoreNs, copyNs, tickNs, allocations;
+    for (std::vector<uint64_t>* samples : { &saveNs, &restoreNs, &copyNs, &tickNs, &allocations }) {
+        samples->reserve(frames);
+    }
+    uint64_t saveTotal = 0, tickTotal = 0, ticks = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        uint64_t t0 = profile_now_ns();
+        for (int i = 0; i < copies; i++) arena.save(root, 1);
+        uint64_t t1 = profile_now_ns();
+        for (int i = 0; i < copies; i++) arena.restore(1, scratch);
+        uint64_t t2 = profile_now_ns();
+        for (int i = 0; i < copies; i++) arena.copy(0, 1);
+        uint64_t t3 = profile_now_ns();
+        saveNs.push_back((t1 - t0) / copies);
+        restoreNs.push_back((t2 - t1) / copies);
+        copyNs.push_back((t3 - t2) / copies);
+        saveTotal += t1 - t0;
+
+        uint64_t allocationsBefore = profile_allocation_count();
+        uint64_t t4 = profile_now_ns();
+        for (int f = 0; f < futures; f++) {
+            uint8_t inputs[MAX_SHIPS] = { moves[f % moveCount] };
+            step_state(arena, 0, 1, scratch, inputs, LOOKAHEAD_TICKS);
+        }
+        uint64_t t5 = profile_now_ns();
+        tickNs.push_back((t5 - t4) / ((uint64_t)futures * LOOKAHEAD_TICKS));
+        allocations.push_back(profile_allocation_count() - allocationsBefore);
+        tickTotal += t5 - t4;
+        ticks += (uint64_t)futures * LOOKAHEAD_TICKS;
+    }
+
+    report(format, scenario, "state_save_ns", frames, saveNs, "ns");
+    report(format, scenario, "state_restore_ns", frames, restoreNs, "ns");
+    report(format, scenario, "state_copy_ns", frames, copyNs, "ns");
+    report(format, scenario, "lookahead_tick_ns", frames, tickNs, "ns");
+    report(format, scenario, "lookahead_allocations", frames, allocations, "count");
+
+    std::vector<uint64_t> snapshotRate(1, (uint64_t)(1e9 * copies * frames / (double)std::max<uint64_t>(saveTotal, 1)));
+    std::vector<uint64_t> tickRate(1, (uint64_t)(1e9 * ticks / (double)std::max<uint64_t>(tickTotal, 1)));
+    std::vector<uint64_t> bytes(1, arena.state_bytes());
+    report(format, scenario, "snapshots_per_second", 1, snapshotRate, "per_second");
+    report(format, scenario, "lookahead_ticks_per_second", 1, tickRate, "per_second");
+    report(format, scenario, "state_bytes", 1, bytes, "bytes");
+    return true;
+}
+
+// Returns false if a SIMD level disagrees with the scalar kernel
+static bool run_kernels(int objectCount, int frames, float dt, uint32_t seed, const char* format) {
+    AsteroidArray seeded;
+    Scenario scenario = { objectCount, 0 };
+    BulletArray unused;
+    seed_world(scenario, seed, seeded, unused);
+
+    std::vector<float> expectedX, expectedY;
+    bool identical = true;
+    SimdLevel best = simd_detect();
+
+    for (int level = SIMD_SCALAR; level <= best; level++) {
+        simd_select((SimdLevel)level);
+        AsteroidArray objects = seeded;
+
+        std::vector<uint64_t> samples;
+        for (int frame = 0; frame < frames; frame++) {
+            uint64_t t0 = profile_now_ns();
+            integrate_wrap(objects.x.data(), objects.y.data(), objects.vx.data(), objects.vy.data(), objects.count(), dt);
+            samples.push_back(profile_now_ns() - t0);
+        }
+
+        if (level == SIMD_SCALAR) {
+            expectedX = objects.x;
+            expectedY = objects.y;
+        } else if (objects.x != expectedX || objects.y != expectedY) {
+            fprintf(stderr, "%s kernel differs from scalar\n", simd_level_name((SimdLevel)level));
+            identical = false;
+        }
+
+        char phase[32];
+        snprintf(phase, sizeof(phase), "integrate_%s", simd_level_name((SimdLevel)level));
+        report(format, scenario, phase, frames, samples);
+    }
+
+    simd_select(best);
+    return identical && run_blend_kernels(frames, seed, format);
+}
+
+static void print_usage() {
+    fprintf(stderr,
+        "usage: asteroids_bench [options]\n"
+        "  --frames N       frames per scenario (default 100)\n"
+        "  --dt SECONDS     fixed frame time (default 0.016667)\n"
+        "  --sizes A,B,...  asteroid counts (default 100,1000,10000,100000)\n"
+        "  --bullets-per-asteroid R  bullet ratio (default 0.1)\n"
+        "  --seed N         world seed (default 1)\n"
+        "  --kernels N      time the integration kernels on N objects, and the blend kernels\n"
+        "  --particles N    time updating and drawing N particles alone\n"
+        "  --sprites N      time drawing N asteroids from the sprite cache, as circles and as polygons\n"
+        "  --lookahead N    time saving and restoring world states, and N futures simulated ahead per frame\n"
+        "  --replay FILE    time a recorded session instead of seeded worlds\n"
+        "  --render-threads N  banded rendering on N threads (default 0: immediate)\n"
+        "  --json           JSON lines instead of CSV\n");
+}
+
+int main(int argc, char** argv) {
+    int frames = 100;
+    float dt = 1.0f / 60.0f;
+    float bulletRatio = 0.1f;
+    uint32_t seed = 1;
+    const char* format = "csv";
+    std::vector<int> sizes = { 100, 1000, 10000, 100000 };
+    int kernelObjects = 0;
+    int particleCount = 0;
+    int spriteCount = 0;
+    int lookaheadFutures = 0;
+    const char* replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--frames") == 0 && value) {
+            frames = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--dt") == 0 && value) {
+            dt = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--sizes") == 0 && value) {
+            sizes.clear();
+            for (const char* p = value; *p; ) {
+                sizes.push_back(atoi(p));
+                p = strchr(p, ',');
+                if (!p) break;
+                p++;
+            }
+            i++;
+        } else if (strcmp(arg, "--bullets-per-asteroid") == 0 && value) {
+            bulletRatio = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            seed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else if (strcmp(arg, "--kernels") == 0 && value) {
+            kernelObjects = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--particles") == 0 && value) {
+            particleCount = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--sprites") == 0 && value) {
+            spriteCount = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--lookahead") == 0 && value) {
+            lookaheadFutures = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--replay") == 0 && value) {
+            replayPath = value;
+            i++;
+        } else if (strcmp(arg, "--render-threads") == 0 && value) {
+            render_set_threads(atoi(value));
+            i++;
+        } else if (strcmp(arg, "--json") == 0) {
+            format = "json";
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (frames <= 0 || dt <= 0.0f) {
+        print_usage();
+        return 1;
+    }
+
+#ifndef ASTEROIDS_PROFILE
+    fprintf(stderr, "warning: built without ASTEROIDS_PROFILE, phase timings will be zero\n");
+#endif
+
+    // no keys held: the ship neither moves nor shoots
+    headless_reset_input();
+
+    if (strcmp(format, "csv") == 0)
+        printf("asteroids,bullets,phase,frames,unit,p50,p99,max\n");
+
+    if (kernelObjects > 0)
+        return run_kernels(kernelObjects, frames, dt, seed, format) ? 0 : 1;
+
+    if (particleCount > 0) {
+        run_particles(particleCount, frames, dt, format);
+        return 0;
+    }
+
+    if (spriteCount > 0) {
+        run_sprites(spriteCount, frames, seed, format);
+        return 0;
+    }
+
+    if (lookaheadFutures > 0)
+        return run_lookahead(lookaheadFutures, frames, seed, format) ? 0 : 1;
+
+    if (replayPath)
+        return run_replay(replayPath, format) ? 0 : 1;
+
+    for (int size : sizes) {
+        Scenario scenario;
+        scenario.asteroidCount = size;
+        scenario.bulletCount = std::max(1, (int)(size * bulletRatio));
+        run_scenario(scenario, frames, dt, seed, format);
+        fflush(stdout);
+    }
+
+    return 0;
+}
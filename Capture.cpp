@@ -0,0 +1,435 @@
+#include "Capture.h"
+#include "Engine.h"
+#include "Profile.h"
+#include <stdio.h>
+#include <string.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+static const char CAPTURE_MAGIC[4] = { 'A', 'S', 'C', 'P' };
+static const char INDEX_MAGIC[4] = { 'A', 'S', 'C', 'I' };
+static const size_t HEADER_SIZE = 16;
+static const size_t FRAME_HEADER_SIZE = 12;
+static const size_t TRAILER_SIZE = 16;
+static const size_t FRAME_PIXELS = (size_t)SCREEN_WIDTH * SCREEN_HEIGHT;
+static const uint32_t RUN_BIT = 0x80000000u;
+
+static void put_u32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u64(uint8_t* p, uint64_t value) {
+    put_u32(p, (uint32_t)value);
+    put_u32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    return get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// Capture files pass 2 GB after a few hundred raw frames
+static bool seek(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// --- Run-length code ---
+
+static void flush_literals(const uint32_t* in, size_t begin, size_t end, uint32_t* out, size_t& o) {
+    if (begin == end) return;
+    out[o++] = (uint32_t)(end - begin);
+    memcpy(out + o, in + begin, (end - begin) * sizeof(uint32_t));
+    o += end - begin;
+}
+
+// Runs of 3 or more words become a token and the word, the rest literal
+// blocks; out needs room for n + n / 2 + 1 words
+static size_t rle_encode(const uint32_t* in, size_t n, uint32_t* out) {
+    size_t o = 0, literals = 0, i = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && in[i + run] == in[i] && run < RUN_BIT - 1) run++;
+        if (run < 3) {
+            i += run;
+            continue;
+        }
+        flush_literals(in, literals, i, out, o);
+        out[o++] = RUN_BIT | (uint32_t)run;
+        out[o++] = in[i];
+        i += run;
+        literals = i;
+    }
+    flush_literals(in, literals, n, out, o);
+    return o;
+}
+
+static bool rle_decode(const uint32_t* in, size_t words, uint32_t* out, size_t n) {
+    size_t i = 0, o = 0;
+    while (i < words) {
+        uint32_t token = in[i++];
+        size_t count = token & ~RUN_BIT;
+        if (count > n - o) return false;
+        if (token & RUN_BIT) {
+            if (i >= words) return false;
+            uint32_t value = in[i++];
+            for (size_t k = 0; k < count; k++) out[o + k] = value;
+        } else {
+            if (count > words - i) return false;
+            memcpy(out + o, in + i, count * sizeof(uint32_t));
+            i += count;
+        }
+        o += count;
+    }
+    return o == n;
+}
+
+// --- Writer ---
+
+struct QueuedFrame {
+    int buffer;
+    uint32_t frame;
+};
+
+static std::mutex mutex;
+static std::condition_variable frameQueued, bufferFreed;
+static std::thread writer;
+static bool active = false;
+static bool stopping = false;
+static CaptureConfig config;
+static CaptureStats stats;
+
+// Pool of frame buffers: free ones on a stack, full ones in a FIFO ring
+static std::vector<std::unique_ptr<uint32_t[]>> pool;
+static std::vector<int> freeBuffers;
+static std::vector<QueuedFrame> queue;
+static size_t queueHead = 0, queued = 0;
+
+// Owned by the writer thread while capturing
+static FILE* file = nullptr;
+static uint64_t fileOffset = 0;
+static bool writeFailed = false;
+static std::vector<uint32_t> previous, delta, encoded;
+static std::vector<CapturedFrame> frameIndex;
+
+static void write_bytes(const void* data, size_t size) {
+    if (fwrite(data, 1, size, file) != size) writeFailed = true;
+    fileOffset += size;
+}
+
+static void write_frame(const uint32_t* pixels, uint32_t frame) {
+    const uint32_t* payload = pixels;
+    size_t words = FRAME_PIXELS;
+    uint32_t encoding = CAPTURE_RAW;
+
+    if (config.compress) {
+        bool key = frameIndex.size() % CAPTURE_KEY_INTERVAL == 0;
+        const uint32_t* source = pixels;
+        if (!key) {
+            for (size_t i = 0; i < FRAME_PIXELS; i++) delta[i] = pixels[i] ^ previous[i];
+            source = delta.data();
+        }
+        words = rle_encode(source, FRAME_PIXELS, encoded.data());
+        payload = encoded.data();
+        encoding = key ? CAPTURE_RLE : CAPTURE_RLE_DELTA;
+        memcpy(previous.data(), pixels, FRAME_PIXELS * sizeof(uint32_t));
+    }
+
+    CapturedFrame entry = { fileOffset, frame, encoding };
+    frameIndex.push_back(entry);
+
+    uint8_t header[FRAME_HEADER_SIZE];
+    put_u32(header, frame);
+    put_u32(header + 4, encoding);
+    put_u32(header + 8, (uint32_t)(words * sizeof(uint32_t)));
+    write_bytes(header, sizeof(header));
+    write_bytes(payload, words * sizeof(uint32_t)); // pixel words, little endian hosts only
+}
+
+static void writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        frameQueued.wait(lock, [] { return queued > 0 || stopping; });
+        if (queued == 0) break; // stopping, and everything is written
+
+        QueuedFrame next = queue[queueHead];
+        queueHead = (queueHead + 1) % queue.size();
+        queued--;
+
+        lock.unlock();
+        write_frame(pool[next.buffer].get(), next.frame);
+        lock.lock();
+
+        stats.written++;
+        stats.bytes = fileOffset;
+        freeBuffers.push_back(next.buffer);
+        bufferFreed.notify_one();
+    }
+}
+
+bool capture_begin(const char* path, const CaptureConfig& settings, std::string* error) {
+    if (active) capture_end(nullptr);
+
+    file = fopen(path, "wb");
+    if (!file) {
+        if (error) *error = "cannot open for writing";
+        return false;
+    }
+
+    config = settings;
+    if (config.poolFrames < 1) config.poolFrames = 1;
+    stats = CaptureStats();
+    fileOffset = 0;
+    writeFailed = false;
+
+    // every buffer the capture needs exists before the first frame
+    pool.clear();
+    freeBuffers.clear();
+    for (int i = 0; i < config.poolFrames; i++) {
+        pool.emplace_back(new uint32_t[FRAME_PIXELS]);
+        freeBuffers.push_back(i);
+    }
+    queue.assign(config.poolFrames, QueuedFrame());
+    queueHead = 0;
+    queued = 0;
+    if (config.compress) {
+        previous.assign(FRAME_PIXELS, 0);
+        delta.assign(FRAME_PIXELS, 0);
+        encoded.assign(FRAME_PIXELS + FRAME_PIXELS / 2 + 1, 0);
+    }
+    frameIndex.clear();
+    frameIndex.reserve(1 << 16);
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, CAPTURE_MAGIC, 4);
+    put_u32(header + 4, CAPTURE_VERSION);
+    put_u32(header + 8, SCREEN_WIDTH);
+    put_u32(header + 12, SCREEN_HEIGHT);
+    write_bytes(header, sizeof(header));
+
+    stopping = false;
+    active = true;
+    writer = std::thread(writer_loop);
+    return true;
+}
+
+bool capture_active() {
+    return active;
+}
+
+void capture_frame() {
+    if (!active) return;
+    uint64_t start = profile_now_ns();
+
+    int slot;
+    uint32_t frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        frame = (uint32_t)stats.frames++;
+        if (freeBuffers.empty()) {
+            if (config.policy == CAPTURE_DROP) {
+                stats.dropped++;
+                uint64_t spent = profile_now_ns() - start;
+                stats.submitNs += spent;
+                if (spent > stats.submitNsMax) stats.submitNsMax = spent;
+                return;
+            }
+            uint64_t waitStart = profile_now_ns();
+            bufferFreed.wait(lock, [] { return !freeBuffers.empty(); });
+            stats.blockedNs += profile_now_ns() - waitStart;
+        }
+        slot = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+
+    // the only copy on the game thread; encoding happens on the writer
+    memcpy(pool[slot].get(), buffer, FRAME_PIXELS * sizeof(uint32_t));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        QueuedFrame entry = { slot, frame };
+        queue[(queueHead + queued) % queue.size()] = entry;
+        queued++;
+
+        uint64_t spent = profile_now_ns() - start;
+        stats.submitNs += spent;
+        if (spent > stats.submitNsMax) stats.submitNsMax = spent;
+    }
+    frameQueued.notify_one();
+}
+
+bool capture_end(std::string* error) {
+    if (!active) return true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameQueued.notify_one();
+    writer.join();
+    active = false;
+
+    // index and trailer
+    uint64_t indexOffset = fileOffset;
+    for (const CapturedFrame& entry : frameIndex) {
+        uint8_t record[16];
+        put_u64(record, entry.offset);
+        put_u32(record + 8, entry.frame);
+        put_u32(record + 12, entry.encoding);
+        write_bytes(record, sizeof(record));
+    }
+    uint8_t trailer[TRAILER_SIZE];
+    put_u32(trailer, (uint32_t)frameIndex.size());
+    put_u64(trailer + 4, indexOffset);
+    memcpy(trailer + 12, INDEX_MAGIC, 4);
+    write_bytes(trailer, sizeof(trailer));
+
+    if (fclose(file) != 0) writeFailed = true;
+    file = nullptr;
+    stats.bytes = fileOffset;
+    stats.failed = writeFailed;
+
+    pool.clear();
+    freeBuffers.clear();
+    queue.clear();
+
+    if (writeFailed && error) *error = "write failed";
+    return !writeFailed;
+}
+
+CaptureStats capture_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+// --- Reading ---
+
+static bool read_header(FILE* in, std::string* error) {
+    uint8_t header[HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) || memcmp(header, CAPTURE_MAGIC, 4) != 0) {
+        if (error) *error = "not a capture file";
+        return false;
+    }
+    if (get_u32(header + 4) != CAPTURE_VERSION) {
+        if (error) *error = "unsupported capture version";
+        return false;
+    }
+    if (get_u32(header + 8) != SCREEN_WIDTH || get_u32(header + 12) != SCREEN_HEIGHT) {
+        if (error) *error = "frame size differs from the screen";
+        return false;
+    }
+    return true;
+}
+
+static bool read_trailer_index(FILE* in, std::vector<CapturedFrame>& frames) {
+#ifdef _WIN32
+    if (_fseeki64(in, -(long long)TRAILER_SIZE, SEEK_END) != 0) return false;
+#else
+    if (fseeko(in, -(off_t)TRAILER_SIZE, SEEK_END) != 0) return false;
+#endif
+    uint8_t trailer[TRAILER_SIZE];
+    if (fread(trailer, 1, sizeof(trailer), in) != sizeof(trailer) || memcmp(trailer + 12, INDEX_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    uint32_t count = get_u32(trailer);
+    if (!seek(in, get_u64(trailer + 4))) return false;
+    frames.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t record[16];
+        if (fread(record, 1, sizeof(record), in) != sizeof(record)) return false;
+        frames[i].offset = get_u64(record);
+        frames[i].frame = get_u32(record + 8);
+        frames[i].encoding = get_u32(record + 12);
+    }
+    return true;
+}
+
+bool capture_read_index(const char* path, std::vector<CapturedFrame>& frames, std::string* error) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+    bool ok = read_header(in, error);
+    frames.clear();
+    if (ok && !read_trailer_index(in, frames)) {
+        // no index: walk the frames up to the first incomplete one
+        frames.clear();
+        uint64_t offset = HEADER_SIZE;
+        uint8_t header[FRAME_HEADER_SIZE];
+        while (seek(in, offset) && fread(header, 1, sizeof(header), in) == sizeof(header)) {
+            uint64_t next = offset + FRAME_HEADER_SIZE + get_u32(header + 8);
+            if (!seek(in, next - 1) || fgetc(in) == EOF) break;
+            CapturedFrame entry = { offset, get_u32(header), get_u32(header + 4) };
+            frames.push_back(entry);
+            offset = next;
+        }
+    }
+    fclose(in);
+    return ok;
+}
+
+bool capture_read_frame(const char* path, const std::vector<CapturedFrame>& frames, size_t i,
+                        uint32_t* pixels, std::string* error) {
+    if (i >= frames.size()) {
+        if (error) *error = "no such frame";
+        return false;
+    }
+    size_t key = i;
+    while (key > 0 && frames[key].encoding == CAPTURE_RLE_DELTA) key--;
+
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+
+    std::vector<uint32_t> payload, decoded(FRAME_PIXELS);
+    bool ok = true;
+    for (size_t k = key; k <= i && ok; k++) {
+        uint8_t header[FRAME_HEADER_SIZE];
+        ok = seek(in, frames[k].offset) && fread(header, 1, sizeof(header), in) == sizeof(header);
+        uint32_t bytes = ok ? get_u32(header + 8) : 0;
+        ok = ok && bytes % sizeof(uint32_t) == 0;
+        if (ok) {
+            payload.resize(bytes / sizeof(uint32_t));
+            ok = fread(payload.data(), 1, bytes, in) == bytes;
+        }
+        if (!ok) break;
+
+        switch (get_u32(header + 4)) {
+            case CAPTURE_RAW:
+                ok = payload.size() == FRAME_PIXELS;
+                if (ok) memcpy(pixels, payload.data(), bytes);
+                break;
+            case CAPTURE_RLE:
+                ok = rle_decode(payload.data(), payload.size(), pixels, FRAME_PIXELS);
+                break;
+            case CAPTURE_RLE_DELTA:
+                ok = k > key && rle_decode(payload.data(), payload.size(), decoded.data(), FRAME_PIXELS);
+                if (ok) {
+                    for (size_t p = 0; p < FRAME_PIXELS; p++) pixels[p] ^= decoded[p];
+                }
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+    fclose(in);
+
+    if (!ok && error) *error = "damaged frame";
+    return ok;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//
+//  Frame capture to disk on a background thread.
+//
+//  capture_frame() copies the finished back buffer into a free buffer of a
+//  fixed pool and queues it; a writer thread encodes queued frames and
+//  recycles their buffers. When the writer falls behind and no buffer is
+//  free, the frame is dropped (CAPTURE_DROP) or the game thread waits for
+//  one (CAPTURE_BLOCK). The game thread's cost is one memcpy of the frame.
+//
+//  File layout, little endian:
+//    header   "ASCP", u32 version, u32 width, u32 height
+//    frame    u32 frame number, u32 encoding, u32 payload bytes, payload
+//    index    per frame: u64 file offset, u32 frame number, u32 encoding
+//    trailer  u32 frame count, u64 index offset, "ASCI"
+//  Frame numbers count capture_frame() calls, so dropped frames show as
+//  gaps. Frames are streamed as they are written; a file whose trailer is
+//  missing (the game crashed) can still be read front to back.
+//
+//  Encodings: raw pixels, or a run-length code of the pixels (key frames,
+//  every CAPTURE_KEY_INTERVAL frames written) or of their XOR with the
+//  previous frame written. A run-length code is a sequence of u32 tokens:
+//  with the top bit set, the low bits repeat the next word that many times;
+//  otherwise that many literal words follow.
+//
+
+enum CaptureEncoding {
+    CAPTURE_RAW,
+    CAPTURE_RLE,
+    CAPTURE_RLE_DELTA
+};
+
+enum CapturePolicy {
+    CAPTURE_DROP,  // skip frames while no buffer is free
+    CAPTURE_BLOCK  // wait for the writer (back-pressure)
+};
+
+const uint32_t CAPTURE_VERSION = 1;
+const int CAPTURE_KEY_INTERVAL = 60;
+
+struct CaptureConfig {
+    int poolFrames;        // frame buffers in flight
+    CapturePolicy policy;
+    bool compress;         // run-length code frames; false writes them raw
+
+    CaptureConfig() : poolFrames(4), policy(CAPTURE_DROP), compress(true) {}
+};
+
+struct CaptureStats {
+    uint64_t frames;       // capture_frame() calls
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t bytes;        // file size
+    uint64_t submitNs;     // game thread time in capture_frame(), total
+    uint64_t submitNsMax;
+    uint64_t blockedNs;    // part of submitNs spent waiting for a buffer
+    bool failed;           // a write failed
+};
+
+bool capture_begin(const char* path, const CaptureConfig& config, std::string* error);
+bool capture_active();
+
+// Hands the current back buffer to the writer; call after draw()
+void capture_frame();
+
+// Writes the queued frames and the index, then closes the file; false if
+// anything failed to write
+bool capture_end(std::string* error);
+
+// Counts of the running capture, or of the last one after capture_end()
+CaptureStats capture_stats();
+
+// --- Reading ---
+
+struct CapturedFrame {
+    uint64_t offset;
+    uint32_t frame;
+    uint32_t encoding;
+};
+
+// Reads the index of a capture file; without a trailer the frames are
+// found by scanning
+bool capture_read_index(const char* path, std::vector<CapturedFrame>& frames, std::string* error);
+
+// Decodes the i-th stored frame into pixels (width * height of the file),
+// replaying deltas from the key frame before it
+bool capture_read_frame(const char* path, const std::vector<CapturedFrame>& frames, size_t i,
+                        uint32_t* pixels, std::string* error);
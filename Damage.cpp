@@ -0,0 +1,135 @@
+#include "Damage.h"
+#include "Raster.h"
+#include <string.h>
+#include <algorithm>
+
+// Tiles drawn in the previous and the current frame
+static bool drawnBefore[DAMAGE_TILES_Y][DAMAGE_TILES_X];
+static bool drawnNow[DAMAGE_TILES_Y][DAMAGE_TILES_X];
+
+// The buffer starts out unknown, so the first frame clears everything
+static bool invalidated = true;
+static bool clearedAll = false;
+
+static std::vector<DirtyRect> dirtyRects;
+static int dirtyPixels = 0;
+
+// Rectangles still open at the tile row above and at this one; kept across
+// frames so building the list does not allocate
+static std::vector<int> openAbove, openHere;
+
+void damage_mark(int x, int y, int width, int height) {
+    int x0 = std::max(x, 0), x1 = std::min(x + width, SCREEN_WIDTH);
+    int y0 = std::max(y, 0), y1 = std::min(y + height, SCREEN_HEIGHT);
+    if (x0 >= x1 || y0 >= y1) return;
+
+    int tx1 = (x1 - 1) / DAMAGE_TILE_SIZE;
+    int ty1 = (y1 - 1) / DAMAGE_TILE_SIZE;
+    for (int ty = y0 / DAMAGE_TILE_SIZE; ty <= ty1; ty++) {
+        for (int tx = x0 / DAMAGE_TILE_SIZE; tx <= tx1; tx++) {
+            drawnNow[ty][tx] = true;
+        }
+    }
+}
+
+// Left screen column of tile tx; tile_x(tx1) is the right edge of tiles [tx0, tx1)
+static int tile_x(int tx) {
+    return std::min(tx * DAMAGE_TILE_SIZE, SCREEN_WIDTH);
+}
+
+// Clears tiles [tx0, tx1) of tile row ty within the pixel rows [y0, y1)
+static void clear_tiles(int ty, int tx0, int tx1, int y0, int y1) {
+    y0 = std::max(y0, ty * DAMAGE_TILE_SIZE);
+    y1 = std::min(y1, ty * DAMAGE_TILE_SIZE + DAMAGE_TILE_SIZE);
+    int x0 = tile_x(tx0);
+    size_t bytes = (tile_x(tx1) - x0) * sizeof(uint32_t);
+
+    for (int y = y0; y < y1; y++) {
+        memset(&renderTarget[y][x0], 0, bytes);
+    }
+}
+
+void damage_begin_frame() {
+    clearedAll = invalidated;
+    invalidated = false;
+    memset(drawnNow, 0, sizeof(drawnNow));
+}
+
+void damage_clear_rows(int y0, int y1) {
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, SCREEN_HEIGHT);
+    if (y0 >= y1) return;
+
+    if (clearedAll) {
+        memset(renderTarget[y0], 0, (y1 - y0) * SCREEN_WIDTH * sizeof(uint32_t));
+        return;
+    }
+
+    // clear runs of consecutive tiles with one memset per pixel row
+    for (int ty = y0 / DAMAGE_TILE_SIZE; ty <= (y1 - 1) / DAMAGE_TILE_SIZE; ty++) {
+        for (int tx = 0; tx < DAMAGE_TILES_X; ) {
+            if (!drawnBefore[ty][tx]) { tx++; continue; }
+            int start = tx;
+            while (tx < DAMAGE_TILES_X && drawnBefore[ty][tx]) tx++;
+            clear_tiles(ty, start, tx, y0, y1);
+        }
+    }
+}
+
+void damage_end_frame() {
+    dirtyRects.clear();
+    dirtyPixels = 0;
+
+    if (clearedAll) {
+        dirtyRects.push_back({ 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT });
+        dirtyPixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    } else {
+        // Runs of dirty tiles in each tile row; a run with the same columns
+        // as one in the row above extends that rectangle downwards
+        openAbove.clear();
+        for (int ty = 0; ty < DAMAGE_TILES_Y; ty++) {
+            int y0 = ty * DAMAGE_TILE_SIZE;
+            int y1 = std::min(y0 + DAMAGE_TILE_SIZE, SCREEN_HEIGHT);
+            openHere.clear();
+
+            for (int tx = 0; tx < DAMAGE_TILES_X; ) {
+                if (!drawnBefore[ty][tx] && !drawnNow[ty][tx]) { tx++; continue; }
+                int start = tx;
+                while (tx < DAMAGE_TILES_X && (drawnBefore[ty][tx] || drawnNow[ty][tx])) tx++;
+
+                int x0 = tile_x(start);
+                int width = tile_x(tx) - x0;
+                int extended = -1;
+                for (int r : openAbove) {
+                    if (dirtyRects[r].x == x0 && dirtyRects[r].width == width) {
+                        extended = r;
+                        break;
+                    }
+                }
+                if (extended >= 0) {
+                    dirtyRects[extended].height += y1 - y0;
+                    openHere.push_back(extended);
+                } else {
+                    dirtyRects.push_back({ x0, y0, width, y1 - y0 });
+                    openHere.push_back((int)dirtyRects.size() - 1);
+                }
+                dirtyPixels += width * (y1 - y0);
+            }
+            openAbove.swap(openHere);
+        }
+    }
+
+    memcpy(drawnBefore, drawnNow, sizeof(drawnBefore));
+}
+
+const std::vector<DirtyRect>& damage_dirty_rects() {
+    return dirtyRects;
+}
+
+int damage_dirty_pixels() {
+    return dirtyPixels;
+}
+
+void damage_invalidate_all() {
+    invalidated = true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Engine.h"
+#include <vector>
+
+//
+//  Damage tracking for the backbuffer.
+//
+//  Every drawing primitive marks the screen area it touched, rounded out to
+//  DAMAGE_TILE_SIZE tiles. When the next frame is drawn only the tiles
+//  drawn in the previous frame are cleared, which leaves the whole buffer
+//  black exactly as a full clear would. At the end of a frame the tiles
+//  drawn in either frame form the dirty list: the only regions whose
+//  pixels can differ from the previous frame, so a present path can copy
+//  just those.
+//
+//  Anything that writes to buffer behind the primitives' back must mark
+//  its area with damage_mark() or call damage_invalidate_all().
+//
+
+struct DirtyRect {
+    int x, y;
+    int width, height;
+};
+
+const int DAMAGE_TILE_SIZE = 32;
+const int DAMAGE_TILES_X = (SCREEN_WIDTH + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+const int DAMAGE_TILES_Y = (SCREEN_HEIGHT + DAMAGE_TILE_SIZE - 1) / DAMAGE_TILE_SIZE;
+
+// Records that the rectangle was drawn this frame; clipped to the screen
+void damage_mark(int x, int y, int width, int height);
+
+// Starts a frame; nothing is marked as drawn yet
+void damage_begin_frame();
+
+// Clears what the last frame drew (everything after an invalidate) within
+// the pixel rows [y0, y1). Bands of rows may be cleared concurrently.
+void damage_clear_rows(int y0, int y1);
+
+// Builds the dirty list for the frame that was just drawn
+void damage_end_frame();
+
+// Regions changed by the last frame, as non-overlapping screen rectangles
+const std::vector<DirtyRect>& damage_dirty_rects();
+int damage_dirty_pixels();
+
+// Makes the next frame clear and report the whole screen
+void damage_invalidate_all();
@@ -0,0 +1,72 @@
+#include "Ecs.h"
+#include "JobPool.h"
+#include "Profile.h"
+#include <atomic>
+#include <string.h>
+
+static bool conflicts(const System& a, const System& b) {
+    return (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+}
+
+void SystemScheduler::add(const System& added) {
+    int at = 0;
+    for (size_t i = 0; i < systems.size(); i++) {
+        if (conflicts(systems[i], added) && stage[i] + 1 > at) at = stage[i] + 1;
+    }
+
+    // after the last system of its stage, so systems keep the order they
+    // were added in within a stage
+    int position = (int)systems.size();
+    while (position > 0 && stage[position - 1] > at) position--;
+    systems.insert(systems.begin() + position, added);
+    stage.insert(stage.begin() + position, at);
+
+    stageStart.clear();
+    for (int i = 0; i < (int)systems.size(); i++) {
+        if (i == 0 || stage[i] != stage[i - 1]) stageStart.push_back(i);
+    }
+}
+
+struct StageJob {
+    const System* systems;
+    void* context;
+    std::atomic<uint64_t> phaseNs[PROFILE_LABEL_COUNT]; // what the systems timed, wherever they ran
+};
+
+// Phase time goes to the thread a system ran on; it is taken back out of
+// that thread's counters and collected for the thread that ran the stage
+static void run_one_system(int index, void* context) {
+    StageJob& job = *(StageJob*)context;
+    if (!PROFILE_ENABLED) {
+        job.systems[index].run(job.context);
+        return;
+    }
+
+    uint64_t before[PROFILE_LABEL_COUNT];
+    memcpy(before, profilePhaseNs, sizeof(before));
+    job.systems[index].run(job.context);
+    for (int label = 0; label < PROFILE_LABEL_COUNT; label++) {
+        uint64_t spent = profilePhaseNs[label] - before[label];
+        if (spent == 0) continue;
+        profilePhaseNs[label] = before[label];
+        job.phaseNs[label].fetch_add(spent, std::memory_order_relaxed);
+    }
+}
+
+void SystemScheduler::run(void* context, JobPool* pool) const {
+    for (int s = 0; s < stage_count(); s++) {
+        int begin = stage_begin(s), end = stage_begin(s + 1);
+        if (pool && pool->threads() > 1 && end - begin > 1) {
+            StageJob job;
+            job.systems = systems.data() + begin;
+            job.context = context;
+            for (std::atomic<uint64_t>& ns : job.phaseNs) ns.store(0, std::memory_order_relaxed);
+            pool->parallel_for(end - begin, run_one_system, &job);
+            for (int label = 0; label < PROFILE_LABEL_COUNT; label++) {
+                profilePhaseNs[label] += job.phaseNs[label].load(std::memory_order_relaxed);
+            }
+        } else {
+            for (int i = begin; i < end; i++) systems[i].run(context);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Pool.h"
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+class JobPool;
+
+//
+//  Archetype storage and a scheduler for the systems that update it.
+//
+//  An archetype is one kind of entity with a fixed set of components. Its
+//  entities are stored as one contiguous column per field, densely packed
+//  and named by PoolHandles (see Pool.h). Archetype<> does the bookkeeping
+//  every archetype shares; the derived struct declares its columns, lists
+//  them in a static for_each_column(self, f) and states its COMPONENTS, so
+//  systems can find every archetype that has the components they work on.
+//
+//  Systems declare what they read and write as AccessMask bits (components
+//  and shared state alike). The scheduler groups them into stages in the
+//  order they are added: a system goes into the stage after the last
+//  earlier system it conflicts with, where two systems conflict if one
+//  writes anything the other reads or writes. Systems within a stage run
+//  concurrently, stages run one after another, so running them gives the
+//  same result as running the systems in the order they were added.
+//
+
+typedef uint32_t AccessMask;
+
+template <class Derived>
+struct Archetype {
+    PoolSlots slots;
+
+    int count() const { return slots.count(); }
+    int capacity() const { return slots.capacity(); }
+
+    PoolHandle handle(int i) const { return slots.handle_of(i); }
+    int index_of(PoolHandle handle) const { return slots.index_of(handle); }
+
+    // Appends an entity with every column value-initialized and returns its
+    // index, or -1 once the archetype is full; never reallocates
+    int append() {
+        if (count() >= capacity()) return -1;
+        slots.allocate();
+        Derived::for_each_column(derived(), [](auto& column) { column.emplace_back(); });
+        return count() - 1;
+    }
+
+    // Swap-and-pop: the last entity moves into i
+    void remove(int i) {
+        slots.release(i);
+        Derived::for_each_column(derived(), [i](auto& column) {
+            column[i] = column.back();
+            column.pop_back();
+        });
+    }
+
+    void clear() {
+        Derived::for_each_column(derived(), [](auto& column) { column.clear(); });
+        slots.clear();
+    }
+
+    void reserve(int n) {
+        Derived::for_each_column(derived(), [n](auto& column) { column.reserve(n); });
+        slots.reserve(n);
+    }
+
+    // Bytes save_state() writes: the slot table, then every column at its
+    // full capacity, so the layout depends on the capacity alone
+    size_t state_bytes() const {
+        size_t bytes = slots.state_bytes();
+        int n = capacity();
+        Derived::for_each_column(derived(), [&](const auto& column) { bytes += n * sizeof(column[0]); });
+        return bytes;
+    }
+
+    // Copies the entities out; the live part of each column only
+    void save_state(uint8_t* out) const {
+        slots.save_state(out);
+        out += slots.state_bytes();
+        int n = count(), cap = capacity();
+        Derived::for_each_column(derived(), [&](const auto& column) {
+            memcpy(out, column.data(), n * sizeof(column[0]));
+            out += cap * sizeof(column[0]);
+        });
+    }
+
+    // The reverse, without allocating; the capacity must be the one the
+    // state was saved with
+    void restore_state(const uint8_t* in) {
+        slots.restore_state(in);
+        in += slots.state_bytes();
+        int n = count(), cap = capacity();
+        Derived::for_each_column(derived(), [&](auto& column) {
+            column.resize(n);
+            memcpy(column.data(), in, n * sizeof(column[0]));
+            in += cap * sizeof(column[0]);
+        });
+    }
+
+private:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+    const Derived& derived() const { return static_cast<const Derived&>(*this); }
+};
+
+// One pass of the simulation; run() gets the context passed to
+// SystemScheduler::run()
+struct System {
+    const char* name;
+    AccessMask reads;
+    AccessMask writes;
+    void (*run)(void* context);
+};
+
+class SystemScheduler {
+public:
+    // Adds a system to run after the ones added so far
+    void add(const System& system);
+
+    // Runs every system once, the systems of a stage concurrently on pool;
+    // without a pool (or with one thread) everything runs inline. Phase
+    // time the systems record counts for the calling thread either way.
+    void run(void* context, JobPool* pool) const;
+
+    int stage_count() const { return (int)stageStart.size(); }
+    // Systems of stage s are system(i) for i in [stage_begin(s), stage_begin(s + 1))
+    int stage_begin(int s) const { return s < stage_count() ? stageStart[s] : (int)systems.size(); }
+    const System& system(int i) const { return systems[i]; }
+
+private:
+    std::vector<System> systems; // by stage, then in the order added
+    std::vector<int> stage;      // stage of each system
+    std::vector<int> stageStart;
+};
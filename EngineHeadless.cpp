@@ -0,0 +1,365 @@
+//
+//  Headless implementation of Engine.h, used instead of Engine.cpp on
+//  platforms without a window (Linux build and perf hosts, batch runs).
+//
+
+#include "Engine.h"
+#include "Headless.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] = { 0 };
+
+static bool keys[256] = { false };
+static bool mouse_buttons[2] = { false };
+static int cursor_x = 0;
+static int cursor_y = 0;
+static bool quited = false;
+
+bool is_window_active()
+{
+  return true;
+}
+
+void clear_buffer()
+{
+  memset(buffer, 0, sizeof(buffer));
+}
+
+bool is_key_pressed(int button_vk_code)
+{
+  if (button_vk_code < 0 || button_vk_code >= 256)
+    return false;
+
+  return keys[button_vk_code];
+}
+
+bool is_mouse_button_pressed(int mouse_button_index)
+{
+  if (mouse_button_index < 0 || mouse_button_index > 1)
+    return false;
+
+  return mouse_buttons[mouse_button_index];
+}
+
+int get_cursor_x()
+{
+  return cursor_x;
+}
+
+int get_cursor_y()
+{
+  return cursor_y;
+}
+
+void schedule_quit_game()
+{
+  quited = true;
+}
+
+void headless_set_key(int vk_code, bool down)
+{
+  if (vk_code >= 0 && vk_code < 256)
+    keys[vk_code] = down;
+}
+
+void headless_set_mouse_button(int button, bool down)
+{
+  if (button >= 0 && button <= 1)
+    mouse_buttons[button] = down;
+}
+
+void headless_set_cursor(int x, int y)
+{
+  cursor_x = x;
+  cursor_y = y;
+}
+
+void headless_reset_input()
+{
+  memset(keys, 0, sizeof(keys));
+  mouse_buttons[0] = mouse_buttons[1] = false;
+  cursor_x = cursor_y = 0;
+  quited = false;
+}
+
+bool headless_quit_scheduled()
+{
+  return quited;
+}
+
+bool headless_write_ppm(const char* path)
+{
+  FILE* f = fopen(path, "wb");
+  if (!f)
+    return false;
+
+  fprintf(f, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  static uint8_t row[SCREEN_WIDTH * 3];
+  for (int y = 0; y < SCREEN_HEIGHT; y++)
+  {
+    for (int x = 0; x < SCREEN_WIDTH; x++)
+    {
+      uint32_t c = buffer[y][x];
+      row[x * 3 + 0] = (uint8_t)(c >> 16);
+      row[x * 3 + 1] = (uint8_t)(c >> 8);
+      row[x * 3 + 2] = (uint8_t)c;
+    }
+    fwrite(row, 1, sizeof(row), f);
+  }
+
+  bool ok = ferror(f) == 0;
+  fclose(f);
+  return ok;
+}
+
+
+//
+//  Input script
+//
+
+void InputScript::add(const InputEvent& event)
+{
+  events.push_back(event);
+}
+
+void InputScript::key_down(double time, int vk_code)
+{
+  InputEvent e = { time, -1, InputEvent::KEY_DOWN, vk_code, 0, 0 };
+  add(e);
+}
+
+void InputScript::key_up(double time, int vk_code)
+{
+  InputEvent e = { time, -1, InputEvent::KEY_UP, vk_code, 0, 0 };
+  add(e);
+}
+
+void InputScript::quit(double time)
+{
+  InputEvent e = { time, -1, InputEvent::QUIT, 0, 0, 0 };
+  add(e);
+}
+
+int parse_key_name(const char* name)
+{
+  static const struct { const char* name; int code; } names[] =
+  {
+    { "ESCAPE", VK_ESCAPE },
+    { "ESC", VK_ESCAPE },
+    { "SPACE", VK_SPACE },
+    { "LEFT", VK_LEFT },
+    { "UP", VK_UP },
+    { "RIGHT", VK_RIGHT },
+    { "DOWN", VK_DOWN },
+    { "RETURN", VK_RETURN },
+    { "ENTER", VK_RETURN },
+  };
+
+  for (const auto& n : names)
+    if (strcmp(n.name, name) == 0)
+      return n.code;
+
+  if (name[0] && !name[1])
+    return toupper((unsigned char)name[0]);
+
+  char* end = nullptr;
+  long code = strtol(name, &end, 0);
+  if (end != name && *end == 0 && code >= 0 && code < 256)
+    return (int)code;
+
+  return -1;
+}
+
+bool InputScript::parse(const char* text, std::string* error)
+{
+  int line_number = 0;
+  const char* p = text;
+  while (*p)
+  {
+    line_number++;
+
+    const char* eol = strchr(p, '\n');
+    size_t len = eol ? (size_t)(eol - p) : strlen(p);
+    std::string line(p, len);
+    p += len + (eol ? 1 : 0);
+
+    size_t hash = line.find('#');
+    if (hash != std::string::npos)
+      line.resize(hash);
+
+    char when[32] = { 0 }, action[32] = { 0 }, arg0[32] = { 0 }, arg1[32] = { 0 };
+    int n = sscanf(line.c_str(), "%31s %31s %31s %31s", when, action, arg0, arg1);
+    if (n <= 0)
+      continue;
+
+    auto fail = [&](const char* what)
+    {
+      if (error)
+      {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "line %d: %s", line_number, what);
+        *error = msg;
+      }
+      return false;
+    };
+
+    if (n < 2)
+      return fail("expected '<when> <action>'");
+
+    InputEvent e = { 0.0, -1, InputEvent::QUIT, 0, 0, 0 };
+    char* end = nullptr;
+    if (when[0] == 'f')
+    {
+      e.frame = strtoll(when + 1, &end, 10);
+      if (end == when + 1 || *end || e.frame < 0)
+        return fail("bad frame index");
+    }
+    else
+    {
+      e.time = strtod(when, &end);
+      if (end == when || *end || e.time < 0.0)
+        return fail("bad time");
+    }
+
+    if (strcmp(action, "down") == 0 || strcmp(action, "up") == 0)
+    {
+      if (n < 3 || (e.code = parse_key_name(arg0)) < 0)
+        return fail("bad key name");
+      e.type = action[0] == 'd' ? InputEvent::KEY_DOWN : InputEvent::KEY_UP;
+    }
+    else if (strcmp(action, "mouse_down") == 0 || strcmp(action, "mouse_up") == 0)
+    {
+      if (n < 3 || sscanf(arg0, "%d", &e.code) != 1 || e.code < 0 || e.code > 1)
+        return fail("bad mouse button");
+      e.type = action[6] == 'd' ? InputEvent::MOUSE_DOWN : InputEvent::MOUSE_UP;
+    }
+    else if (strcmp(action, "cursor") == 0)
+    {
+      if (n < 4 || sscanf(arg0, "%d", &e.x) != 1 || sscanf(arg1, "%d", &e.y) != 1)
+        return fail("bad cursor position");
+      e.type = InputEvent::CURSOR;
+    }
+    else if (strcmp(action, "quit") == 0)
+    {
+      e.type = InputEvent::QUIT;
+    }
+    else
+    {
+      return fail("unknown action");
+    }
+
+    add(e);
+  }
+
+  return true;
+}
+
+bool InputScript::load(const char* path, std::string* error)
+{
+  FILE* f = fopen(path, "rb");
+  if (!f)
+  {
+    if (error)
+      *error = std::string("cannot open ") + path;
+    return false;
+  }
+
+  std::string text;
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    text.append(chunk, n);
+  fclose(f);
+
+  return parse(text.c_str(), error);
+}
+
+
+//
+//  Main loop
+//
+
+static void apply_event(const InputEvent& e)
+{
+  switch (e.type)
+  {
+  case InputEvent::KEY_DOWN:
+  case InputEvent::KEY_UP:
+    headless_set_key(e.code, e.type == InputEvent::KEY_DOWN);
+    break;
+  case InputEvent::MOUSE_DOWN:
+  case InputEvent::MOUSE_UP:
+    headless_set_mouse_button(e.code, e.type == InputEvent::MOUSE_DOWN);
+    break;
+  case InputEvent::CURSOR:
+    headless_set_cursor(e.x, e.y);
+    break;
+  case InputEvent::QUIT:
+    quited = true;
+    break;
+  }
+}
+
+HeadlessStats run_headless(const HeadlessConfig& config)
+{
+  HeadlessStats stats = { 0, 0.0, 0.0 };
+
+  headless_reset_input();
+
+  // same clamp as update_proc() in the window backend
+  float dt = config.dt;
+  if (dt > 0.1f)
+    dt = 0.1f;
+
+  // explicit clock: frame N starts at N * dt, independent of wall time,
+  // so every event resolves to the first frame starting at or after it
+  struct ScheduledEvent { uint64_t frame; InputEvent event; };
+  std::vector<ScheduledEvent> schedule;
+  if (config.script)
+  {
+    for (const InputEvent& e : config.script->events)
+    {
+      uint64_t frame = e.frame >= 0 ? (uint64_t)e.frame : (uint64_t)ceil(e.time / dt - 1e-6);
+      schedule.push_back({ frame, e });
+    }
+    std::stable_sort(schedule.begin(), schedule.end(),
+      [](const ScheduledEvent& a, const ScheduledEvent& b) { return a.frame < b.frame; });
+  }
+  size_t next_event = 0;
+
+  auto wall_start = std::chrono::steady_clock::now();
+
+  initialize();
+
+  while (!quited)
+  {
+    if (config.maxFrames && stats.frames >= config.maxFrames)
+      break;
+
+    while (next_event < schedule.size() && schedule[next_event].frame <= stats.frames)
+      apply_event(schedule[next_event++].event);
+
+    if (quited)
+      break;
+
+    act(dt);
+
+    if (!quited && config.drawFrames)
+      draw();
+
+    stats.frames++;
+  }
+
+  finalize();
+
+  stats.simSeconds = (double)stats.frames * dt;
+  stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  return stats;
+}
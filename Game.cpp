@@ -1,9 +1,18 @@
 #include "Engine.h"
+#include "Capture.h"
+#include "Game.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "Render.h"
+#include "Replay.h"
+#include "Simd.h"
+#include "SpatialGrid.h"
 #include <stdlib.h>
 #include <memory.h>
 #include <math.h>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <cstdio>
 
@@ -20,90 +29,84 @@
 //  is_window_active() - returns true if window is active
 //  schedule_quit_game() - quit game after act()
 
-// Game object structures
-struct Vector2 {
-    float x, y;
-    Vector2(float x = 0, float y = 0) : x(x), y(y) {}
-    Vector2 operator+(const Vector2& other) const { return Vector2(x + other.x, y + other.y); }
-    Vector2 operator-(const Vector2& other) const { return Vector2(x - other.x, y - other.y); }
-    Vector2 operator*(float scalar) const { return Vector2(x * scalar, y * scalar); }
-    float length() const { return sqrtf(x * x + y * y); }
-    Vector2 normalized() const { 
-        float len = length();
-        return len > 0 ? Vector2(x / len, y / len) : Vector2(0, 0);
-    }
-};
+// The world act() and draw() run
+World gameWorld;
 
-struct Ship {
-    Vector2 position;
-    Vector2 velocity;
-    float angle; // rotation angle in radians
-    float size;
-    bool alive;
-    
-    Ship() : position(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), velocity(0, 0), angle(0), size(10), alive(true) {}
-};
+// Profiler overlay, toggled with P; presentation only, not game state.
+// Read by the render thread when the pipeline runs.
+static std::atomic<bool> showProfileOverlay(false);
 
-struct Bullet {
-    Vector2 position;
-    Vector2 velocity;
-    float lifeTime;
-    bool active;
-    
-    Bullet() : position(0, 0), velocity(0, 0), lifeTime(0), active(false) {}
-};
+// Helper functions
+void draw_rect(int x, int y, int width, int height, uint32_t color) {
+    draw_rect_blended(x, y, width, height, color, BLEND_OPAQUE);
+}
 
-struct Asteroid {
-    Vector2 position;
-    Vector2 velocity;
-    float size;
-    bool active;
-    
-    Asteroid() : position(0, 0), velocity(0, 0), size(0), active(false) {}
-};
+void draw_rect_blended(int x, int y, int width, int height, uint32_t color, BlendMode blend) {
+    DrawCommand cmd = {};
+    cmd.type = DRAW_RECT;
+    cmd.color = color;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.width = width;
+    cmd.height = height;
+    cmd.blend = blend;
+    render_submit(cmd);
+}
 
-// Global game variables
-Ship player;
-std::vector<Bullet> bullets;
-std::vector<Asteroid> asteroids;
-int playerLives = 3;
-int score = 0;
-float shootCooldown = 0;
-bool gameOver = false;
-bool gameWon = false;
+void draw_circle(int centerX, int centerY, int radius, uint32_t color) {
+    draw_circle_blended(centerX, centerY, radius, color, BLEND_OPAQUE);
+}
 
-// Helper functions
-uint32_t make_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
-    return (a << 24) | (r << 16) | (g << 8) | b;
+void draw_circle_blended(int centerX, int centerY, int radius, uint32_t color, BlendMode blend) {
+    DrawCommand cmd = {};
+    cmd.type = DRAW_CIRCLE;
+    cmd.color = color;
+    cmd.x = centerX;
+    cmd.y = centerY;
+    cmd.width = radius;
+    cmd.blend = blend;
+    render_submit(cmd);
 }
 
-void draw_rect(int x, int y, int width, int height, uint32_t color) {
-    for (int dy = 0; dy < height; dy++) {
-        for (int dx = 0; dx < width; dx++) {
-            int px = x + dx;
-            int py = y + dy;
-            if (px >= 0 && px < SCREEN_WIDTH && py >= 0 && py < SCREEN_HEIGHT) {
-                buffer[py][px] = color;
-            }
-        }
-    }
+void draw_image(int x, int y, int width, int height, const uint32_t* pixels, BlendMode blend) {
+    DrawCommand cmd = {};
+    cmd.type = DRAW_IMAGE;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.width = width;
+    cmd.height = height;
+    cmd.pixels = pixels;
+    cmd.blend = blend;
+    render_submit(cmd);
 }
 
-void draw_circle(int centerX, int centerY, int radius, uint32_t color) {
-    for (int y = -radius; y <= radius; y++) {
-        for (int x = -radius; x <= radius; x++) {
-            if (x * x + y * y <= radius * radius) {
-                int px = centerX + x;
-                int py = centerY + y;
-                if (px >= 0 && px < SCREEN_WIDTH && py >= 0 && py < SCREEN_HEIGHT) {
-                    buffer[py][px] = color;
-                }
-            }
-        }
-    }
+void draw_sprite(int x, int y, const SpanSprite* sprite, uint32_t color) {
+    DrawCommand cmd = {};
+    cmd.type = DRAW_SPRITE;
+    cmd.color = color;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.sprite = sprite;
+    render_submit(cmd);
 }
 
-void draw_ship(const Ship& ship) {
+void draw_triangle(const Vector2& a, const Vector2& b, const Vector2& c, uint32_t color) {
+    DrawCommand cmd = {};
+    cmd.type = DRAW_TRIANGLE;
+    cmd.color = color;
+    cmd.vx[0] = a.x; cmd.vy[0] = a.y;
+    cmd.vx[1] = b.x; cmd.vy[1] = b.y;
+    cmd.vx[2] = c.x; cmd.vy[2] = c.y;
+    render_submit(cmd);
+}
+
+// Ship 0 is white as in single player; the others get a color each
+static const uint32_t SHIP_COLORS[MAX_SHIPS] = {
+    make_color(255, 255, 255), make_color(0, 200, 255), make_color(255, 128, 0), make_color(0, 255, 128),
+    make_color(255, 64, 192), make_color(255, 255, 0), make_color(160, 128, 255), make_color(255, 64, 64),
+};
+
+void draw_ship(const Ship& ship, uint32_t color) {
     if (!ship.alive) return;
     
     // Draw ship as triangle
@@ -117,37 +120,7 @@ void draw_ship(const Ship& ship) {
     Vector2 right(ship.position.x + cos_a * (-ship.size/2) - sin_a * ship.size/2, 
                   ship.position.y + sin_a * (-ship.size/2) + cos_a * ship.size/2);
     
-    // Simple triangle rendering (filled)
-    int minX = (int)fminf(fminf(nose.x, left.x), right.x);
-    int maxX = (int)fmaxf(fmaxf(nose.x, left.x), right.x);
-    int minY = (int)fminf(fminf(nose.y, left.y), right.y);
-    int maxY = (int)fmaxf(fmaxf(nose.y, left.y), right.y);
-    
-    for (int y = minY; y <= maxY; y++) {
-        for (int x = minX; x <= maxX; x++) {
-            // Simple point-in-triangle test
-            Vector2 p((float)x, (float)y);
-            Vector2 v0 = right - left;
-            Vector2 v1 = nose - left;
-            Vector2 v2 = p - left;
-            
-            float dot00 = v0.x * v0.x + v0.y * v0.y;
-            float dot01 = v0.x * v1.x + v0.y * v1.y;
-            float dot02 = v0.x * v2.x + v0.y * v2.y;
-            float dot11 = v1.x * v1.x + v1.y * v1.y;
-            float dot12 = v1.x * v2.x + v1.y * v2.y;
-            
-            float invDenom = 1 / (dot00 * dot11 - dot01 * dot01);
-            float u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-            float v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-            
-            if (u >= 0 && v >= 0 && u + v <= 1) {
-                if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
-                    buffer[y][x] = make_color(255, 255, 255); // White ship
-                }
-            }
-        }
-    }
+    draw_triangle(nose, left, right, color);
 }
 
 void wrap_position(Vector2& pos) {
@@ -160,581 +133,963 @@ void wrap_position(Vector2& pos) {
 bool check_collision(const Vector2& pos1, float size1, const Vector2& pos2, float size2) {
     float dx = pos1.x - pos2.x;
     float dy = pos1.y - pos2.y;
-    float distance = sqrtf(dx * dx + dy * dy);
-    return distance < (size1 + size2);
+    float reach = size1 + size2;
+    return dx * dx + dy * dy < reach * reach;
+}
+
+// The short way around an axis that wraps every size pixels
+static float wrap_offset(float offset, float size) {
+    if (offset > size * 0.5f) return offset - size;
+    if (offset < -size * 0.5f) return offset + size;
+    return offset;
+}
+
+static Vector2 wrap_offset(const Vector2& offset) {
+    return Vector2(wrap_offset(offset.x, (float)SCREEN_WIDTH), wrap_offset(offset.y, (float)SCREEN_HEIGHT));
+}
+
+float sweep_collision(const Vector2& start1, const Vector2& end1, float size1,
+                      const Vector2& start2, const Vector2& end2, float size2) {
+    // the second circle relative to the first: offset + motion * t, t in [0, 1]
+    Vector2 offset = wrap_offset(start2 - start1);
+    Vector2 motion = wrap_offset(end2 - start2) - wrap_offset(end1 - start1);
+    float reach = size1 + size2;
+    
+    // |offset + motion * t|^2 = reach^2 is a * t^2 + 2 * b * t + c = 0
+    float c = offset.x * offset.x + offset.y * offset.y - reach * reach;
+    if (c < 0) return 0.0f; // touching from the start
+    float a = motion.x * motion.x + motion.y * motion.y;
+    float b = offset.x * motion.x + offset.y * motion.y;
+    if (b >= 0 || a == 0) return -1.0f; // not closing in
+    
+    float discriminant = b * b - a * c;
+    if (discriminant < 0) return -1.0f; // passing by
+    float time = (-b - sqrtf(discriminant)) / a;
+    return time <= 1.0f ? time : -1.0f;
 }
 
 void draw_text(int x, int y, const char* text, uint32_t color) {
-    // Improved text rendering with more readable characters
-    int len = (int)strlen(text);
-    for (int i = 0; i < len; i++) {
-        int charX = x + i * 10; // Increase spacing between characters
-        
-        if (text[i] >= '0' && text[i] <= '9') {
-            int digit = text[i] - '0';
-            // Draw digits as more distinguishable shapes
-            switch (digit) {
-                case 0: // 0
-                    draw_rect(charX, y, 8, 2, color);     // top
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    draw_rect(charX, y, 2, 16, color);     // left
-                    draw_rect(charX + 6, y, 2, 16, color);  // right
-                    break;
-                case 1: // 1
-                    draw_rect(charX + 3, y, 2, 16, color);  // vertical line
-                    break;
-                case 2: // 2
-                    draw_rect(charX, y, 8, 2, color);      // top
-                    draw_rect(charX + 6, y + 2, 2, 6, color); // top right
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX, y + 10, 2, 6, color);  // bottom left
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-                case 3: // 3
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX + 6, y + 2, 2, 6, color); // top right
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // bottom right
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-                case 4: // 4
-                    draw_rect(charX, y, 2, 8, color);      // top left
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX + 6, y, 2, 16, color);  // right
-                    break;
-                case 5: // 5
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX, y + 2, 2, 6, color);   // top left
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // bottom right
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-                case 6: // 6
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX, y + 2, 2, 14, color);  // left (reduced height to avoid tail)
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // bottom right
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-                case 7: // 7
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX + 6, y + 2, 2, 14, color); // right
-                    break;
-                case 8: // 8
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX, y, 2, 16, color);      // left
-                    draw_rect(charX + 6, y, 2, 16, color);  // right
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-                case 9: // 9
-                    draw_rect(charX, y, 8, 2, color);       // top
-                    draw_rect(charX, y, 2, 8, color);       // top left
-                    draw_rect(charX + 6, y, 2, 16, color);  // right
-                    draw_rect(charX, y + 8, 8, 2, color);  // middle
-                    draw_rect(charX, y + 14, 8, 2, color); // bottom
-                    break;
-            }
-        } else if (text[i] >= 'A' && text[i] <= 'Z') {
-            // Simple letter rendering - draw recognizable letter shapes
-            char letter = text[i];
-            switch (letter) {
-                case 'L': // L
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y + 14, 8, 2, color);   // bottom horizontal
-                    break;
-                case 'I': // I
-                    draw_rect(charX + 3, y, 2, 16, color);  // vertical line
-                    break;
-                case 'V': // V
-                    draw_rect(charX, y, 2, 12, color);       // left diagonal
-                    draw_rect(charX + 6, y, 2, 12, color);   // right diagonal
-                    draw_rect(charX + 2, y + 12, 4, 2, color); // bottom point
-                    break;
-                case 'E': // E
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y + 7, 6, 2, color);   // middle horizontal
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                case 'S': // S
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y + 2, 2, 6, color);    // top left vertical
-                    draw_rect(charX, y + 8, 8, 2, color);   // middle horizontal
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // bottom right vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                case 'C': // C
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                case 'O': // O
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);   // right vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                case 'R': // R
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX + 6, y + 2, 2, 6, color); // right vertical
-                    draw_rect(charX, y + 8, 8, 2, color);   // middle horizontal
-                    draw_rect(charX + 4, y + 10, 2, 6, color); // diagonal
-                    break;
-                case 'F': // F
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y + 7, 6, 2, color);   // middle horizontal
-                    break;
-                case 'N': // N
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);  // right vertical
-                    draw_rect(charX + 2, y + 2, 2, 4, color); // diagonal
-                    draw_rect(charX + 4, y + 6, 2, 4, color); // diagonal
-                    break;
-                case 'A': // A
-                    draw_rect(charX + 2, y, 4, 2, color);      // top horizontal
-                    draw_rect(charX, y + 2, 2, 6, color);      // left diagonal
-                    draw_rect(charX + 6, y + 2, 2, 6, color);  // right diagonal
-                    draw_rect(charX, y + 8, 8, 2, color);      // middle horizontal (crossbar)
-                    draw_rect(charX, y + 10, 2, 6, color);     // left vertical (foot)
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // right vertical (foot)
-                    break;
-                case 'T': // T
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX + 3, y, 2, 16, color);  // vertical line
-                    break;
-                case 'Y': // Y
-                    draw_rect(charX + 1, y, 2, 6, color);   // left diagonal
-                    draw_rect(charX + 5, y, 2, 6, color);   // right diagonal
-                    draw_rect(charX + 3, y + 6, 2, 10, color); // vertical line
-                    break;
-                case 'G': // G
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    draw_rect(charX + 6, y + 8, 2, 8, color); // right vertical
-                    draw_rect(charX + 4, y + 8, 4, 2, color); // middle extension
-                    break;
-                case 'M': // M
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);  // right vertical
-                    draw_rect(charX + 2, y, 2, 6, color);    // left diagonal
-                    draw_rect(charX + 4, y, 2, 6, color);    // right diagonal
-                    break;
-                case 'P': // P
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX + 6, y + 2, 2, 6, color); // right vertical
-                    draw_rect(charX, y + 8, 8, 2, color);   // middle horizontal
-                    break;
-                case 'U': // U
-                    draw_rect(charX, y, 2, 14, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 14, color);  // right vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                case 'H': // H
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);  // right vertical
-                    draw_rect(charX, y + 8, 8, 2, color);   // middle horizontal
-                    break;
-                case 'D': // D
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 6, 2, color);       // top horizontal
-                    draw_rect(charX + 4, y + 2, 2, 12, color); // right vertical
-                    draw_rect(charX, y + 14, 6, 2, color);  // bottom horizontal
-                    break;
-                case 'B': // B
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX, y, 6, 2, color);       // top horizontal
-                    draw_rect(charX + 4, y + 2, 2, 6, color); // right vertical
-                    draw_rect(charX, y + 8, 6, 2, color);   // middle horizontal
-                    draw_rect(charX + 4, y + 10, 2, 6, color); // right vertical
-                    draw_rect(charX, y + 14, 6, 2, color);  // bottom horizontal
-                    break;
-                case 'J': // J
-                    draw_rect(charX + 4, y, 2, 12, color);  // vertical line
-                    draw_rect(charX, y + 12, 6, 2, color);  // bottom horizontal
-                    draw_rect(charX, y + 14, 2, 2, color);  // left hook
-                    break;
-                case 'K': // K
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 2, y + 6, 2, 2, color); // middle diagonal
-                    draw_rect(charX + 4, y + 4, 2, 2, color); // upper diagonal
-                    draw_rect(charX + 4, y + 8, 2, 2, color); // lower diagonal
-                    draw_rect(charX + 6, y + 2, 2, 2, color); // upper right
-                    draw_rect(charX + 6, y + 10, 2, 2, color); // lower right
-                    break;
-                case 'Q': // Q
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);  // right vertical
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    draw_rect(charX + 4, y + 10, 2, 6, color); // tail
-                    break;
-                case 'W': // W
-                    draw_rect(charX, y, 2, 16, color);      // left vertical
-                    draw_rect(charX + 6, y, 2, 16, color);  // right vertical
-                    draw_rect(charX + 2, y + 10, 2, 6, color); // left diagonal
-                    draw_rect(charX + 4, y + 10, 2, 6, color); // right diagonal
-                    break;
-                case 'X': // X
-                    draw_rect(charX, y, 2, 6, color);       // top left diagonal
-                    draw_rect(charX + 6, y, 2, 6, color);   // top right diagonal
-                    draw_rect(charX + 2, y + 6, 4, 2, color); // middle
-                    draw_rect(charX, y + 10, 2, 6, color);   // bottom left diagonal
-                    draw_rect(charX + 6, y + 10, 2, 6, color); // bottom right diagonal
-                    break;
-                case 'Z': // Z
-                    draw_rect(charX, y, 8, 2, color);       // top horizontal
-                    draw_rect(charX + 6, y + 2, 2, 2, color); // diagonal
-                    draw_rect(charX + 4, y + 4, 2, 2, color); // diagonal
-                    draw_rect(charX + 2, y + 6, 2, 2, color); // diagonal
-                    draw_rect(charX, y + 8, 2, 2, color);    // diagonal
-                    draw_rect(charX, y + 14, 8, 2, color);  // bottom horizontal
-                    break;
-                default:
-                    // Fallback for unsupported letters
-                    draw_rect(charX, y, 8, 16, color);
-                    break;
-            }
-        } else if (text[i] == ':') {
-            // Colon - two dots
-            draw_rect(charX + 3, y + 4, 2, 2, color);
-            draw_rect(charX + 3, y + 10, 2, 2, color);
-        }
-    }
+    DrawCommand cmd = {};
+    cmd.type = DRAW_TEXT;
+    cmd.color = color;
+    cmd.x = x;
+    cmd.y = y;
+    cmd.text = text;
+    render_submit(cmd);
 }
 
-void draw_lives(int lives, int x, int y) {
-    char livesText[8];
-    sprintf_s(livesText, "%d", lives);
+void draw_int(int x, int y, int value, uint32_t color) {
+    // Digits are written backwards from the end of the buffer
+    char text[12]; // "-2147483648"
+    char* p = text + sizeof(text);
+    *--p = '\0';
+    
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) *--p = '-';
     
+    draw_text(x, y, p, color);
+}
+
+void draw_lives(int lives, int x, int y) {
     // Black background for lives
     draw_rect(x - 5, y - 2, 30, 20, make_color(0, 0, 0));
     
     // White text
-    draw_text(x, y, livesText, make_color(255, 255, 255));
+    draw_int(x, y, lives, make_color(255, 255, 255));
 }
 
 void draw_score(int score, int x, int y) {
-    char scoreText[32];
-    sprintf_s(scoreText, "%d", score);
-    
     // Black background for score
     draw_rect(x - 5, y - 2, 100, 20, make_color(0, 0, 0));
     
     // White text
-    draw_text(x, y, scoreText, make_color(255, 255, 255));
+    draw_int(x, y, score, make_color(255, 255, 255));
+}
+
+// Random velocity components, in pixels per second. Every draw is a
+// statement of its own: the evaluation order of function arguments is up to
+// the compiler, and a seed must give the same asteroids with every build.
+static float random_drift(GameRandom& random) {
+    return (float)(random.below(200) - 100) / 3.0f;
+}
+
+static float random_inward_speed(GameRandom& random) {
+    return (float)(random.below(100) + 50) / 3.0f;
 }
 
-void spawn_asteroid() {
-    Asteroid asteroid;
-    asteroid.size = 15.0f + (float)(rand() % 15); // Size from 15 to 30 (smaller like original)
+void spawn_asteroid(World& world) {
+    Vector2 position, velocity;
+    float size = 15.0f + (float)world.random.below(15); // Size from 15 to 30 (smaller like original)
+    float drift;
     
     // Spawn at screen edges
-    int side = rand() % 4;
+    int side = world.random.below(4);
     switch (side) {
         case 0: // Top
-            asteroid.position = Vector2((float)(rand() % SCREEN_WIDTH), 0.0f);
-            asteroid.velocity = Vector2((float)(rand() % 200 - 100) / 3.0f, (float)(rand() % 100 + 50) / 3.0f);
+            position = Vector2((float)world.random.below(SCREEN_WIDTH), 0.0f);
+            drift = random_drift(world.random);
+            velocity = Vector2(drift, random_inward_speed(world.random));
             break;
         case 1: // Right
-            asteroid.position = Vector2((float)SCREEN_WIDTH, (float)(rand() % SCREEN_HEIGHT));
-            asteroid.velocity = Vector2(-(float)(rand() % 100 + 50) / 3.0f, (float)(rand() % 200 - 100) / 3.0f);
+            position = Vector2((float)SCREEN_WIDTH, (float)world.random.below(SCREEN_HEIGHT));
+            velocity.x = -random_inward_speed(world.random);
+            velocity.y = random_drift(world.random);
             break;
         case 2: // Bottom
-            asteroid.position = Vector2((float)(rand() % SCREEN_WIDTH), (float)SCREEN_HEIGHT);
-            asteroid.velocity = Vector2((float)(rand() % 200 - 100) / 3.0f, -(float)(rand() % 100 + 50) / 3.0f);
+            position = Vector2((float)world.random.below(SCREEN_WIDTH), (float)SCREEN_HEIGHT);
+            drift = random_drift(world.random);
+            velocity = Vector2(drift, -random_inward_speed(world.random));
             break;
         case 3: // Left
-            asteroid.position = Vector2(0.0f, (float)(rand() % SCREEN_HEIGHT));
-            asteroid.velocity = Vector2((float)(rand() % 100 + 50) / 3.0f, (float)(rand() % 200 - 100) / 3.0f);
+            position = Vector2(0.0f, (float)world.random.below(SCREEN_HEIGHT));
+            velocity.x = random_inward_speed(world.random);
+            velocity.y = random_drift(world.random);
             break;
     }
     
-    asteroid.active = true;
-    asteroids.push_back(asteroid);
+    world.asteroids.add(position, velocity, size);
 }
 
-
-// initialize game data in this function
-void initialize()
-{
-    // Initialize player
-    player = Ship();
-    
-    // Clear vectors
-    bullets.clear();
-    asteroids.clear();
-    
-    // Reset game variables
-    playerLives = 3; // Original Asteroids 1979: 3 lives
-    score = 0;
-    shootCooldown = 0;
-    gameOver = false;
-    gameWon = false;
-    
-    // Create initial asteroids (more like original)
-    for (int i = 0; i < 12; i++) {
-        spawn_asteroid();
-    }
+// A spawn the pool will have no room for is dropped right away, so the
+// queues never outgrow the pools; returns whether it was queued
+template <class Pool>
+static bool queue_spawn(const Pool& pool, std::vector<PendingSpawn>& queue,
+                        const Vector2& position, const Vector2& velocity, float value) {
+    if (pool.count() + (int)queue.size() >= pool.capacity()) return false;
+    PendingSpawn spawn = { position, velocity, value };
+    queue.push_back(spawn);
+    return true;
 }
 
-// this function is called to update game data,
-// dt - time elapsed since the previous update (in seconds)
-void act(float dt)
-{
-    if (is_key_pressed(VK_ESCAPE))
-        schedule_quit_game();
-    
-    // Reset gameWon if there are active asteroids
-    if (gameWon) {
-        bool hasActiveAsteroids = false;
-        for (const auto& asteroid : asteroids) {
-            if (asteroid.active) {
-                hasActiveAsteroids = true;
-                break;
-            }
-        }
-        if (hasActiveAsteroids) {
-            gameWon = false;
-        }
+static void apply_spawns(World& world) {
+    for (const PendingSpawn& spawn : world.pendingBullets) {
+        world.bullets.add(spawn.position, spawn.velocity, spawn.value);
     }
-    
-    if (gameOver || gameWon) {
-        if (is_key_pressed(VK_RETURN)) {
-            initialize(); // Restart game
-        }
-        return;
+    for (const PendingSpawn& spawn : world.pendingAsteroids) {
+        world.asteroids.add(spawn.position, spawn.velocity, spawn.value);
     }
+    world.pendingBullets.clear();
+    world.pendingAsteroids.clear();
+}
+
+
+// Effects: debris of a destroyed asteroid (particles per pixel of radius),
+// exhaust per tick of thrust, and the burst of a lost ship
+static const ParticleEmitter DEBRIS = { 20.0f, 160.0f, 6.2831853f, 0.4f, 1.2f, make_color(150, 120, 90) };
+static const ParticleEmitter SPARKS = { 80.0f, 260.0f, 6.2831853f, 0.2f, 0.6f, make_color(255, 200, 80) };
+static const ParticleEmitter EXHAUST = { 60.0f, 180.0f, 0.6f, 0.15f, 0.4f, make_color(255, 140, 40) };
+static const ParticleEmitter SHIP_BURST = { 40.0f, 300.0f, 6.2831853f, 0.8f, 2.0f, make_color(160, 220, 255) };
+static const float DEBRIS_PER_PIXEL = 8.0f;
+static const int SPARK_COUNT = 24;
+static const int EXHAUST_PER_TICK = 4;
+static const int SHIP_BURST_COUNT = 600;
+
+// Turn rate and braking, tuned as 0.2 rad and 0.5% of speed per 60 Hz frame
+static const float TURN_RATE = 12.0f;           // radians per second
+static const float BRAKE_PER_SECOND = 0.7403f;  // 0.995^60, speed kept per second of braking
+
+static void update_ship(World& world, Ship& ship, float dt, uint8_t input) {
+    PROFILE_PHASE(PHASE_INTEGRATION);
     
     // Ship controls
-    if (player.alive) {
-        // Turn left and right (fixed angle per key press)
-        if (is_key_pressed(VK_LEFT)) {
-            player.angle -= 0.2f; // 0.2 radians per key press
+    if (ship.alive) {
+        // Turn left and right
+        if (input & INPUT_LEFT) {
+            ship.angle -= TURN_RATE * dt;
         }
-        if (is_key_pressed(VK_RIGHT)) {
-            player.angle += 0.2f; // 0.2 radians per key press
+        if (input & INPUT_RIGHT) {
+            ship.angle += TURN_RATE * dt;
         }
         
         // Forward acceleration
-        if (is_key_pressed(VK_UP)) {
+        if (input & INPUT_UP) {
             float acceleration = 200.0f * dt; // pixels per second squared
-            Vector2 thrust(cosf(player.angle) * acceleration, sinf(player.angle) * acceleration);
-            player.velocity = player.velocity + thrust;
+            Vector2 thrust(cosf(ship.angle) * acceleration, sinf(ship.angle) * acceleration);
+            ship.velocity = ship.velocity + thrust;
             
             // Maximum speed limit (increased for more dynamic gameplay)
             float maxSpeed = 500.0f; // Increased from 300 to 500
-            if (player.velocity.length() > maxSpeed) {
-                player.velocity = player.velocity.normalized() * maxSpeed;
+            if (ship.velocity.length() > maxSpeed) {
+                ship.velocity = ship.velocity.normalized() * maxSpeed;
             }
+            
+            // exhaust out of the tail
+            float backX = -cosf(ship.angle), backY = -sinf(ship.angle);
+            world.particles.emit(EXHAUST, EXHAUST_PER_TICK, ship.position.x + backX * ship.size,
+                                 ship.position.y + backY * ship.size, ship.velocity.x, ship.velocity.y,
+                                 ship.angle + 3.14159265f);
         }
         
         // Backward acceleration (braking) - classic Asteroids style
-        if (is_key_pressed(VK_DOWN)) {
-            // Apply gentle friction to slow down gradually (0.5% per frame)
-            player.velocity = player.velocity * 0.995f;
+        if (input & INPUT_DOWN) {
+            // Apply gentle friction to slow down gradually
+            ship.velocity = ship.velocity * powf(BRAKE_PER_SECOND, dt);
         }
         
         // Apply constant friction (gradual slowdown) - disabled for debugging
         // player.velocity = player.velocity * 0.995f;
         
         // Shooting
-        shootCooldown -= dt;
-        if (is_key_pressed(VK_SPACE) && shootCooldown <= 0) {
-            Bullet bullet;
-            bullet.position = player.position;
-            bullet.velocity = Vector2(cosf(player.angle), sinf(player.angle)) * 500.0f; // Bullet speed
-            bullet.lifeTime = 3.0f; // Bullet lifetime
-            bullet.active = true;
-            bullets.push_back(bullet);
-            shootCooldown = 0.2f; // Cooldown between shots
+        ship.shootCooldown -= dt;
+        if ((input & INPUT_SPACE) && ship.shootCooldown <= 0) {
+            Vector2 velocity = Vector2(cosf(ship.angle), sinf(ship.angle)) * BULLET_SPEED;
+            // 3 s bullet lifetime; a full pool leaves the shot to the next tick
+            if (queue_spawn(world.bullets, world.pendingBullets, ship.position, velocity, 3.0f)) {
+                ship.shootCooldown = 0.2f; // Cooldown between shots
+            }
         }
         
         // Update ship position
-        player.position = player.position + player.velocity * dt;
-        wrap_position(player.position);
+        ship.position = ship.position + ship.velocity * dt;
+        wrap_position(ship.position);
     }
+}
+
+// Previous positions, integration and spin of every entity that has them
+static void move_entities(World& world, float dt) {
+    PROFILE_PHASE(PHASE_INTEGRATION);
     
-    // Update bullets
-    for (auto& bullet : bullets) {
-        if (bullet.active) {
-            bullet.position = bullet.position + bullet.velocity * dt;
-            bullet.lifeTime -= dt;
-            
-            if (bullet.lifeTime <= 0) {
-                bullet.active = false;
-            }
-            
-            wrap_position(bullet.position);
+    world.for_each_archetype<ACCESS_POSITION | ACCESS_PREVIOUS_POSITION>([](auto& entities) {
+        entities.prevX = entities.x;
+        entities.prevY = entities.y;
+    });
+    world.for_each_archetype<ACCESS_POSITION | ACCESS_VELOCITY>([dt](auto& entities) {
+        integrate_wrap(entities.x.data(), entities.y.data(), entities.vx.data(), entities.vy.data(), entities.count(), dt);
+    });
+    world.for_each_archetype<ACCESS_ROTATION>([dt](auto& entities) {
+        for (int i = 0; i < entities.count(); i++) {
+            float angle = entities.angle[i] + entities.spin[i] * dt;
+            if (angle >= TWO_PI) angle -= TWO_PI;
+            if (angle < 0) angle += TWO_PI;
+            entities.angle[i] = angle;
         }
+    });
+}
+
+// Spent entities keep moving until they are removed at the end of the tick
+static void age_entities(World& world, float dt) {
+    PROFILE_PHASE(PHASE_INTEGRATION);
+    
+    world.for_each_archetype<ACCESS_LIFETIME>([dt](auto& entities) {
+        decrement(entities.lifeTime.data(), entities.count(), dt);
+    });
+}
+
+// Grid cells: the mean radius of a spawned asteroid (15 to 29) plus the
+// reach of a bullet over one tick
+static const float ASTEROID_GRID_CELL = 22.0f + BULLET_RADIUS + BULLET_SPEED * SIM_TICK * 0.5f;
+
+static void build_asteroid_grid(World& world) {
+    world.asteroidDestroyed.assign(world.asteroids.count(), 0);
+    world.destroyedAsteroids.clear();
+    
+    // Entries cover everything an asteroid swept over the last tick. Cells
+    // are sized for the path of a bullet; the ships' queries span more cells.
+    const AsteroidArray& asteroids = world.asteroids;
+    world.asteroidGrid.build(asteroids.count(), ASTEROID_GRID_CELL, [&asteroids](int i) {
+        Vector2 motion = wrap_offset(Vector2(asteroids.x[i] - asteroids.prevX[i], asteroids.y[i] - asteroids.prevY[i]));
+        SpatialGrid::Entry e = { asteroids.x[i], asteroids.y[i], asteroids.size[i] + motion.length(), i };
+        return e;
+    });
+}
+
+// Returns the surviving asteroid that a circle moving from start to end
+// over the last tick touches first, or -1. time gets the fraction of the
+// tick at which they touch; ties go to the lowest index.
+static int find_colliding_asteroid(const World& world, const Vector2& start, const Vector2& end, float size, float& time) {
+    const AsteroidArray& asteroids = world.asteroids;
+    Vector2 path = wrap_offset(end - start);
+    Vector2 middle = start + path * 0.5f;
+    
+    float reach = size + path.length() * 0.5f;
+    
+    int hit = -1;
+    time = 2.0f;
+    world.asteroidGrid.query(middle.x, middle.y, reach, [&](const SpatialGrid::Entry& e) {
+        if (time == 0 && e.item > hit) return; // nothing touches earlier
+        
+        // the grid passes only entries whose circles overlap the reach, so
+        // most candidates are ruled out before the sweep looks them up
+        int i = e.item;
+        if (world.asteroidDestroyed[i]) return;
+        float t = sweep_collision(start, end, size, Vector2(asteroids.prevX[i], asteroids.prevY[i]),
+                                  Vector2(asteroids.x[i], asteroids.y[i]), asteroids.size[i]);
+        if (t < 0 || t > time || (t == time && i > hit)) return;
+        hit = i;
+        time = t;
+    });
+    return hit;
+}
+
+static void collide_bullets_with_asteroids(World& world) {
+    PROFILE_PHASE(PHASE_BULLET_COLLISIONS);
+    
+    build_asteroid_grid(world);
+    
+    // Check bullet-asteroid collisions
+    for (int b = 0; b < world.bullets.count(); b++) {
+        if (world.bullets.lifeTime[b] <= 0) continue;
+        
+        Vector2 bulletStart(world.bullets.prevX[b], world.bullets.prevY[b]);
+        Vector2 bulletEnd(world.bullets.x[b], world.bullets.y[b]);
+        float time;
+        int hit = find_colliding_asteroid(world, bulletStart, bulletEnd, BULLET_RADIUS, time);
+        if (hit < 0) continue;
+        
+        Vector2 impact = bulletStart + wrap_offset(bulletEnd - bulletStart) * time;
+        wrap_position(impact);
+        
+        world.bullets.lifeTime[b] = 0; // spent
+        world.asteroidDestroyed[hit] = 1;
+        world.destroyedAsteroids.push_back(hit);
+        
+        Vector2 position(world.asteroids.x[hit], world.asteroids.y[hit]);
+        float size = world.asteroids.size[hit];
+        
+        world.particles.emit(DEBRIS, (int)(size * DEBRIS_PER_PIXEL), position.x, position.y,
+                             world.asteroids.vx[hit], world.asteroids.vy[hit], 0.0f);
+        world.particles.emit(SPARKS, SPARK_COUNT, impact.x, impact.y, 0.0f, 0.0f, 0.0f);
     }
+}
+
+// Points for the asteroids shot this tick
+static void score_hits(World& world) {
+    PROFILE_PHASE(PHASE_BULLET_COLLISIONS);
     
-    // Update asteroids
-    for (auto& asteroid : asteroids) {
-        if (asteroid.active) {
-            asteroid.position = asteroid.position + asteroid.velocity * dt;
-            wrap_position(asteroid.position);
+    for (int hit : world.destroyedAsteroids) {
+        // Add points based on asteroid size
+        // Large asteroids give more points
+        float size = world.asteroids.size[hit];
+        if (size > 40) {
+            world.score += 100; // Large asteroids
+        } else if (size > 25) {
+            world.score += 50;  // Medium asteroids
+        } else {
+            world.score += 20;  // Small asteroids
         }
     }
+}
+
+// Queues the pieces of the asteroids shot this tick, in the order they were hit
+static void split_hits(World& world) {
+    PROFILE_PHASE(PHASE_BULLET_COLLISIONS);
     
-    // Check bullet-asteroid collisions
-    for (auto& bullet : bullets) {
-        if (!bullet.active) continue;
+    for (int hit : world.destroyedAsteroids) {
+        // Create smaller asteroids if asteroid is big enough
+        Vector2 position(world.asteroids.x[hit], world.asteroids.y[hit]);
+        float size = world.asteroids.size[hit];
+        if (size > 15) { // Split if larger than 15 (was 20)
+            for (int i = 0; i < 2; i++) {
+                Vector2 velocity;
+                velocity.x = random_drift(world.random);
+                velocity.y = random_drift(world.random);
+                queue_spawn(world.asteroids, world.pendingAsteroids, position, velocity, size * 0.6f);
+            }
+        }
+    }
+}
+
+// Ships start side by side across the middle of the screen; a single ship
+// starts in the center
+static Vector2 spawn_point(int ship, int shipCount) {
+    return Vector2((float)SCREEN_WIDTH * (ship + 1) / (shipCount + 1), (float)(SCREEN_HEIGHT / 2));
+}
+
+static void collide_ship_with_asteroids(World& world) {
+    PROFILE_PHASE(PHASE_SHIP_COLLISIONS);
+    
+    // Check ship-asteroid collisions; the ships share the lives
+    for (int s = 0; s < world.shipCount; s++) {
+        Ship& ship = world.ships[s];
+        float time;
+        if (!ship.alive || find_colliding_asteroid(world, ship.prevPosition, ship.position, ship.size, time) < 0) continue;
         
-        for (auto& asteroid : asteroids) {
-            if (!asteroid.active) continue;
-            
-            if (check_collision(bullet.position, 2, asteroid.position, asteroid.size)) {
-                bullet.active = false;
-                asteroid.active = false;
-                
-                // Add points based on asteroid size
-                // Large asteroids give more points
-                if (asteroid.size > 40) {
-                    score += 100; // Large asteroids
-                } else if (asteroid.size > 25) {
-                    score += 50;  // Medium asteroids
-                } else {
-                    score += 20;  // Small asteroids
-                }
-                
-                // Create smaller asteroids if asteroid is big enough
-                if (asteroid.size > 15) { // Split if larger than 15 (was 20)
-                    for (int i = 0; i < 2; i++) {
-                        Asteroid newAsteroid;
-                        newAsteroid.position = asteroid.position;
-                        newAsteroid.size = asteroid.size * 0.6f;
-                        newAsteroid.velocity = Vector2((float)(rand() % 200 - 100) / 3.0f, (float)(rand() % 200 - 100) / 3.0f);
-                        newAsteroid.active = true;
-                        asteroids.push_back(newAsteroid);
-                    }
-                }
-                break;
+        world.playerLives--;
+        ship.alive = false;
+        world.particles.emit(SHIP_BURST, SHIP_BURST_COUNT, ship.position.x, ship.position.y,
+                             ship.velocity.x, ship.velocity.y, 0.0f);
+        
+        if (world.playerLives <= 0) {
+            world.gameOver = true;
+        } else {
+            // Respawn ship after 2 seconds
+            ship.position = spawn_point(s, world.shipCount);
+            ship.prevPosition = ship.position; // no interpolation across the jump
+            ship.velocity = Vector2(0, 0);
+            ship.alive = true;
+            world.gameOver = false; // Reset gameOver on respawn
+        }
+    }
+}
+
+static void remove_destroyed_objects(World& world) {
+    PROFILE_PHASE(PHASE_COMPACTION);
+    
+    // Remove spent entities; walking backwards keeps swap-and-pop from
+    // moving an unvisited entity into an already visited slot
+    world.for_each_archetype<ACCESS_LIFETIME>([](auto& entities) {
+        for (int i = entities.count() - 1; i >= 0; i--) {
+            if (entities.lifeTime[i] <= 0) {
+                entities.remove(i);
             }
         }
+    });
+    
+    // Remove destroyed asteroids, highest index first for the same reason
+    std::sort(world.destroyedAsteroids.begin(), world.destroyedAsteroids.end());
+    for (int k = (int)world.destroyedAsteroids.size() - 1; k >= 0; k--) {
+        world.asteroids.remove(world.destroyedAsteroids[k]);
+    }
+    world.destroyedAsteroids.clear();
+}
+
+// Starts a new game in the world, from its seed
+void reset_world(World& world)
+{
+    // Initialize the ships
+    for (int s = 0; s < MAX_SHIPS; s++) {
+        world.ships[s] = Ship();
+        world.ships[s].position = spawn_point(s, world.shipCount);
+        world.ships[s].prevPosition = world.ships[s].position;
     }
     
-    // Check ship-asteroid collisions
-    if (player.alive) {
-        for (const auto& asteroid : asteroids) {
-            if (!asteroid.active) continue;
-            
-            if (check_collision(player.position, player.size, asteroid.position, asteroid.size)) {
-                playerLives--;
-                player.alive = false;
-                
-                if (playerLives <= 0) {
-                    gameOver = true;
-                } else {
-                    // Respawn ship after 2 seconds
-                    player.position = Vector2(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
-                    player.velocity = Vector2(0, 0);
-                    player.alive = true;
-                    gameOver = false; // Reset gameOver on respawn
-                }
+    // Clear the pools; reserving up front keeps the frame loop free of
+    // allocations (a no-op on restart)
+    world.bullets.reserve(MAX_BULLETS);
+    world.asteroids.reserve(MAX_ASTEROIDS);
+    world.bullets.clear();
+    world.asteroids.clear();
+    world.particles.clear();
+    world.pendingBullets.clear();
+    world.pendingAsteroids.clear();
+    world.pendingBullets.reserve(MAX_BULLETS);
+    world.pendingAsteroids.reserve(MAX_ASTEROIDS);
+    world.asteroidDestroyed.reserve(MAX_ASTEROIDS);
+    world.destroyedAsteroids.reserve(MAX_ASTEROIDS);
+    world_systems(); // built on first use, which allocates
+    
+    // Reset game variables
+    world.playerLives = 3; // Original Asteroids 1979: 3 lives
+    world.score = 0;
+    world.gameOver = false;
+    world.gameWon = false;
+    world.tickAccumulator = 0;
+    world.random.seed(world.seed);
+    
+    // Create initial asteroids (more like original)
+    for (int i = 0; i < 12; i++) {
+        spawn_asteroid(world);
+    }
+}
+
+// initialize game data in this function
+void initialize()
+{
+    asteroid_sprites_build();
+    gameWorld.particles.reserve(PARTICLE_CAPACITY);
+    reset_world(gameWorld);
+}
+
+// Keys the game reads and their INPUT_* bits
+static const struct {
+    int key;
+    uint8_t bit;
+} INPUT_KEYS[] = {
+    { VK_LEFT, INPUT_LEFT },
+    { VK_RIGHT, INPUT_RIGHT },
+    { VK_UP, INPUT_UP },
+    { VK_DOWN, INPUT_DOWN },
+    { VK_SPACE, INPUT_SPACE },
+    { VK_RETURN, INPUT_RETURN },
+    { VK_ESCAPE, INPUT_ESCAPE },
+};
+
+uint8_t input_bit(int vkCode)
+{
+    for (const auto& k : INPUT_KEYS) {
+        if (k.key == vkCode) return k.bit;
+    }
+    return 0;
+}
+
+uint8_t sample_input()
+{
+    uint8_t input = 0;
+    for (const auto& k : INPUT_KEYS) {
+        if (is_key_pressed(k.key)) input |= k.bit;
+    }
+    return input;
+}
+
+// One act() worth of game logic, driven only by dt and the input of every ship
+void step_world(World& world, float dt, const uint8_t* inputs)
+{
+    // Reset gameWon if there are asteroids left
+    if (world.gameWon && world.asteroids.count() > 0) {
+        world.gameWon = false;
+    }
+    
+    // effects keep playing on the game over and victory screens
+    world.particles.update(dt);
+    
+    if (world.gameOver || world.gameWon) {
+        for (int s = 0; s < world.shipCount; s++) {
+            if (inputs[s] & INPUT_RETURN) {
+                reset_world(world); // Restart game
                 break;
             }
         }
+        return;
     }
     
-    // Check victory condition (all asteroids destroyed)
-    bool allAsteroidsDestroyed = true;
-    for (const auto& asteroid : asteroids) {
-        if (asteroid.active) {
-            allAsteroidsDestroyed = false;
+    // Fixed-rate simulation: run the ticks that fit into the elapsed time and
+    // carry the remainder over. Past MAX_TICKS_PER_ACT the backlog is dropped,
+    // so a slow frame slows the game down instead of snowballing.
+    world.tickAccumulator += dt;
+    int ticks = 0;
+    while (world.tickAccumulator >= SIM_TICK && ticks < MAX_TICKS_PER_ACT) {
+        simulate_tick(world, inputs);
+        world.tickAccumulator -= SIM_TICK;
+        ticks++;
+        
+        if (world.gameOver || world.gameWon) {
+            world.tickAccumulator = 0;
             break;
         }
     }
+    if (world.tickAccumulator >= SIM_TICK) {
+        world.tickAccumulator = fmodf(world.tickAccumulator, SIM_TICK);
+    }
+}
+
+// this function is called to update game data,
+// dt - time elapsed since the previous update (in seconds)
+void act(float dt)
+{
+    // the replay state and gameWorld are the simulation thread's until its
+    // step is done
+    pipeline_wait_step();
     
-    if (allAsteroidsDestroyed) {
-        gameWon = true;
+    // A replayed session supplies both the input and the frame time
+    uint8_t input;
+    if (replay_playing()) {
+        if (!replay_next_frame(dt, input)) {
+            schedule_quit_game();
+            return;
+        }
+    } else {
+        input = sample_input();
     }
     
-    // Remove inactive objects
-    bullets.erase(std::remove_if(bullets.begin(), bullets.end(), 
-        [](const Bullet& b) { return !b.active; }), bullets.end());
+    if (input & INPUT_ESCAPE)
+        schedule_quit_game();
+    
+    // P toggles the profiler overlay; not game input, so not recorded
+    static bool overlayKeyWasDown = false;
+    bool overlayKey = is_key_pressed('P');
+    if (overlayKey && !overlayKeyWasDown) showProfileOverlay = !showProfileOverlay;
+    overlayKeyWasDown = overlayKey;
+    
+    // C starts and stops capturing frames to capture.ascp
+    static bool captureKeyWasDown = false;
+    bool captureKey = is_key_pressed('C');
+    if (captureKey && !captureKeyWasDown) {
+        if (capture_active()) capture_end(nullptr);
+        else capture_begin("capture.ascp", CaptureConfig(), nullptr);
+    }
+    captureKeyWasDown = captureKey;
     
-    asteroids.erase(std::remove_if(asteroids.begin(), asteroids.end(), 
-        [](const Asteroid& a) { return !a.active; }), asteroids.end());
+    // T switches between sequential and pipelined frames
+    static bool pipelineKeyWasDown = false;
+    bool pipelineKey = is_key_pressed('T');
+    if (pipelineKey && !pipelineKeyWasDown) pipeline_set_enabled(!pipeline_enabled());
+    pipelineKeyWasDown = pipelineKey;
+    
+    if (pipeline_enabled()) pipeline_submit(dt, input);
+    else step_game(dt, input);
 }
 
-// fill buffer in this function
-// uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] - is an array of 32-bit colors (8 bits per R, G, B)
-void draw()
+void step_game(float dt, uint8_t input)
 {
-    // clear backbuffer
-    memset(buffer, 0, SCREEN_HEIGHT * SCREEN_WIDTH * sizeof(uint32_t));
+    {
+        PROFILE_PHASE(ZONE_ACT);
+        step_world(gameWorld, dt, input);
+    }
+    replay_end_frame(dt, input, hash_world(gameWorld));
     
-    // Draw asteroids
-    for (const auto& asteroid : asteroids) {
-        if (asteroid.active) {
-            draw_circle((int)asteroid.position.x, (int)asteroid.position.y, (int)asteroid.size, make_color(128, 128, 128)); // Gray asteroids
-        }
+    PROFILE_COUNTER(COUNTER_ASTEROIDS, gameWorld.asteroids.count());
+    PROFILE_COUNTER(COUNTER_BULLETS, gameWorld.bullets.count());
+    PROFILE_COUNTER(COUNTER_PARTICLES, gameWorld.particles.count());
+}
+
+//
+//  The systems of a tick
+//
+//  Declared with what they read and write, in the order the game has always
+//  run them; world_systems() puts the ones that do not conflict into the
+//  same stage. Ships keep their own array, indexed by player, so the ship
+//  systems work on it directly rather than through an archetype.
+//
+
+struct TickContext {
+    World* world;
+    const uint8_t* inputs;
+};
+
+static void control_system(void* context) {
+    TickContext& tick = *(TickContext*)context;
+    World& world = *tick.world;
+    for (int s = 0; s < world.shipCount; s++) {
+        Ship& ship = world.ships[s];
+        ship.prevPosition = ship.position;
+        ship.prevAngle = ship.angle;
+        update_ship(world, ship, SIM_TICK, tick.inputs[s]);
+    }
+}
+
+static void movement_system(void* context) {
+    move_entities(*((TickContext*)context)->world, SIM_TICK);
+}
+
+static void lifetime_system(void* context) {
+    age_entities(*((TickContext*)context)->world, SIM_TICK);
+}
+
+static void collision_system(void* context) {
+    World& world = *((TickContext*)context)->world;
+    collide_bullets_with_asteroids(world);
+    collide_ship_with_asteroids(world);
+}
+
+static void scoring_system(void* context) {
+    score_hits(*((TickContext*)context)->world);
+}
+
+static void splitting_system(void* context) {
+    split_hits(*((TickContext*)context)->world);
+}
+
+static void spawning_system(void* context) {
+    World& world = *((TickContext*)context)->world;
+    remove_destroyed_objects(world);
+    apply_spawns(world);
+    
+    // Check victory condition (all asteroids destroyed)
+    if (world.asteroids.count() == 0) {
+        world.gameWon = true;
     }
+}
+
+static const AccessMask ALL_COMPONENTS = ACCESS_POSITION | ACCESS_PREVIOUS_POSITION | ACCESS_VELOCITY |
+                                         ACCESS_LIFETIME | ACCESS_RADIUS | ACCESS_ROTATION;
+
+static SystemScheduler build_world_systems() {
+    const System systems[] = {
+        { "control", ACCESS_ENTITIES, ACCESS_SHIPS | ACCESS_SPAWNS | ACCESS_PARTICLES, control_system },
+        { "movement", ACCESS_ENTITIES | ACCESS_VELOCITY,
+          ACCESS_POSITION | ACCESS_PREVIOUS_POSITION | ACCESS_ROTATION, movement_system },
+        { "lifetime", ACCESS_ENTITIES, ACCESS_LIFETIME, lifetime_system },
+        { "collision", ACCESS_ENTITIES | ACCESS_POSITION | ACCESS_PREVIOUS_POSITION | ACCESS_VELOCITY | ACCESS_RADIUS,
+          ACCESS_LIFETIME | ACCESS_SHIPS | ACCESS_SCORE | ACCESS_HITS | ACCESS_PARTICLES, collision_system },
+        { "scoring", ACCESS_HITS | ACCESS_RADIUS, ACCESS_SCORE, scoring_system },
+        { "splitting", ACCESS_ENTITIES | ACCESS_HITS | ACCESS_POSITION | ACCESS_RADIUS,
+          ACCESS_RANDOM | ACCESS_SPAWNS, splitting_system },
+        { "spawning", ALL_COMPONENTS | ACCESS_HITS,
+          ALL_COMPONENTS | ACCESS_ENTITIES | ACCESS_SPAWNS | ACCESS_HITS | ACCESS_SCORE, spawning_system },
+    };
     
-    // Draw bullets
-    for (const auto& bullet : bullets) {
-        if (bullet.active) {
-            draw_rect((int)bullet.position.x - 1, (int)bullet.position.y - 1, 3, 3, make_color(255, 255, 0)); // Yellow bullets
+    SystemScheduler scheduler;
+    for (const System& system : systems) scheduler.add(system);
+    return scheduler;
+}
+
+const SystemScheduler& world_systems() {
+    static const SystemScheduler scheduler = build_world_systems();
+    return scheduler;
+}
+
+// Advances the world by one SIM_TICK
+void simulate_tick(World& world, const uint8_t* inputs)
+{
+    PROFILE_PHASE(ZONE_TICK);
+    
+    TickContext tick = { &world, inputs };
+    world_systems().run(&tick, world.systemPool);
+}
+
+// FNV-1a over the bytes of a value or an array
+static void hash_bytes(uint32_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+template <class T>
+static void hash_value(uint32_t& hash, const T& value) {
+    hash_bytes(hash, &value, sizeof(value));
+}
+
+static void hash_array(uint32_t& hash, const std::vector<float>& values) {
+    hash_value(hash, (uint32_t)values.size());
+    hash_bytes(hash, values.data(), values.size() * sizeof(float));
+}
+
+// Hash of everything step_world() reads or writes, compared bit for bit;
+// the previous-tick positions are left out, they only feed drawing
+uint32_t hash_world(const World& world)
+{
+    uint32_t hash = 2166136261u;
+    hash_value(hash, world.shipCount);
+    for (int s = 0; s < world.shipCount; s++) {
+        const Ship& ship = world.ships[s];
+        hash_value(hash, ship.position.x);
+        hash_value(hash, ship.position.y);
+        hash_value(hash, ship.velocity.x);
+        hash_value(hash, ship.velocity.y);
+        hash_value(hash, ship.angle);
+        hash_value(hash, ship.alive);
+        hash_value(hash, ship.shootCooldown);
+    }
+    
+    hash_array(hash, world.bullets.x);
+    hash_array(hash, world.bullets.y);
+    hash_array(hash, world.bullets.vx);
+    hash_array(hash, world.bullets.vy);
+    hash_array(hash, world.bullets.lifeTime);
+    hash_array(hash, world.asteroids.x);
+    hash_array(hash, world.asteroids.y);
+    hash_array(hash, world.asteroids.vx);
+    hash_array(hash, world.asteroids.vy);
+    hash_array(hash, world.asteroids.size);
+    
+    hash_value(hash, world.playerLives);
+    hash_value(hash, world.score);
+    hash_value(hash, world.gameOver);
+    hash_value(hash, world.gameWon);
+    hash_value(hash, world.tickAccumulator);
+    hash_value(hash, world.random.state);
+    return hash;
+}
+
+// Position between the last two ticks; objects that wrapped around the
+// screen during the tick are drawn where they are now
+static float interpolate_coordinate(float previous, float current, float alpha, float limit) {
+    float delta = current - previous;
+    if (fabsf(delta) > limit * 0.5f) return current;
+    return previous + delta * alpha;
+}
+
+static float interpolation_alpha(const World& world) {
+    return world.tickAccumulator / SIM_TICK;
+}
+
+static const uint32_t ASTEROID_COLOR = make_color(128, 128, 128);
+
+void draw_asteroids(const World& world) {
+    PROFILE_PHASE(PHASE_ASTEROID_RASTER);
+    
+    // Draw asteroids
+    float alpha = interpolation_alpha(world);
+    for (int i = 0; i < world.asteroids.count(); i++) {
+        float x = interpolate_coordinate(world.asteroids.prevX[i], world.asteroids.x[i], alpha, (float)SCREEN_WIDTH);
+        float y = interpolate_coordinate(world.asteroids.prevY[i], world.asteroids.y[i], alpha, (float)SCREEN_HEIGHT);
+        
+        // the angle is interpolated back from the end of the tick; sizes
+        // outside the sprite cache fall back to circles
+        float angle = world.asteroids.angle[i] - world.asteroids.spin[i] * SIM_TICK * (1.0f - alpha);
+        const SpanSprite* sprite = asteroid_sprite(world.asteroids.shape[i], world.asteroids.size[i], angle);
+        if (sprite) {
+            draw_sprite((int)x, (int)y, sprite, ASTEROID_COLOR);
+        } else {
+            draw_circle((int)x, (int)y, (int)world.asteroids.size[i], ASTEROID_COLOR);
         }
     }
+}
+
+void draw_bullets(const World& world) {
+    PROFILE_PHASE(PHASE_BULLET_RASTER);
     
-    // Draw ship
-    if (player.alive) {
-        draw_ship(player);
+    // Draw bullets
+    float alpha = interpolation_alpha(world);
+    for (int i = 0; i < world.bullets.count(); i++) {
+        float x = interpolate_coordinate(world.bullets.prevX[i], world.bullets.x[i], alpha, (float)SCREEN_WIDTH);
+        float y = interpolate_coordinate(world.bullets.prevY[i], world.bullets.y[i], alpha, (float)SCREEN_HEIGHT);
+        draw_rect((int)x - 1, (int)y - 1, 3, 3, make_color(255, 255, 0)); // Yellow bullets
     }
+}
+
+// Game over and victory panels darken what is behind them by half
+static const uint32_t PANEL_COLOR = premultiply(make_color(0, 0, 0, 128));
+
+void draw_hud(const World& world) {
+    PROFILE_PHASE(PHASE_HUD_TEXT);
     
     // Draw UI
     // Lives - display as "LIVES: X"
     draw_text(10, 10, "LIVES:", make_color(255, 255, 255));
-    draw_lives(playerLives, 70, 10); // Increased distance from 60 to 70
+    draw_lives(world.playerLives, 70, 10); // Increased distance from 60 to 70
     
     // Score - display as "SCORE: XXXX"
     draw_text(SCREEN_WIDTH - 150, 10, "SCORE:", make_color(255, 255, 255));
-    draw_score(score, SCREEN_WIDTH - 50, 10);
+    draw_score(world.score, SCREEN_WIDTH - 50, 10);
     
     // Draw Game Over and Victory screens
-    if (gameOver && playerLives <= 0) {
+    if (world.gameOver && world.playerLives <= 0) {
         // Semi-transparent black background
-        for (int y = SCREEN_HEIGHT/2 - 50; y < SCREEN_HEIGHT/2 + 50; y++) {
-            for (int x = SCREEN_WIDTH/2 - 100; x < SCREEN_WIDTH/2 + 100; x++) {
-                if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
-                    buffer[y][x] = make_color(0, 0, 0, 128);
-                }
-            }
-        }
+        draw_rect_blended(SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2 - 50, 200, 100, PANEL_COLOR, BLEND_OVER);
         
         // "GAME OVER" text and final score
         draw_text(SCREEN_WIDTH/2 - 40, SCREEN_HEIGHT/2 - 45, "GAME OVER", make_color(255, 0, 0));
         draw_text(SCREEN_WIDTH/2 - 30, SCREEN_HEIGHT/2 - 15, "FINAL SCORE:", make_color(255, 255, 255));
-        draw_score(score, SCREEN_WIDTH/2 - 10, SCREEN_HEIGHT/2 + 8);
+        draw_score(world.score, SCREEN_WIDTH/2 - 10, SCREEN_HEIGHT/2 + 8);
         draw_text(SCREEN_WIDTH/2 - 20, SCREEN_HEIGHT/2 + 38, "PRESS ENTER", make_color(255, 255, 255));
     }
     
-    if (gameWon && asteroids.size() == 0) {
+    if (world.gameWon && world.asteroids.count() == 0) {
         // Semi-transparent black background
-        for (int y = SCREEN_HEIGHT/2 - 50; y < SCREEN_HEIGHT/2 + 50; y++) {
-            for (int x = SCREEN_WIDTH/2 - 100; x < SCREEN_WIDTH/2 + 100; x++) {
-                if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
-                    buffer[y][x] = make_color(0, 0, 0, 128);
-                }
-            }
-        }
+        draw_rect_blended(SCREEN_WIDTH/2 - 100, SCREEN_HEIGHT/2 - 50, 200, 100, PANEL_COLOR, BLEND_OVER);
         
         // "VICTORY!" text and final score
         draw_text(SCREEN_WIDTH/2 - 30, SCREEN_HEIGHT/2 - 45, "VICTORY!", make_color(0, 255, 0));
         draw_text(SCREEN_WIDTH/2 - 30, SCREEN_HEIGHT/2 - 15, "FINAL SCORE:", make_color(255, 255, 255));
-        draw_score(score, SCREEN_WIDTH/2 - 10, SCREEN_HEIGHT/2 + 8);
+        draw_score(world.score, SCREEN_WIDTH/2 - 10, SCREEN_HEIGHT/2 + 8);
         draw_text(SCREEN_WIDTH/2 - 20, SCREEN_HEIGHT/2 + 38, "PRESS ENTER", make_color(255, 255, 255));
     }
 }
 
+// Rolling per-phase times of the last PROFILE_WINDOW frames (microseconds,
+// mean and max) and the object counts, below the lives display
+static void draw_profile_overlay(const World& world) {
+    PROFILE_PHASE(PHASE_HUD_TEXT);
+    
+    // The font has capitals only and no underscore; phases are indented
+    // under the zone that encloses them
+    static const struct {
+        int label;
+        const char* name;
+    } LINES[] = {
+        { ZONE_ACT, "ACT" },
+        { ZONE_TICK, "TICK" },
+        { PHASE_INTEGRATION, " INTEGRATION" },
+        { PHASE_BULLET_COLLISIONS, " BULLET COLLISIONS" },
+        { PHASE_SHIP_COLLISIONS, " SHIP COLLISIONS" },
+        { PHASE_COMPACTION, " COMPACTION" },
+        { PHASE_PARTICLE_UPDATE, " PARTICLE UPDATE" },
+        { ZONE_DRAW, "DRAW" },
+        { PHASE_CLEAR, " CLEAR" },
+        { PHASE_ASTEROID_RASTER, " ASTEROID RASTER" },
+        { PHASE_BULLET_RASTER, " BULLET RASTER" },
+        { PHASE_SHIP_RASTER, " SHIP RASTER" },
+        { PHASE_PARTICLE_RASTER, " PARTICLE RASTER" },
+        { PHASE_HUD_TEXT, " HUD TEXT" },
+        { PHASE_BAND_RASTER, " BAND RASTER" },
+        { PHASE_CAPTURE, " CAPTURE" },
+    };
+    const int lineHeight = GLYPH_HEIGHT + 2;
+    const int timedLines = PROFILE_ENABLED ? (int)(sizeof(LINES) / sizeof(LINES[0])) + 1 : 1;
+    const int x = 10, y = 40;
+    const int meanX = x + 19 * GLYPH_ADVANCE, maxX = x + 26 * GLYPH_ADVANCE, countX = x + 11 * GLYPH_ADVANCE;
+    draw_rect(x - 4, y - 4, 31 * GLYPH_ADVANCE + 8, (timedLines + 4) * lineHeight + 6, make_color(0, 0, 0));
+    
+    const uint32_t color = make_color(255, 255, 0);
+    int row = 0;
+    if (PROFILE_ENABLED) {
+        draw_text(x, y, "TIME US", color);
+        draw_text(meanX, y, "MEAN", color);
+        draw_text(maxX, y, "MAX", color);
+        for (const auto& line : LINES) {
+            uint64_t mean, max;
+            profile_rolling(line.label, mean, max);
+            
+            int lineY = y + ++row * lineHeight;
+            draw_text(x, lineY, line.name, color);
+            draw_int(meanX, lineY, (int)(mean / 1000), color);
+            draw_int(maxX, lineY, (int)(max / 1000), color);
+        }
+    } else {
+        draw_text(x, y, "PROFILE OFF", color);
+    }
+    
+    const int counts[] = { world.asteroids.count(), world.bullets.count(), world.shipCount, world.particles.count() };
+    const char* countNames[] = { "ASTEROIDS", "BULLETS", "SHIPS", "PARTICLES" };
+    for (int i = 0; i < 4; i++) {
+        int lineY = y + ++row * lineHeight;
+        draw_text(x, lineY, countNames[i], color);
+        draw_int(countX, lineY, counts[i], color);
+    }
+}
+
+void set_profile_overlay(bool show) {
+    showProfileOverlay = show;
+}
+
+void draw_world(const World& world)
+{
+    // clear backbuffer
+    {
+        PROFILE_PHASE(PHASE_CLEAR);
+        render_begin_frame(); // only what the last frame drew
+    }
+    
+    draw_asteroids(world);
+    world.particles.draw();
+    draw_bullets(world);
+    
+    // Draw ships
+    {
+        PROFILE_PHASE(PHASE_SHIP_RASTER);
+        
+        float alpha = interpolation_alpha(world);
+        for (int s = 0; s < world.shipCount; s++) {
+            const Ship& ship = world.ships[s];
+            if (!ship.alive) continue;
+            
+            Ship shown = ship;
+            shown.position.x = interpolate_coordinate(ship.prevPosition.x, ship.position.x, alpha, (float)SCREEN_WIDTH);
+            shown.position.y = interpolate_coordinate(ship.prevPosition.y, ship.position.y, alpha, (float)SCREEN_HEIGHT);
+            shown.angle = ship.prevAngle + (ship.angle - ship.prevAngle) * alpha;
+            draw_ship(shown, SHIP_COLORS[s]);
+        }
+    }
+    
+    draw_hud(world);
+    if (showProfileOverlay) draw_profile_overlay(world);
+    
+    // banded mode rasterizes everything here
+    {
+        PROFILE_PHASE(PHASE_BAND_RASTER);
+        render_end_frame();
+    }
+}
+
+// fill buffer in this function
+// uint32_t buffer[SCREEN_HEIGHT][SCREEN_WIDTH] - is an array of 32-bit colors (8 bits per R, G, B)
+void draw()
+{
+    {
+        PROFILE_PHASE(ZONE_DRAW);
+        
+        // pipelined: show the frame the render thread finished, start the next
+        if (pipeline_enabled()) pipeline_present();
+        else draw_world(gameWorld);
+        
+        if (capture_active()) {
+            PROFILE_PHASE(PHASE_CAPTURE);
+            capture_frame();
+        }
+    }
+    PROFILE_END_FRAME();
+}
+
 // free game data in this function
 void finalize()
 {
+    pipeline_set_enabled(false);
+    capture_end(nullptr);
 }
 
@@ -0,0 +1,324 @@
+#pragma once
+
+#include "AsteroidSprites.h"
+#include "Ecs.h"
+#include "Engine.h"
+#include "Particles.h"
+#include "Pool.h"
+#include "Raster.h"
+#include "SpatialGrid.h"
+#include <math.h>
+#include <vector>
+
+//
+//  Game state and helpers shared by Game.cpp and the tools built on it
+//  (benchmarks, headless runners).
+//
+
+// Game object structures
+struct Vector2 {
+    float x, y;
+    Vector2(float x = 0, float y = 0) : x(x), y(y) {}
+    Vector2 operator+(const Vector2& other) const { return Vector2(x + other.x, y + other.y); }
+    Vector2 operator-(const Vector2& other) const { return Vector2(x - other.x, y - other.y); }
+    Vector2 operator*(float scalar) const { return Vector2(x * scalar, y * scalar); }
+    float length() const { return sqrtf(x * x + y * y); }
+    Vector2 normalized() const { 
+        float len = length();
+        return len > 0 ? Vector2(x / len, y / len) : Vector2(0, 0);
+    }
+};
+
+struct Ship {
+    Vector2 position;
+    Vector2 velocity;
+    float angle; // rotation angle in radians
+    float size;
+    bool alive;
+    float shootCooldown; // seconds until the ship can fire again
+    
+    // State at the start of the last simulation tick, for interpolation
+    Vector2 prevPosition;
+    float prevAngle;
+    
+    Ship() : position(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2), velocity(0, 0), angle(0), size(10), alive(true),
+             shootCooldown(0), prevPosition(position), prevAngle(angle) {}
+};
+
+// What the world's systems read and write (see Ecs.h): entity components
+// first, then the rest of the world
+enum WorldAccess : AccessMask {
+    ACCESS_POSITION = 0x0001,
+    ACCESS_PREVIOUS_POSITION = 0x0002, // position at the start of the last tick
+    ACCESS_VELOCITY = 0x0004,
+    ACCESS_LIFETIME = 0x0008,
+    ACCESS_RADIUS = 0x0010,
+    ACCESS_ROTATION = 0x0020,
+    ACCESS_ENTITIES = 0x0040,  // which entities exist; adding or removing any writes it
+    ACCESS_SHIPS = 0x0080,
+    ACCESS_SCORE = 0x0100,     // score, lives and the end of the game
+    ACCESS_RANDOM = 0x0200,
+    ACCESS_SPAWNS = 0x0400,    // spawns queued for the end of the tick
+    ACCESS_HITS = 0x0800,      // the collision pass's grid and destroyed asteroids
+    ACCESS_PARTICLES = 0x1000
+};
+
+// Bullets and asteroids are archetypes: structures of arrays with one
+// contiguous column per field, so the integration and collision loops only
+// touch the fields they use. Removal moves the last element into the hole
+// (swap-and-pop), so element order is not stable; a PoolHandle keeps
+// naming the same element (see Pool.h).
+//
+// The pools have a fixed capacity set by reserve(): add() never reallocates
+// and fails with -1 once the pool is full.
+struct BulletArray : Archetype<BulletArray> {
+    static const AccessMask COMPONENTS = ACCESS_POSITION | ACCESS_PREVIOUS_POSITION | ACCESS_VELOCITY | ACCESS_LIFETIME;
+    
+    std::vector<float> x, y;
+    std::vector<float> prevX, prevY;
+    std::vector<float> vx, vy;
+    std::vector<float> lifeTime; // spent bullets are removed at the end of the tick
+    
+    template <class Self, class F>
+    static void for_each_column(Self& self, F&& f) {
+        f(self.x); f(self.y);
+        f(self.prevX); f(self.prevY);
+        f(self.vx); f(self.vy);
+        f(self.lifeTime);
+    }
+    
+    int add(const Vector2& position, const Vector2& velocity, float life) {
+        int i = append();
+        if (i < 0) return -1;
+        x[i] = prevX[i] = position.x;
+        y[i] = prevY[i] = position.y;
+        vx[i] = velocity.x;
+        vy[i] = velocity.y;
+        lifeTime[i] = life;
+        return i;
+    }
+};
+
+const float TWO_PI = 6.2831853f;
+
+// Fastest an asteroid spins, radians per second either way
+const float ASTEROID_MAX_SPIN = 1.2f;
+
+struct AsteroidArray : Archetype<AsteroidArray> {
+    static const AccessMask COMPONENTS = ACCESS_POSITION | ACCESS_PREVIOUS_POSITION | ACCESS_VELOCITY |
+                                         ACCESS_RADIUS | ACCESS_ROTATION;
+    
+    std::vector<float> x, y;
+    std::vector<float> prevX, prevY;
+    std::vector<float> vx, vy;
+    std::vector<float> size;
+    // Drawing only: collisions use the size, which bounds every outline
+    std::vector<float> angle, spin;  // radians, radians per second
+    std::vector<uint8_t> shape;      // outline, see AsteroidSprites.h
+    
+    template <class Self, class F>
+    static void for_each_column(Self& self, F&& f) {
+        f(self.x); f(self.y);
+        f(self.prevX); f(self.prevY);
+        f(self.vx); f(self.vy);
+        f(self.size);
+        f(self.angle); f(self.spin);
+        f(self.shape);
+    }
+    
+    int add(const Vector2& position, const Vector2& velocity, float radius) {
+        int i = append();
+        if (i < 0) return -1;
+        x[i] = prevX[i] = position.x;
+        y[i] = prevY[i] = position.y;
+        vx[i] = velocity.x;
+        vy[i] = velocity.y;
+        size[i] = radius;
+        
+        // the look is picked from the handle, so spawning draws nothing
+        // from the game's random numbers
+        PoolHandle self = handle(i);
+        uint32_t h = self.slot * 0x9E3779B1u ^ self.generation * 0x85EBCA77u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        angle[i] = (float)(h & 0xFFFF) * (TWO_PI / 65536.0f);
+        spin[i] = ((float)((h >> 16) & 0xFF) / 127.5f - 1.0f) * ASTEROID_MAX_SPIN;
+        shape[i] = (uint8_t)((h >> 24) % ASTEROID_SHAPES);
+        return i;
+    }
+};
+
+// The simulation advances in fixed ticks of SIM_TICK seconds; act() runs as
+// many as the elapsed time needs, at most MAX_TICKS_PER_ACT per call
+// (0.1 s, the longest dt the engine passes)
+const float SIM_TICK = 1.0f / 120.0f;
+const int MAX_TICKS_PER_ACT = 12;
+
+// Game-local random numbers (PCG32). Unlike rand() the sequence depends only
+// on the seed, so a seed and the input reproduce a whole session.
+struct GameRandom {
+    uint64_t state;
+    
+    GameRandom() : state(0) { seed(1); }
+    
+    void seed(uint32_t value) {
+        state = 0;
+        next();
+        state += value;
+        next();
+    }
+    
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + 1442695040888963407ull;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+    
+    // Uniform enough for gameplay in [0, n)
+    int below(int n) { return (int)(next() % (uint32_t)n); }
+};
+
+// Keys the game reads, sampled once per act() call
+enum InputBit {
+    INPUT_LEFT = 0x01,
+    INPUT_RIGHT = 0x02,
+    INPUT_UP = 0x04,
+    INPUT_DOWN = 0x08,
+    INPUT_SPACE = 0x10,
+    INPUT_RETURN = 0x20,
+    INPUT_ESCAPE = 0x40
+};
+
+// Ships in one world; a multiplayer session gives every player one
+const int MAX_SHIPS = 8;
+
+// Pool capacities of the game; spawns beyond them are dropped. A ship has
+// at most 16 bullets in flight (3 s lifetime, 0.2 s cooldown), a game at
+// most 48 asteroids (12 that split twice), and every world reserves these
+// up front, so they are kept small.
+const int MAX_BULLETS = MAX_SHIPS * 16 + 32;
+const int MAX_ASTEROIDS = 256;
+
+// Particles gameWorld reserves; other worlds have none and skip effects
+const int PARTICLE_CAPACITY = 1 << 17;
+
+// Bullet collision radius and speed (pixels, pixels per second)
+const float BULLET_RADIUS = 2.0f;
+const float BULLET_SPEED = 500.0f;
+
+// A spawn requested during a tick, applied once the tick's passes are done
+// so no pass sees a pool change under it
+struct PendingSpawn {
+    Vector2 position;
+    Vector2 velocity;
+    float value; // bullet lifetime or asteroid radius
+};
+
+// Everything one game session owns. Worlds share no state, so any number
+// of them can exist and be stepped on different threads at once.
+struct World {
+    Ship ships[MAX_SHIPS];
+    int shipCount;         // ships in play, set before reset_world()
+    BulletArray bullets;
+    AsteroidArray asteroids;
+    int playerLives;       // shared by all ships
+    int score;
+    bool gameOver;
+    bool gameWon;
+    float tickAccumulator; // simulated time owed to step_world(), below SIM_TICK between calls
+    GameRandom random;
+    uint32_t seed;         // reset_world() reseeds random with it
+    ParticleSystem particles; // effects only: not hashed, not replicated
+    
+    // Scratch space of the tick passes, kept so ticks do not allocate
+    SpatialGrid asteroidGrid;                // asteroids as they were when the collision pass started
+    std::vector<uint8_t> asteroidDestroyed;  // per asteroid, during the collision pass
+    std::vector<int> destroyedAsteroids;     // removed at the end of the tick
+    std::vector<PendingSpawn> pendingBullets;
+    std::vector<PendingSpawn> pendingAsteroids;
+    
+    // Runs the systems of a tick stage by stage (see world_systems()); null
+    // runs them inline, as worlds stepped on a pool's threads must
+    JobPool* systemPool;
+    
+    World() : shipCount(1), playerLives(3), score(0), gameOver(false), gameWon(false),
+              tickAccumulator(0), seed(1), systemPool(nullptr) {}
+    
+    // Calls f on every archetype with all of the components; a new kind of
+    // entity is added here so the systems pick it up
+    template <AccessMask Components, class F>
+    void for_each_archetype(F&& f) {
+        if constexpr ((BulletArray::COMPONENTS & Components) == Components) f(bullets);
+        if constexpr ((AsteroidArray::COMPONENTS & Components) == Components) f(asteroids);
+    }
+    
+    template <AccessMask Components, class F>
+    void for_each_archetype(F&& f) const {
+        if constexpr ((BulletArray::COMPONENTS & Components) == Components) f(bullets);
+        if constexpr ((AsteroidArray::COMPONENTS & Components) == Components) f(asteroids);
+    }
+};
+
+// The world act() and draw() run
+extern World gameWorld;
+
+// Helper functions
+inline uint32_t make_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+void draw_rect(int x, int y, int width, int height, uint32_t color);
+void draw_circle(int centerX, int centerY, int radius, uint32_t color);
+// Blended variants take premultiplied colors and images (premultiply() in
+// Simd.h); an image's pixels must stay valid until the frame is drawn
+void draw_rect_blended(int x, int y, int width, int height, uint32_t color, BlendMode blend);
+void draw_circle_blended(int centerX, int centerY, int radius, uint32_t color, BlendMode blend);
+void draw_image(int x, int y, int width, int height, const uint32_t* pixels, BlendMode blend);
+void draw_sprite(int x, int y, const SpanSprite* sprite, uint32_t color); // sprite must outlive the frame
+void draw_triangle(const Vector2& a, const Vector2& b, const Vector2& c, uint32_t color);
+void draw_ship(const Ship& ship, uint32_t color);
+void draw_text(int x, int y, const char* text, uint32_t color);
+void draw_int(int x, int y, int value, uint32_t color);
+void wrap_position(Vector2& pos);
+bool check_collision(const Vector2& pos1, float size1, const Vector2& pos2, float size2);
+// Earliest fraction of a tick, in [0, 1], at which two circles moving in
+// straight lines from start to end touch, or -1 if they do not. Motions and
+// offsets go the short way around the wrapped screen, so a circle crossing
+// an edge is not swept back across the whole screen.
+float sweep_collision(const Vector2& start1, const Vector2& end1, float size1,
+                      const Vector2& start2, const Vector2& end2, float size2);
+
+// World simulation; touches nothing outside the world, so it is safe to
+// run for different worlds concurrently
+void reset_world(World& world);
+void step_world(World& world, float dt, const uint8_t* inputs); // one input byte per ship
+void simulate_tick(World& world, const uint8_t* inputs);
+// The systems simulate_tick() runs, in stages
+const SystemScheduler& world_systems();
+void spawn_asteroid(World& world);
+uint32_t hash_world(const World& world);
+
+// INPUT_* bit of a virtual key code, 0 for keys the game ignores
+uint8_t input_bit(int vkCode);
+uint8_t sample_input();
+
+// One act() worth of game logic on gameWorld, input already sampled: the
+// step, the replay check and the profile counters
+void step_game(float dt, uint8_t input);
+
+// Draws a world into the render target; draw() runs it on gameWorld, or
+// the pipeline's render thread on a published copy
+void draw_world(const World& world);
+
+// Shows rolling phase timings and object counts over the game (also
+// toggled with P); timings need an ASTEROIDS_PROFILE build
+void set_profile_overlay(bool show);
+
+// Single-player step: the input drives ship 0
+inline void step_world(World& world, float dt, uint8_t input) {
+    uint8_t inputs[MAX_SHIPS] = { input };
+    step_world(world, dt, inputs);
+}
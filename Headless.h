@@ -0,0 +1,82 @@
+#pragma once
+
+//
+//  Headless backend: implements Engine.h without a window.
+//  Input comes from a scripted timeline, time from an explicit clock.
+//
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct InputEvent {
+    enum Type {
+        KEY_DOWN,
+        KEY_UP,
+        MOUSE_DOWN,
+        MOUSE_UP,
+        CURSOR,
+        QUIT
+    };
+
+    double time;   // seconds of simulated time, ignored when frame >= 0
+    int64_t frame; // frame index the event applies to, -1 to use time
+    Type type;
+    int code;      // virtual key code or mouse button index
+    int x, y;      // cursor position for CURSOR events
+};
+
+// Scripted input timeline. Each event is applied right before the act()
+// call of the first frame that starts at or after its time; events that
+// resolve to the same frame are applied in the order they were added.
+struct InputScript {
+    std::vector<InputEvent> events;
+
+    void add(const InputEvent& event);
+    void key_down(double time, int vk_code);
+    void key_up(double time, int vk_code);
+    void quit(double time);
+
+    // Text format, one event per line, '#' starts a comment:
+    //   <when> down <KEY>      key pressed
+    //   <when> up <KEY>        key released
+    //   <when> mouse_down <0|1>
+    //   <when> mouse_up <0|1>
+    //   <when> cursor <x> <y>
+    //   <when> quit
+    // <when> is seconds (1.5) or a frame index prefixed with 'f' (f90).
+    // <KEY> is ESCAPE, SPACE, LEFT, UP, RIGHT, DOWN, RETURN, a single
+    // character ('A') or a numeric code (0x41).
+    bool parse(const char* text, std::string* error);
+    bool load(const char* path, std::string* error);
+};
+
+int parse_key_name(const char* name);
+
+struct HeadlessConfig {
+    float dt;                   // fixed frame time passed to act()
+    uint64_t maxFrames;         // 0 - run until quit is scheduled
+    bool drawFrames;            // call draw() after act(), like the window backend
+    const InputScript* script;  // may be null
+
+    HeadlessConfig() : dt(1.0f / 60.0f), maxFrames(0), drawFrames(true), script(nullptr) {}
+};
+
+struct HeadlessStats {
+    uint64_t frames;
+    double simSeconds;
+    double wallSeconds;
+};
+
+// Runs initialize(), the act()/draw() loop and finalize().
+HeadlessStats run_headless(const HeadlessConfig& config);
+
+// Direct input control for programs that drive act()/draw() themselves.
+void headless_set_key(int vk_code, bool down);
+void headless_set_mouse_button(int button, bool down);
+void headless_set_cursor(int x, int y);
+void headless_reset_input();
+bool headless_quit_scheduled();
+
+// Writes the backbuffer as a binary PPM image.
+bool headless_write_ppm(const char* path);
@@ -0,0 +1,346 @@
+//
+//  Entry point of the headless build:
+//    asteroids_headless [--frames N] [--dt SECONDS] [--script FILE]
+//                       [--no-draw] [--ppm FILE] [--render-threads N]
+//                       [--pipeline] [--sim-threads N]
+//                       [--seed N] [--record FILE | --replay FILE]
+//                       [--overlay] [--trace FILE]
+//                       [--capture FILE [--capture-block] [--capture-raw]
+//                        [--capture-pool N]]
+//    asteroids_headless --unpack FILE FRAME --ppm FILE
+//
+
+#include "Engine.h"
+#include "Capture.h"
+#include "Game.h"
+#include "Headless.h"
+#include "JobPool.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "Render.h"
+#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void print_usage()
+{
+  fprintf(stderr,
+    "usage: asteroids_headless [options]\n"
+    "  --frames N      stop after N frames (default: run until quit)\n"
+    "  --dt SECONDS    fixed frame time passed to act() (default 0.016667)\n"
+    "  --script FILE   scripted input timeline\n"
+    "  --no-draw       skip draw(), simulate only\n"
+    "  --ppm FILE      write the last frame as a PPM image\n"
+    "  --render-threads N  banded rendering on N threads (default 0: immediate)\n"
+    "  --pipeline      simulate and render on their own threads, overlapping frames\n"
+    "  --sim-threads N run each tick's independent systems concurrently on N threads\n"
+    "  --seed N        world seed (default 1)\n"
+    "  --record FILE   record the session's input, frame times and state hashes\n"
+    "  --replay FILE   replay a recorded session and check its state hashes\n"
+    "  --overlay       draw the profiler overlay\n"
+    "  --trace FILE    write the profiled scopes as Chrome trace JSON (ASTEROIDS_PROFILE builds)\n"
+    "  --capture FILE  write every drawn frame on a background thread\n"
+    "  --capture-block wait for the writer instead of dropping frames\n"
+    "  --capture-raw   store frames uncompressed\n"
+    "  --capture-pool N  frame buffers in flight (default 4)\n"
+    "  --unpack FILE FRAME  decode a captured frame for --ppm and exit\n");
+}
+
+// Decodes captured frame number FRAME into the back buffer and writes it
+static int unpack(const char* path, long frame, const char* ppm_path)
+{
+  if (!ppm_path)
+  {
+    fprintf(stderr, "--unpack needs --ppm\n");
+    return 1;
+  }
+
+  std::string error;
+  std::vector<CapturedFrame> frames;
+  if (!capture_read_index(path, frames, &error))
+  {
+    fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return 1;
+  }
+
+  size_t stored = 0;
+  while (stored < frames.size() && (long)frames[stored].frame != frame)
+    stored++;
+  if (stored == frames.size())
+  {
+    fprintf(stderr, "%s: frame %ld was not captured\n", path, frame);
+    return 1;
+  }
+
+  if (!capture_read_frame(path, frames, stored, &buffer[0][0], &error))
+  {
+    fprintf(stderr, "%s: %s\n", path, error.c_str());
+    return 1;
+  }
+  if (!headless_write_ppm(ppm_path))
+  {
+    fprintf(stderr, "cannot write %s\n", ppm_path);
+    return 1;
+  }
+  printf("unpacked frame=%ld stored_frames=%zu\n", frame, frames.size());
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  HeadlessConfig config;
+  InputScript script;
+  const char* ppm_path = nullptr;
+  const char* record_path = nullptr;
+  const char* replay_path = nullptr;
+  const char* trace_path = nullptr;
+  const char* capture_path = nullptr;
+  CaptureConfig capture;
+  const char* unpack_path = nullptr;
+  long unpack_frame = -1;
+  uint32_t seed = 1;
+  bool pipeline = false;
+  int sim_threads = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+    if (strcmp(arg, "--frames") == 0 && value)
+    {
+      config.maxFrames = strtoull(value, nullptr, 10);
+      i++;
+    }
+    else if (strcmp(arg, "--dt") == 0 && value)
+    {
+      config.dt = (float)atof(value);
+      i++;
+    }
+    else if (strcmp(arg, "--script") == 0 && value)
+    {
+      std::string error;
+      if (!script.load(value, &error))
+      {
+        fprintf(stderr, "%s: %s\n", value, error.c_str());
+        return 1;
+      }
+      config.script = &script;
+      i++;
+    }
+    else if (strcmp(arg, "--no-draw") == 0)
+    {
+      config.drawFrames = false;
+    }
+    else if (strcmp(arg, "--ppm") == 0 && value)
+    {
+      ppm_path = value;
+      i++;
+    }
+    else if (strcmp(arg, "--render-threads") == 0 && value)
+    {
+      render_set_threads(atoi(value));
+      i++;
+    }
+    else if (strcmp(arg, "--pipeline") == 0)
+    {
+      pipeline = true;
+    }
+    else if (strcmp(arg, "--sim-threads") == 0 && value)
+    {
+      sim_threads = atoi(value);
+      i++;
+    }
+    else if (strcmp(arg, "--seed") == 0 && value)
+    {
+      seed = (uint32_t)strtoul(value, nullptr, 10);
+      i++;
+    }
+    else if (strcmp(arg, "--record") == 0 && value)
+    {
+      record_path = value;
+      i++;
+    }
+    else if (strcmp(arg, "--replay") == 0 && value)
+    {
+      replay_path = value;
+      i++;
+    }
+    else if (strcmp(arg, "--overlay") == 0)
+    {
+      set_profile_overlay(true);
+    }
+    else if (strcmp(arg, "--trace") == 0 && value)
+    {
+      trace_path = value;
+      i++;
+    }
+    else if (strcmp(arg, "--capture") == 0 && value)
+    {
+      capture_path = value;
+      i++;
+    }
+    else if (strcmp(arg, "--capture-block") == 0)
+    {
+      capture.policy = CAPTURE_BLOCK;
+    }
+    else if (strcmp(arg, "--capture-raw") == 0)
+    {
+      capture.compress = false;
+    }
+    else if (strcmp(arg, "--capture-pool") == 0 && value)
+    {
+      capture.poolFrames = atoi(value);
+      i++;
+    }
+    else if (strcmp(arg, "--unpack") == 0 && value && i + 2 < argc)
+    {
+      unpack_path = value;
+      unpack_frame = atol(argv[i + 2]);
+      i += 2;
+    }
+    else
+    {
+      print_usage();
+      return 1;
+    }
+  }
+
+  if (config.dt <= 0.0f)
+  {
+    fprintf(stderr, "--dt must be positive\n");
+    return 1;
+  }
+
+  if (unpack_path)
+    return unpack(unpack_path, unpack_frame, ppm_path);
+
+  if (trace_path && !PROFILE_ENABLED)
+  {
+    fprintf(stderr, "--trace needs a build with -DASTEROIDS_PROFILE\n");
+    return 1;
+  }
+
+  if (record_path && replay_path)
+  {
+    fprintf(stderr, "--record and --replay cannot be combined\n");
+    return 1;
+  }
+
+  // both set gameWorld.seed, which initialize() in run_headless() picks up
+  gameWorld.seed = seed;
+  std::string error;
+  if (record_path && !replay_begin_recording(record_path, seed, &error))
+  {
+    fprintf(stderr, "%s: %s\n", record_path, error.c_str());
+    return 1;
+  }
+  if (replay_path && !replay_begin_playback(replay_path, &error))
+  {
+    fprintf(stderr, "%s: %s\n", replay_path, error.c_str());
+    return 1;
+  }
+
+  // a replay quits once the session is over
+  if (!config.maxFrames && !config.script && !replay_path)
+  {
+    // nothing would ever schedule a quit
+    fprintf(stderr, "either --frames or --script is required\n");
+    return 1;
+  }
+
+  if (capture_path && !capture_begin(capture_path, capture, &error))
+  {
+    fprintf(stderr, "%s: %s\n", capture_path, error.c_str());
+    return 1;
+  }
+
+  // finalize() in run_headless() stops it again
+  pipeline_set_enabled(pipeline);
+
+  static JobPool system_pool;
+  if (sim_threads > 1)
+  {
+    system_pool.resize(sim_threads);
+    gameWorld.systemPool = &system_pool;
+  }
+
+  HeadlessStats stats = run_headless(config);
+  bool replaying = replay_playing();
+  ReplayStats replay = replay_stats();
+  replay_finish();
+
+  if (ppm_path && !headless_write_ppm(ppm_path))
+  {
+    fprintf(stderr, "cannot write %s\n", ppm_path);
+    return 1;
+  }
+
+  if (trace_path && !profile_write_trace(trace_path, &error))
+  {
+    fprintf(stderr, "%s: %s\n", trace_path, error.c_str());
+    return 1;
+  }
+
+  printf("frames=%llu sim_seconds=%.3f wall_seconds=%.3f frames_per_second=%.1f\n",
+    (unsigned long long)stats.frames, stats.simSeconds, stats.wallSeconds,
+    stats.wallSeconds > 0.0 ? stats.frames / stats.wallSeconds : 0.0);
+
+  if (pipeline)
+  {
+    PipelineStats piped = pipeline_stats();
+    double steps = piped.steps ? (double)piped.steps : 1.0;
+    double rendered = piped.rendered ? (double)piped.rendered : 1.0;
+    printf("pipeline_steps=%llu rendered=%llu repeated=%llu sim_us_mean=%.1f render_us_mean=%.1f "
+      "present_us_mean=%.1f copied_pixels_per_frame=%.0f\n",
+      (unsigned long long)piped.steps, (unsigned long long)piped.rendered, (unsigned long long)piped.repeated,
+      piped.simNs / 1000.0 / steps, piped.renderNs / 1000.0 / rendered,
+      piped.presentNs / 1000.0 / rendered, piped.copiedPixels / rendered);
+  }
+
+  if (sim_threads > 1)
+  {
+    // stages apart by '|', the systems of a stage by ','
+    const SystemScheduler& systems = world_systems();
+    printf("system_stages=");
+    for (int s = 0; s < systems.stage_count(); s++)
+    {
+      for (int i = systems.stage_begin(s); i < systems.stage_begin(s + 1); i++)
+        printf("%s%s", i > systems.stage_begin(s) ? "," : (s > 0 ? "|" : ""), systems.system(i).name);
+    }
+    printf("\n");
+  }
+
+  if (record_path)
+    printf("recorded_frames=%llu\n", (unsigned long long)replay.frames);
+
+  if (capture_path)
+  {
+    // finalize() closed the capture
+    CaptureStats captured = capture_stats();
+    printf("captured_frames=%llu written=%llu dropped=%llu bytes=%llu bytes_per_frame=%.0f "
+      "submit_us_mean=%.1f submit_us_max=%.1f blocked_ms=%.1f\n",
+      (unsigned long long)captured.frames, (unsigned long long)captured.written,
+      (unsigned long long)captured.dropped, (unsigned long long)captured.bytes,
+      captured.written ? (double)captured.bytes / captured.written : 0.0,
+      captured.frames ? captured.submitNs / 1000.0 / captured.frames : 0.0,
+      captured.submitNsMax / 1000.0, captured.blockedNs / 1e6);
+    if (captured.failed)
+    {
+      fprintf(stderr, "%s: write failed\n", capture_path);
+      return 1;
+    }
+  }
+
+  if (replaying)
+  {
+    printf("replayed_frames=%llu mismatches=%llu first_mismatch=%lld\n",
+      (unsigned long long)replay.frames, (unsigned long long)replay.mismatches,
+      (long long)replay.firstMismatch);
+    if (replay.mismatches)
+      return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include "JobPool.h"
+
+void JobPool::resize(int threads) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+
+    stopping = false;
+    int total = threads > 1 ? threads : 1;
+    ranges.reset(new Range[total]);
+    for (int i = 1; i < total; i++) {
+        workers.emplace_back(&JobPool::worker_loop, this, i, generation);
+    }
+}
+
+void JobPool::parallel_for(int count, void (*job)(int, void*), void* context) {
+    if (count <= 0) return;
+
+    int total = threads();
+    if (total == 1) {
+        for (int i = 0; i < count; i++) job(i, context);
+        return;
+    }
+
+    for (int t = 0; t < total; t++) {
+        uint32_t begin = (uint32_t)((int64_t)count * t / total);
+        uint32_t end = (uint32_t)((int64_t)count * (t + 1) / total);
+        ranges[t].bounds.store(pack(begin, end), std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = job;
+        this->context = context;
+        busyWorkers = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    run_share(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void JobPool::run_share(int self) {
+    for (;;) {
+        int index;
+        while (take(self, index)) {
+            job(index, context);
+        }
+        if (!steal(self)) return;
+    }
+}
+
+// Takes the first index of the thread's own range
+bool JobPool::take(int self, int& index) {
+    std::atomic<uint64_t>& bounds = ranges[self].bounds;
+    uint64_t current = bounds.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t begin = (uint32_t)current, end = (uint32_t)(current >> 32);
+        if (begin >= end) return false;
+        if (bounds.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acq_rel)) {
+            index = (int)begin;
+            return true;
+        }
+    }
+}
+
+// Moves the back half of the first non-empty range found into the thread's
+// own (empty) range. False once every range is empty: whatever is left is
+// already running.
+bool JobPool::steal(int self) {
+    int total = threads();
+    for (int k = 1; k < total; k++) {
+        std::atomic<uint64_t>& bounds = ranges[(self + k) % total].bounds;
+        uint64_t current = bounds.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t begin = (uint32_t)current, end = (uint32_t)(current >> 32);
+            if (begin >= end) break;
+
+            uint32_t middle = begin + (end - begin) / 2;
+            if (bounds.compare_exchange_weak(current, pack(begin, middle), std::memory_order_acq_rel)) {
+                ranges[self].bounds.store(pack(middle, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// seen is the generation at creation, so a loop that starts before the
+// thread does is not missed
+void JobPool::worker_loop(int self, uint64_t seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        run_share(self);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) finished.notify_one();
+    }
+}
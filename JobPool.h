@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+//  Work-stealing pool for parallel loops over independent items.
+//
+//  parallel_for() splits the index range evenly between the participating
+//  threads (the caller is one of them). Each thread takes indices from the
+//  front of its own range; a thread that runs dry steals the back half of
+//  another thread's range. Items that take longer than others, such as a
+//  world that is still playing next to one that is over, are evened out
+//  without a shared queue every item would contend on.
+//
+//  Workers sleep between loops and are kept for the next one.
+//
+
+class JobPool {
+public:
+    JobPool() {}
+    ~JobPool() { resize(0); }
+
+    // threads in total, including the caller; 0 or 1 runs loops inline
+    void resize(int threads);
+    int threads() const { return (int)workers.size() + 1; }
+
+    // Calls job(index, context) once for every index in [0, count) and
+    // returns when all calls are done
+    void parallel_for(int count, void (*job)(int, void*), void* context);
+
+private:
+    // [begin, end) of one thread's indices, packed so a take or a steal is
+    // one compare-and-swap
+    struct alignas(64) Range {
+        std::atomic<uint64_t> bounds{ 0 };
+    };
+
+    static uint64_t pack(uint32_t begin, uint32_t end) { return (uint64_t)end << 32 | begin; }
+
+    void run_share(int self);
+    bool take(int self, int& index);
+    bool steal(int self);
+    void worker_loop(int self, uint64_t seen);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Range[]> ranges; // one per thread, the caller's first
+
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+    uint64_t generation = 0;
+    int busyWorkers = 0;
+
+    void (*job)(int, void*) = nullptr;
+    void* context = nullptr;
+};
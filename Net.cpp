@@ -0,0 +1,137 @@
+#include "Net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+typedef SOCKET NativeSocket;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#endif
+
+static NativeSocket native(intptr_t handle) {
+    return (NativeSocket)handle;
+}
+
+static bool startup() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+        started = true;
+    }
+#endif
+    return true;
+}
+
+bool net_parse_address(const char* text, NetAddress& address) {
+    const char* colon = strrchr(text, ':');
+    std::string host = colon ? std::string(text, colon - text) : "127.0.0.1";
+    int port = atoi(colon ? colon + 1 : text);
+    if (port <= 0 || port > 65535) return false;
+
+    in_addr parsed;
+    if (inet_pton(AF_INET, host.c_str(), &parsed) != 1) return false;
+    address.host = ntohl(parsed.s_addr);
+    address.port = (uint16_t)port;
+    return true;
+}
+
+std::string net_address_string(const NetAddress& address) {
+    char text[32];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", address.host >> 24, (address.host >> 16) & 0xFF,
+             (address.host >> 8) & 0xFF, address.host & 0xFF, address.port);
+    return text;
+}
+
+bool UdpSocket::open(uint16_t port, std::string* error) {
+    close();
+    if (!startup()) {
+        if (error) *error = "cannot start sockets";
+        return false;
+    }
+
+    intptr_t s = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == -1) {
+        if (error) *error = "cannot create socket";
+        return false;
+    }
+    handle = s;
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(native(handle), (sockaddr*)&local, sizeof(local)) != 0) {
+        if (error) *error = "cannot bind port " + std::to_string(port);
+        close();
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ioctlsocket(native(handle), FIONBIO, &nonBlocking);
+#else
+    fcntl(native(handle), F_SETFL, fcntl(native(handle), F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+void UdpSocket::close() {
+    if (handle == -1) return;
+#ifdef _WIN32
+    closesocket(native(handle));
+#else
+    ::close(native(handle));
+#endif
+    handle = -1;
+}
+
+uint16_t UdpSocket::local_port() const {
+    sockaddr_in local;
+    socklen_t size = sizeof(local);
+    if (handle == -1 || getsockname(native(handle), (sockaddr*)&local, &size) != 0) return 0;
+    return ntohs(local.sin_port);
+}
+
+bool UdpSocket::send(const NetAddress& to, const void* data, size_t size) {
+    sockaddr_in remote;
+    memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(to.host);
+    remote.sin_port = htons(to.port);
+    return sendto(native(handle), (const char*)data, (int)size, 0, (sockaddr*)&remote, sizeof(remote)) == (int)size;
+}
+
+int UdpSocket::receive(void* data, size_t capacity, NetAddress& from) {
+    sockaddr_in remote;
+    socklen_t size = sizeof(remote);
+    int received = (int)recvfrom(native(handle), (char*)data, (int)capacity, 0, (sockaddr*)&remote, &size);
+    if (received < 0) return -1;
+
+    from.host = ntohl(remote.sin_addr.s_addr);
+    from.port = ntohs(remote.sin_port);
+    return received;
+}
+
+bool UdpSocket::wait(int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(native(handle), &readable);
+    timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select((int)handle + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//
+//  Minimal non-blocking UDP socket (BSD sockets, or Winsock on Windows).
+//
+
+struct NetAddress {
+    uint32_t host; // IPv4, host byte order
+    uint16_t port;
+
+    bool operator==(const NetAddress& other) const { return host == other.host && port == other.port; }
+};
+
+// "a.b.c.d:port"; a bare port means 127.0.0.1
+bool net_parse_address(const char* text, NetAddress& address);
+std::string net_address_string(const NetAddress& address);
+
+class UdpSocket {
+public:
+    UdpSocket() : handle(-1) {}
+    ~UdpSocket() { close(); }
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    // Binds to the port on all interfaces; port 0 picks a free one
+    bool open(uint16_t port, std::string* error);
+    void close();
+    bool is_open() const { return handle != -1; }
+    uint16_t local_port() const;
+
+    bool send(const NetAddress& to, const void* data, size_t size);
+
+    // Size of the next datagram, or -1 when none is waiting
+    int receive(void* data, size_t capacity, NetAddress& from);
+
+    // Sleeps until a datagram arrives or the timeout passes
+    bool wait(int timeoutMs);
+
+private:
+    intptr_t handle;
+};
@@ -0,0 +1,258 @@
+//
+//  Multiplayer server and bot client over UDP, and a loopback self-test:
+//    asteroids_net --server [--port P] [--ships N] [--seed N] [--ticks N]
+//    asteroids_net --client HOST:PORT [--ticks N] [--loss FRACTION]
+//    asteroids_net --loopback CLIENTS [--ticks N] [--loss FRACTION] [--seed N]
+//
+//  The server prints bytes sent per tick and its tick time, the figures that
+//  decide how many sessions one machine can host. The loopback test runs a
+//  server and bot clients in one process and fails when a client's
+//  reconstruction differed from the server's snapshot.
+//
+
+#include "Game.h"
+#include "NetSession.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::duration TICK_PERIOD =
+    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / SNAPSHOT_RATE));
+
+// Turns the ship towards the nearest asteroid and fires when roughly facing
+// it; restarts finished games
+static uint8_t bot(const World& world, int ship) {
+    if (world.gameOver || world.gameWon) return INPUT_RETURN;
+    if (ship < 0 || ship >= world.shipCount || !world.ships[ship].alive || world.asteroids.count() == 0) return 0;
+
+    const Ship& self = world.ships[ship];
+    int nearest = 0;
+    float nearestDistance = 1e30f;
+    for (int i = 0; i < world.asteroids.count(); i++) {
+        float dx = world.asteroids.x[i] - self.position.x;
+        float dy = world.asteroids.y[i] - self.position.y;
+        float distance = dx * dx + dy * dy;
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = i;
+        }
+    }
+
+    float target = atan2f(world.asteroids.y[nearest] - self.position.y, world.asteroids.x[nearest] - self.position.x);
+    float turn = remainderf(target - self.angle, 6.2831853f);
+
+    uint8_t input = 0;
+    if (turn < -0.05f) input |= INPUT_LEFT;
+    if (turn > 0.05f) input |= INPUT_RIGHT;
+    if (fabsf(turn) < 0.2f) input |= INPUT_SPACE;
+    if (nearestDistance > 300.0f * 300.0f) input |= INPUT_UP;
+    return input;
+}
+
+static uint64_t percentile(std::vector<uint64_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+static void print_server_stats(const NetServer& server) {
+    const ServerStats& stats = server.stats();
+    double ticks = stats.ticks ? (double)stats.ticks : 1.0;
+    double snapshots = stats.snapshotsSent ? (double)stats.snapshotsSent : 1.0;
+
+    uint64_t totalNs = 0;
+    for (uint64_t ns : stats.tickNs) totalNs += ns;
+    double meanNs = stats.tickNs.empty() ? 0.0 : (double)totalNs / stats.tickNs.size();
+
+    printf("server ticks=%llu ships=%d clients=%d snapshots=%llu full_snapshots=%llu "
+           "bytes_per_tick=%.1f bytes_per_snapshot=%.1f full_bytes_per_snapshot=%.1f upstream_bytes_per_tick=%.1f "
+           "largest_packet=%zu tick_us_mean=%.1f tick_us_p50=%.1f tick_us_p99=%.1f sessions_per_core=%.0f "
+           "acks_checked=%llu ack_mismatches=%llu\n",
+           (unsigned long long)stats.ticks, server.world().shipCount, server.clients(),
+           (unsigned long long)stats.snapshotsSent, (unsigned long long)stats.fullSnapshots,
+           stats.bytesSent / ticks, stats.bytesSent / snapshots, stats.fullSizeBytes / snapshots,
+           stats.bytesReceived / ticks, stats.largestPacket, meanNs / 1000.0,
+           percentile(stats.tickNs, 0.50) / 1000.0, percentile(stats.tickNs, 0.99) / 1000.0,
+           meanNs > 0 ? 1e9 / (meanNs * SNAPSHOT_RATE) : 0.0,
+           (unsigned long long)stats.acksChecked, (unsigned long long)stats.ackMismatches);
+    fflush(stdout);
+}
+
+static void print_client_stats(int index, const NetClient& client) {
+    const ClientStats& stats = client.stats();
+    printf("client %d ship=%d snapshots=%llu dropped=%llu unusable=%llu bytes_received=%llu bytes_sent=%llu\n",
+           index, client.ship(), (unsigned long long)stats.snapshots, (unsigned long long)stats.dropped,
+           (unsigned long long)stats.unusable, (unsigned long long)stats.bytesReceived,
+           (unsigned long long)stats.bytesSent);
+    fflush(stdout);
+}
+
+// Runs the server at SNAPSHOT_RATE for the given ticks (0: forever),
+// printing the statistics every reportTicks
+static void run_server(NetServer& server, uint64_t ticks, uint64_t reportTicks) {
+    Clock::time_point next = Clock::now();
+    for (uint64_t t = 0; ticks == 0 || t < ticks; t++) {
+        server.tick();
+        if (reportTicks && (t + 1) % reportTicks == 0) print_server_stats(server);
+
+        next += TICK_PERIOD;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+// Answers every snapshot with the bot's input until stop is set; without
+// snapshots the input is repeated every 100 ms, which also connects
+static void run_client(NetClient& client, const std::atomic<bool>& stop) {
+    std::unique_ptr<World> view(new World());
+    uint8_t input = 0;
+    while (!stop.load()) {
+        client.wait(100);
+        if (client.receive()) {
+            apply_snapshot(client.snapshot(), *view);
+            input = bot(*view, client.ship());
+        }
+        client.send_input(input);
+    }
+}
+
+static void print_usage() {
+    fprintf(stderr,
+        "usage: asteroids_net --server | --client HOST:PORT | --loopback CLIENTS [options]\n"
+        "  --port P          server port (default 27015)\n"
+        "  --ships N         ships in a server session (default 4)\n"
+        "  --seed N          world seed (default 1)\n"
+        "  --ticks N         run for N server ticks (default: server forever, otherwise 600)\n"
+        "  --loss FRACTION   clients drop this share of snapshots (default 0)\n");
+}
+
+int main(int argc, char** argv) {
+    enum { NONE, SERVER, CLIENT, LOOPBACK } mode = NONE;
+    uint16_t port = 27015;
+    int ships = 4;
+    int clientCount = 0;
+    uint32_t seed = 1;
+    uint64_t ticks = 0;
+    float loss = 0;
+    NetAddress address = { 0, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--server") == 0) {
+            mode = SERVER;
+        } else if (strcmp(arg, "--client") == 0 && value) {
+            if (!net_parse_address(value, address)) {
+                fprintf(stderr, "%s: not an address\n", value);
+                return 1;
+            }
+            mode = CLIENT;
+            i++;
+        } else if (strcmp(arg, "--loopback") == 0 && value) {
+            clientCount = atoi(value);
+            mode = LOOPBACK;
+            i++;
+        } else if (strcmp(arg, "--port") == 0 && value) {
+            port = (uint16_t)atoi(value);
+            i++;
+        } else if (strcmp(arg, "--ships") == 0 && value) {
+            ships = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            seed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else if (strcmp(arg, "--ticks") == 0 && value) {
+            ticks = strtoull(value, nullptr, 10);
+            i++;
+        } else if (strcmp(arg, "--loss") == 0 && value) {
+            loss = (float)atof(value);
+            i++;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    std::string error;
+    if (mode == SERVER) {
+        NetServer server;
+        if (!server.start(port, ships, seed, &error)) {
+            fprintf(stderr, "server: %s\n", error.c_str());
+            return 1;
+        }
+        printf("serving %d ships on port %u\n", ships, server.port());
+        fflush(stdout);
+        run_server(server, ticks, 10 * SNAPSHOT_RATE);
+        print_server_stats(server);
+        return 0;
+    }
+
+    if (mode == CLIENT) {
+        NetClient client;
+        if (!client.connect(address, &error)) {
+            fprintf(stderr, "client: %s\n", error.c_str());
+            return 1;
+        }
+        client.set_loss(loss, seed);
+
+        std::atomic<bool> stop(false);
+        std::thread worker(run_client, std::ref(client), std::cref(stop));
+        std::this_thread::sleep_for(TICK_PERIOD * (ticks ? ticks : 600));
+        stop = true;
+        worker.join();
+        print_client_stats(0, client);
+        return client.stats().snapshots > 0 ? 0 : 1;
+    }
+
+    if (mode != LOOPBACK || clientCount < 1 || clientCount > MAX_SHIPS) {
+        print_usage();
+        return 1;
+    }
+
+    // Loopback: one ship per client, the server on a free port
+    NetServer server;
+    if (!server.start(0, clientCount, seed, &error)) {
+        fprintf(stderr, "server: %s\n", error.c_str());
+        return 1;
+    }
+    NetAddress serverAddress;
+    net_parse_address(std::to_string(server.port()).c_str(), serverAddress);
+
+    std::vector<std::unique_ptr<NetClient>> clients;
+    for (int c = 0; c < clientCount; c++) {
+        clients.emplace_back(new NetClient());
+        if (!clients.back()->connect(serverAddress, &error)) {
+            fprintf(stderr, "client: %s\n", error.c_str());
+            return 1;
+        }
+        clients.back()->set_loss(loss, seed + 1 + (uint32_t)c);
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> workers;
+    for (int c = 0; c < clientCount; c++) {
+        workers.emplace_back(run_client, std::ref(*clients[c]), std::cref(stop));
+    }
+    run_server(server, ticks ? ticks : 600, 0);
+    stop = true;
+    for (std::thread& worker : workers) worker.join();
+
+    bool ok = server.stats().ackMismatches == 0;
+    for (int c = 0; c < clientCount; c++) {
+        print_client_stats(c, *clients[c]);
+        ok = ok && clients[c]->stats().snapshots > 0;
+    }
+    print_server_stats(server);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+#include "NetSession.h"
+#include <chrono>
+
+static const uint8_t PACKET_INPUT = 'I';
+static const uint8_t PACKET_SNAPSHOT = 'S';
+static const size_t INPUT_SIZE = 14;
+static const size_t SNAPSHOT_HEADER_SIZE = 10;
+
+static_assert(SNAPSHOT_HEADER_SIZE + SNAPSHOT_MAX_BYTES <= NET_MAX_PACKET, "snapshots can outgrow a packet");
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 24));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// --- Server ---
+
+NetServer::NetServer()
+    : state(new World()), history(new Snapshot[NET_HISTORY]), tickCount(0) {
+    for (Client& client : slots) client.connected = false;
+    counters = ServerStats();
+}
+
+bool NetServer::start(uint16_t port, int ships, uint32_t seed, std::string* error) {
+    if (ships < 1 || ships > MAX_SHIPS) {
+        if (error) *error = "ship count out of range";
+        return false;
+    }
+    if (!socket.open(port, error)) return false;
+
+    state->shipCount = ships;
+    state->seed = seed;
+    reset_world(*state);
+
+    for (Client& client : slots) client.connected = false;
+    for (int i = 0; i < NET_HISTORY; i++) history[i].clear(NET_NO_TICK);
+    tickCount = 0;
+    counters = ServerStats();
+    counters.tickNs.reserve(1 << 16);
+    packet.resize(NET_MAX_PACKET);
+    return true;
+}
+
+int NetServer::clients() const {
+    int count = 0;
+    for (const Client& client : slots) count += client.connected ? 1 : 0;
+    return count;
+}
+
+const Snapshot* NetServer::history_at(uint32_t tick) const {
+    if (tick == NET_NO_TICK || tick > tickCount) return nullptr;
+    const Snapshot& snapshot = history[tick % NET_HISTORY];
+    return snapshot.tick == tick ? &snapshot : nullptr;
+}
+
+void NetServer::receive_input() {
+    NetAddress from;
+    for (int size; (size = socket.receive(packet.data(), packet.size(), from)) >= 0; ) {
+        counters.bytesReceived += (uint64_t)size;
+        if ((size_t)size != INPUT_SIZE || packet[0] != PACKET_INPUT) continue;
+
+        int ship = -1;
+        for (int s = 0; s < state->shipCount; s++) {
+            if (slots[s].connected && slots[s].address == from) ship = s;
+        }
+        if (ship < 0) {
+            for (int s = 0; s < state->shipCount && ship < 0; s++) {
+                if (slots[s].connected) continue;
+                ship = s;
+                slots[s].connected = true;
+                slots[s].address = from;
+                slots[s].lastSequence = 0;
+                slots[s].ackTick = NET_NO_TICK;
+                slots[s].input = 0;
+            }
+            if (ship < 0) continue; // session full
+        }
+
+        Client& client = slots[ship];
+        uint32_t sequence = get_u32(&packet[1]);
+        if (sequence <= client.lastSequence) continue; // late or duplicated
+        client.lastSequence = sequence;
+        client.lastHeard = tickCount;
+        client.input = packet[5];
+
+        uint32_t ackTick = get_u32(&packet[6]);
+        uint32_t ackHash = get_u32(&packet[10]);
+        if (ackTick == NET_NO_TICK || (client.ackTick != NET_NO_TICK && ackTick <= client.ackTick)) continue;
+        const Snapshot* acked = history_at(ackTick);
+        if (!acked) continue;
+
+        // A client that reconstructed a snapshot wrongly would carry the
+        // error into every later delta; keep coding against an older base
+        counters.acksChecked++;
+        if (hash_snapshot(*acked) != ackHash) {
+            counters.ackMismatches++;
+            continue;
+        }
+        client.ackTick = ackTick;
+    }
+}
+
+void NetServer::send_snapshots() {
+    const Snapshot& current = history[tickCount % NET_HISTORY];
+    empty.clear(current.tick);
+
+    for (int s = 0; s < state->shipCount; s++) {
+        Client& client = slots[s];
+        if (!client.connected) continue;
+
+        const Snapshot* base = history_at(client.ackTick);
+        packet.clear();
+        packet.push_back(PACKET_SNAPSHOT);
+        packet.push_back((uint8_t)s);
+        put_u32(packet, current.tick);
+        put_u32(packet, base ? base->tick : NET_NO_TICK);
+        encode_snapshot(current, base ? *base : empty, packet);
+
+        socket.send(client.address, packet.data(), packet.size());
+        counters.snapshotsSent++;
+        counters.fullSnapshots += base ? 0 : 1;
+        counters.bytesSent += packet.size();
+        if (packet.size() > counters.largestPacket) counters.largestPacket = packet.size();
+    }
+    packet.resize(NET_MAX_PACKET);
+}
+
+void NetServer::tick() {
+    auto start = std::chrono::steady_clock::now();
+
+    receive_input();
+
+    uint8_t inputs[MAX_SHIPS] = { 0 };
+    for (int s = 0; s < state->shipCount; s++) {
+        Client& client = slots[s];
+        if (client.connected && tickCount - client.lastHeard > (uint32_t)NET_CLIENT_TIMEOUT) client.connected = false;
+        if (client.connected) inputs[s] = client.input;
+    }
+    step_world(*state, 1.0f / SNAPSHOT_RATE, inputs);
+
+    tickCount++;
+    capture_snapshot(*state, tickCount, history[tickCount % NET_HISTORY]);
+    send_snapshots();
+
+    auto end = std::chrono::steady_clock::now();
+    counters.tickNs.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    counters.ticks++;
+
+    // Outside the timed part: the size the same snapshots would have without deltas
+    scratch.clear();
+    encode_snapshot(history[tickCount % NET_HISTORY], empty, scratch);
+    counters.fullSizeBytes += (uint64_t)(scratch.size() + SNAPSHOT_HEADER_SIZE) * clients();
+}
+
+// --- Client ---
+
+NetClient::NetClient()
+    : history(new Snapshot[NET_HISTORY]), latest(NET_NO_TICK), sequence(0), shipIndex(-1), loss(0) {
+    counters = ClientStats();
+}
+
+bool NetClient::connect(const NetAddress& address, std::string* error) {
+    if (!socket.open(0, error)) return false;
+
+    server = address;
+    for (int i = 0; i < NET_HISTORY; i++) history[i].clear(NET_NO_TICK);
+    latest = NET_NO_TICK;
+    sequence = 0;
+    shipIndex = -1;
+    counters = ClientStats();
+    packet.resize(NET_MAX_PACKET);
+    return true;
+}
+
+void NetClient::set_loss(float fraction, uint32_t seed) {
+    loss = fraction;
+    lossRandom.seed(seed);
+}
+
+const Snapshot& NetClient::snapshot() const {
+    return history[(latest == NET_NO_TICK ? 0 : latest) % NET_HISTORY];
+}
+
+bool NetClient::receive_snapshot(const uint8_t* data, int size) {
+    if ((size_t)size < SNAPSHOT_HEADER_SIZE || data[0] != PACKET_SNAPSHOT) return false;
+
+    int ship = data[1];
+    uint32_t tick = get_u32(data + 2);
+    uint32_t baseTick = get_u32(data + 6);
+    if (ship >= MAX_SHIPS || tick == NET_NO_TICK) return false;
+    if (latest != NET_NO_TICK && tick <= latest) return false; // older than what we show
+
+    if (loss > 0 && lossRandom.next() < loss * 4294967296.0) {
+        counters.dropped++;
+        return false;
+    }
+
+    const Snapshot* base = &empty;
+    if (baseTick != NET_NO_TICK) {
+        base = &history[baseTick % NET_HISTORY];
+        if (base->tick != baseTick || tick - baseTick >= (uint32_t)NET_HISTORY) {
+            counters.unusable++;
+            return false;
+        }
+    } else {
+        empty.clear(tick);
+    }
+
+    Snapshot& out = history[tick % NET_HISTORY];
+    if (!decode_snapshot(data + SNAPSHOT_HEADER_SIZE, (size_t)size - SNAPSHOT_HEADER_SIZE, *base, tick, out)) {
+        out.tick = NET_NO_TICK;
+        counters.unusable++;
+        return false;
+    }
+
+    latest = tick;
+    shipIndex = ship;
+    counters.snapshots++;
+    return true;
+}
+
+bool NetClient::receive() {
+    bool fresh = false;
+    NetAddress from;
+    for (int size; (size = socket.receive(packet.data(), packet.size(), from)) >= 0; ) {
+        if (!(from == server)) continue;
+        counters.bytesReceived += (uint64_t)size;
+        if (receive_snapshot(packet.data(), size)) fresh = true;
+    }
+    return fresh;
+}
+
+void NetClient::send_input(uint8_t input) {
+    uint8_t message[INPUT_SIZE];
+    uint32_t ackHash = has_snapshot() ? hash_snapshot(snapshot()) : 0;
+    sequence++;
+    message[0] = PACKET_INPUT;
+    for (int i = 0; i < 4; i++) {
+        message[1 + i] = (uint8_t)(sequence >> (i * 8));
+        message[6 + i] = (uint8_t)(latest >> (i * 8));
+        message[10 + i] = (uint8_t)(ackHash >> (i * 8));
+    }
+    message[5] = input;
+    socket.send(server, message, sizeof(message));
+    counters.bytesSent += sizeof(message);
+}
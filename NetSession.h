@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Game.h"
+#include "Net.h"
+#include "Snapshot.h"
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+//  Authoritative multiplayer over UDP.
+//
+//  The server owns the World and steps it SNAPSHOT_RATE times a second with
+//  the latest input bits of every ship. After each step it sends every
+//  client a snapshot coded against the newest snapshot that client
+//  acknowledged (see Snapshot.h), or against an empty world while it has
+//  acknowledged none or its ack fell out of the history ring.
+//
+//  A client sends its input bits, the newest snapshot tick it decoded and
+//  that snapshot's hash, which the server checks against its own copy. The
+//  first packet from a new address takes the first ship without a client.
+//
+//  Packets, little endian:
+//    input     'I', u32 sequence, u8 input bits, u32 ack tick, u32 ack hash
+//    snapshot  'S', u8 ship, u32 tick, u32 base tick, snapshot bits
+//  A base tick of NET_NO_TICK marks a snapshot coded against an empty world.
+//
+
+const uint32_t NET_NO_TICK = 0xFFFFFFFFu;
+const int NET_HISTORY = 64;             // snapshots a client can lag behind and still get deltas
+const int NET_MAX_PACKET = 16384;       // larger than any snapshot of the pool capacities
+const int NET_CLIENT_TIMEOUT = 5 * SNAPSHOT_RATE; // ticks without input before a ship is freed
+
+struct ServerStats {
+    uint64_t ticks;
+    uint64_t snapshotsSent;
+    uint64_t fullSnapshots;     // sent without a usable base
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t fullSizeBytes;     // what the sent snapshots would cost coded against nothing (not timed)
+    uint64_t ackMismatches;     // acknowledged snapshots whose hash differs from the server's
+    uint64_t acksChecked;
+    size_t largestPacket;
+    std::vector<uint64_t> tickNs; // wall time of every tick() call
+};
+
+class NetServer {
+public:
+    NetServer();
+
+    // Starts a session with the given number of ships
+    bool start(uint16_t port, int ships, uint32_t seed, std::string* error);
+    uint16_t port() const { return socket.local_port(); }
+
+    // One step: reads input, steps the world, sends snapshots
+    void tick();
+
+    int clients() const;
+    const World& world() const { return *state; }
+    const ServerStats& stats() const { return counters; }
+
+private:
+    struct Client {
+        bool connected;
+        NetAddress address;
+        uint32_t lastSequence;
+        uint32_t lastHeard;
+        uint32_t ackTick;
+        uint8_t input;
+    };
+
+    void receive_input();
+    void send_snapshots();
+    const Snapshot* history_at(uint32_t tick) const;
+
+    UdpSocket socket;
+    std::unique_ptr<World> state;
+    std::unique_ptr<Snapshot[]> history; // NET_HISTORY snapshots by tick
+    Snapshot empty;
+    Client slots[MAX_SHIPS];
+    uint32_t tickCount;
+    ServerStats counters;
+    std::vector<uint8_t> packet, scratch;
+};
+
+struct ClientStats {
+    uint64_t snapshots;     // decoded
+    uint64_t dropped;       // discarded by the simulated loss
+    uint64_t unusable;      // base no longer held, or malformed
+    uint64_t bytesReceived;
+    uint64_t bytesSent;
+};
+
+class NetClient {
+public:
+    NetClient();
+
+    bool connect(const NetAddress& server, std::string* error);
+
+    // Drops that share of arriving snapshots, to exercise the acks
+    void set_loss(float fraction, uint32_t seed);
+
+    // Decodes waiting snapshots; true if a new one arrived. wait() sleeps
+    // until a packet does.
+    bool receive();
+    bool wait(int timeoutMs) { return socket.wait(timeoutMs); }
+
+    // Sends the input bits along with the ack of the newest snapshot
+    void send_input(uint8_t input);
+
+    // -1 until the server assigned a ship
+    int ship() const { return shipIndex; }
+    bool has_snapshot() const { return latest != NET_NO_TICK; }
+    const Snapshot& snapshot() const;
+    const ClientStats& stats() const { return counters; }
+
+private:
+    bool receive_snapshot(const uint8_t* data, int size);
+
+    UdpSocket socket;
+    NetAddress server;
+    std::unique_ptr<Snapshot[]> history; // NET_HISTORY decoded snapshots by tick
+    Snapshot empty;
+    uint32_t latest;
+    uint32_t sequence;
+    int shipIndex;
+    float loss;
+    GameRandom lossRandom;
+    ClientStats counters;
+    std::vector<uint8_t> packet;
+};
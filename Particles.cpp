@@ -0,0 +1,198 @@
+#include "Particles.h"
+#include "Profile.h"
+#include "Render.h"
+#include "Simd.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+void ParticleSystem::reserve(int capacity) {
+    x.assign(capacity, 0.0f);
+    y.assign(capacity, 0.0f);
+    vx.assign(capacity, 0.0f);
+    vy.assign(capacity, 0.0f);
+    life.assign(capacity, 0.0f);
+    fade.assign(capacity, 0.0f);
+    color.assign(capacity, 0);
+    sprites.assign(capacity, PointSprite());
+    bins.assign(capacity, 0);
+    clear();
+}
+
+void ParticleSystem::clear() {
+    first = 0;
+    live = 0;
+}
+
+// xorshift32; effects must not draw from the game's random numbers
+uint32_t ParticleSystem::next_random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+float ParticleSystem::random_range(float low, float high) {
+    return low + (high - low) * (float)(next_random() >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::emit(const ParticleEmitter& emitter, int count, float px, float py, float pvx, float pvy,
+                          float direction) {
+    int size = capacity();
+    if (size == 0) return;
+
+    for (int n = 0; n < count; n++) {
+        int i;
+        if (live < size) {
+            i = (first + live) % size;
+            live++;
+        } else {
+            i = first; // full: replace the oldest
+            first = (first + 1) % size;
+        }
+
+        float angle = direction + random_range(-0.5f, 0.5f) * emitter.spread;
+        float speed = random_range(emitter.speedMin, emitter.speedMax);
+        float lifeTime = random_range(emitter.lifeMin, emitter.lifeMax);
+        x[i] = px;
+        y[i] = py;
+        vx[i] = pvx + cosf(angle) * speed;
+        vy[i] = pvy + sinf(angle) * speed;
+        life[i] = lifeTime;
+        fade[i] = 1.0f / lifeTime;
+        color[i] = emitter.color;
+    }
+}
+
+void ParticleSystem::update(float dt) {
+    PROFILE_PHASE(PHASE_PARTICLE_UPDATE);
+    if (live == 0) return;
+
+    int size = capacity();
+    float drag = powf(PARTICLE_DRAG, dt);
+    int head = std::min(live, size - first);
+    update_particles(&x[first], &y[first], &vx[first], &vy[first], &life[first], head, dt, drag);
+    update_particles(&x[0], &y[0], &vx[0], &vy[0], &life[0], live - head, dt, drag);
+
+    while (live > 0 && life[first] <= 0.0f) {
+        first = (first + 1) % size;
+        live--;
+    }
+}
+
+// Every channel times weight / 256, weight in [0, 256]
+static inline uint32_t scale_color(uint32_t color, uint32_t weight) {
+    uint32_t redBlue = (((color & 0x00FF00FFu) * weight) >> 8) & 0x00FF00FFu;
+    uint32_t alphaGreen = (((color >> 8) & 0x00FF00FFu) * weight) & 0xFF00FF00u;
+    return redBlue | alphaGreen;
+}
+
+void ParticleSystem::draw() const {
+    PROFILE_PHASE(PHASE_PARTICLE_RASTER);
+    if (live == 0) return;
+
+    int size = capacity();
+    int head = std::min(live, size - first);
+    int starts[2] = { first, 0 };
+    int ends[2] = { first + head, live - head };
+
+    // Bin of the row each particle starts on; POINT_BINS if it is dead or
+    // too far off screen for its streak to come back
+    for (int s = 0; s < 2; s++) {
+        bin_rows(&x[starts[s]], &y[starts[s]], &life[starts[s]], &bins[starts[s]], ends[s] - starts[s],
+                 (float)POINT_STREAK_PIXELS, POINT_BIN_SHIFT, POINT_BINS);
+    }
+
+    // count the particles per bin, then turn the counts into bin starts;
+    // four interleaved tallies keep runs of one bin from waiting on their
+    // own increments
+    int counts[4][POINT_BINS + 1] = {};
+    for (int s = 0; s < 2; s++) {
+        int i = starts[s];
+        for (; i + 4 <= ends[s]; i += 4) {
+            counts[0][bins[i]]++;
+            counts[1][bins[i + 1]]++;
+            counts[2][bins[i + 2]]++;
+            counts[3][bins[i + 3]]++;
+        }
+        for (; i < ends[s]; i++) counts[0][bins[i]]++;
+    }
+    int* binStart = points.binStart;
+    binStart[0] = 0;
+    for (int b = 0; b < POINT_BINS; b++) binStart[b + 1] = binStart[b] + counts[0][b] + counts[1][b] + counts[2][b] + counts[3][b];
+    if (binStart[POINT_BINS] == 0) return;
+
+    // Sprites go into their bins in ring order. A particle moving faster
+    // than a pixel per frame streaks back along its velocity over the
+    // distance of one 60 Hz frame, a pixel per step and at most
+    // POINT_STREAK_PIXELS long.
+    const float streakTime = 1.0f / 60.0f;
+    int next[POINT_BINS];
+    memcpy(next, binStart, sizeof(next));
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int s = 0; s < 2; s++) {
+        for (int i = starts[s]; i < ends[s]; i++) {
+            int bin = bins[i];
+            if (bin == POINT_BINS) continue;
+
+            float brightness = std::min(life[i] * fade[i], 1.0f);
+            float dx = -vx[i] * streakTime, dy = -vy[i] * streakTime;
+            float length = std::max(fabsf(dx), fabsf(dy));
+
+            PointSprite sprite;
+            sprite.x = (int32_t)(x[i] * 65536.0f);
+            sprite.y = (int32_t)(y[i] * 65536.0f);
+            sprite.color = scale_color(color[i], (uint32_t)(brightness * 256.0f));
+            sprite.steps = 0;
+            sprite.stepX = sprite.stepY = 0;
+            if (length >= 1.0f) {
+                float scale = 65536.0f / length;
+                sprite.steps = std::min((int)length, POINT_STREAK_PIXELS - 1);
+                sprite.stepX = (int32_t)(dx * scale);
+                sprite.stepY = (int32_t)(dy * scale);
+            }
+            sprites[next[bin]++] = sprite;
+
+            minX = std::min(minX, x[i]);
+            maxX = std::max(maxX, x[i]);
+            minY = std::min(minY, y[i]);
+            maxY = std::max(maxY, y[i]);
+        }
+    }
+
+    // bounds of the starts, widened by the longest streak
+    points.sprites = sprites.data();
+    points.x0 = (int)floorf(minX) - (POINT_STREAK_PIXELS - 1);
+    points.y0 = (int)floorf(minY) - (POINT_STREAK_PIXELS - 1);
+    points.x1 = (int)floorf(maxX) + POINT_STREAK_PIXELS;
+    points.y1 = (int)floorf(maxY) + POINT_STREAK_PIXELS;
+
+    DrawCommand cmd = {};
+    cmd.type = DRAW_POINTS;
+    cmd.points = &points;
+    cmd.blend = BLEND_ADD;
+    render_submit(cmd);
+}
+
+void ParticleSystem::copy_from(const ParticleSystem& other) {
+    first = 0;
+    live = std::min(other.live, capacity());
+    randomState = other.randomState;
+    if (live == 0) return;
+
+    // unwrap the window to the start of the ring
+    int head = std::min(live, other.capacity() - other.first);
+    int parts[2][2] = { { other.first, head }, { 0, live - head } };
+    int to = 0;
+    for (const auto& part : parts) {
+        size_t bytes = part[1] * sizeof(float);
+        memcpy(&x[to], &other.x[part[0]], bytes);
+        memcpy(&y[to], &other.y[part[0]], bytes);
+        memcpy(&vx[to], &other.vx[part[0]], bytes);
+        memcpy(&vy[to], &other.vy[part[0]], bytes);
+        memcpy(&life[to], &other.life[part[0]], bytes);
+        memcpy(&fade[to], &other.fade[part[0]], bytes);
+        memcpy(&color[to], &other.color[part[0]], part[1] * sizeof(uint32_t));
+        to += part[1];
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Raster.h"
+#include <stdint.h>
+#include <vector>
+
+//
+//  Particles for explosions, thrust and debris.
+//
+//  Particles are stored as structures of arrays in a ring allocated once by
+//  reserve(): the live particles are the capacity-wrapped window
+//  [first, first + count), oldest first. Emitting into a full ring replaces
+//  the oldest particle, so effects never allocate and never fail. Particles
+//  that die out of order leave holes in the window; they are updated and
+//  skipped when drawn until the window's front passes them, which the
+//  short lifetimes keep rare.
+//
+//  Drawing turns the live particles into point sprites sorted by row (see
+//  PointList in Raster.h), so the additive writes sweep the frame once from
+//  top to bottom instead of jumping around it in emission order.
+//
+//  Particles are cosmetic: they draw from their own random stream, are not
+//  hashed or replicated, and a system with no capacity ignores emits.
+//
+
+struct ParticleEmitter {
+    float speedMin, speedMax; // pixels per second, on top of the emitter's velocity
+    float spread;             // radians around the emit direction; 2 pi for a full circle
+    float lifeMin, lifeMax;   // seconds
+    uint32_t color;           // premultiplied, at full brightness
+};
+
+// Velocity kept per second
+const float PARTICLE_DRAG = 0.35f;
+
+class ParticleSystem {
+public:
+    ParticleSystem() : first(0), live(0), randomState(0x9E3779B9u) {}
+
+    // Allocates the ring; 0 turns the system off
+    void reserve(int capacity);
+    int capacity() const { return (int)x.size(); }
+    int count() const { return live; }
+    void clear();
+
+    // count particles at (px, py) moving at (vx, vy) plus the emitter's
+    // speed in a direction within spread of direction
+    void emit(const ParticleEmitter& emitter, int count, float px, float py, float vx, float vy, float direction);
+
+    // Moves, slows and ages every particle, then drops dead ones from the front
+    void update(float dt);
+
+    // Submits the particles as additive points, which the system holds
+    // until it is drawn again, so it must outlive the frame
+    void draw() const;
+
+    // Copies the live particles into a system of at least that capacity
+    void copy_from(const ParticleSystem& other);
+
+private:
+    uint32_t next_random();
+    float random_range(float low, float high);
+
+    std::vector<float> x, y, vx, vy, life, fade; // fade: 1 / life at emission
+    std::vector<uint32_t> color;
+    int first, live;
+    uint32_t randomState;
+    // the last submitted frame, sorted for drawing
+    mutable std::vector<PointSprite> sprites;
+    mutable std::vector<uint16_t> bins;
+    mutable PointList points;
+};
@@ -0,0 +1,229 @@
+#include "Pipeline.h"
+#include "Damage.h"
+#include "Game.h"
+#include "Profile.h"
+#include "Raster.h"
+#include "TripleBuffer.h"
+#include <string.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//
+//  Stage threads
+//
+//  A stage runs its job once per post() and sleeps in between; wait()
+//  returns once every posted job finished. post() is only called on an
+//  idle stage, so a job never overlaps the next one.
+//
+
+class StageThread {
+public:
+    void start(void (*body)()) {
+        job = body;
+        stopping = false;
+        posted = finishedJobs = 0;
+        thread = std::thread(&StageThread::loop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    void post() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            posted++;
+        }
+        wake.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return finishedJobs == posted; });
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || finishedJobs != posted; });
+                if (finishedJobs == posted) return; // stopping with nothing left
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finishedJobs++;
+            }
+            finished.notify_all();
+        }
+    }
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+    uint64_t posted = 0, finishedJobs = 0;
+    void (*job)() = nullptr;
+};
+
+static StageThread simStage, renderStage;
+static bool running = false;
+
+// Written by the simulation thread, read by the render thread
+static std::unique_ptr<TripleBuffer<World>> snapshots;
+
+// Frame the simulation thread steps next
+static float stepDt = 0;
+static uint8_t stepInput = 0;
+
+// The render thread draws here; presenting copies its changes into buffer
+static std::unique_ptr<uint32_t[][SCREEN_WIDTH]> backbuffer;
+static bool framePending = false; // a rendered frame is waiting for pipeline_present()
+
+static PipelineStats stats;
+
+// What draw_world() reads. Vectors assigned into slots that reserved the
+// pool capacities do not allocate.
+static void copy_drawn_state(const World& from, World& to) {
+    to.shipCount = from.shipCount;
+    for (int s = 0; s < from.shipCount; s++) to.ships[s] = from.ships[s];
+    to.bullets = from.bullets;
+    to.asteroids = from.asteroids;
+    to.playerLives = from.playerLives;
+    to.score = from.score;
+    to.gameOver = from.gameOver;
+    to.gameWon = from.gameWon;
+    to.tickAccumulator = from.tickAccumulator;
+    to.particles.copy_from(from.particles);
+}
+
+static void run_step() {
+    uint64_t start = profile_now_ns();
+    step_game(stepDt, stepInput);
+    copy_drawn_state(gameWorld, snapshots->write_slot());
+    snapshots->publish();
+    PROFILE_END_FRAME(); // the simulation's window, merged into the overlay's
+    stats.steps++;
+    stats.simNs += profile_now_ns() - start;
+}
+
+static void run_render() {
+    uint64_t start = profile_now_ns();
+    bool fresh;
+    const World& world = snapshots->read(&fresh);
+    {
+        PROFILE_PHASE(ZONE_DRAW);
+        draw_world(world);
+    }
+    PROFILE_END_FRAME();
+    stats.rendered++;
+    stats.repeated += fresh ? 0 : 1;
+    stats.renderNs += profile_now_ns() - start;
+}
+
+// Brings buffer up to date with the frame the render thread finished
+static void copy_pending_frame() {
+    if (!framePending) return;
+    framePending = false;
+
+    for (const DirtyRect& rect : damage_dirty_rects()) {
+        size_t bytes = rect.width * sizeof(uint32_t);
+        for (int y = rect.y; y < rect.y + rect.height; y++) {
+            memcpy(&buffer[y][rect.x], &backbuffer[y][rect.x], bytes);
+        }
+    }
+    stats.copiedPixels += (uint64_t)damage_dirty_pixels();
+}
+
+static void start() {
+    snapshots.reset(new TripleBuffer<World>());
+    for (int i = 0; i < 3; i++) {
+        World& slot = snapshots->slot(i);
+        slot.bullets.reserve(MAX_BULLETS);
+        slot.asteroids.reserve(MAX_ASTEROIDS);
+        slot.particles.reserve(PARTICLE_CAPACITY);
+    }
+    copy_drawn_state(gameWorld, snapshots->write_slot());
+    snapshots->publish();
+
+    // the back buffer starts out unknown, so its first frame is drawn and
+    // copied whole
+    backbuffer.reset(new uint32_t[SCREEN_HEIGHT][SCREEN_WIDTH]);
+    renderTarget = backbuffer.get();
+    damage_invalidate_all();
+    framePending = false;
+
+    stats = PipelineStats();
+    simStage.start(run_step);
+    renderStage.start(run_render);
+    running = true;
+}
+
+static void stop() {
+    simStage.wait();
+    renderStage.wait();
+
+    // draw the last step unless frames were never drawn
+    bool drawing = stats.rendered > 0;
+    copy_pending_frame();
+    if (drawing) {
+        renderStage.post();
+        framePending = true;
+        renderStage.wait();
+        copy_pending_frame();
+    }
+
+    simStage.stop();
+    renderStage.stop();
+    running = false;
+
+    // buffer now holds what the back buffer does, which the damage
+    // tracking describes
+    renderTarget = buffer;
+    backbuffer.reset();
+    snapshots.reset();
+}
+
+void pipeline_set_enabled(bool enabled) {
+    if (enabled == running) return;
+    if (enabled) start();
+    else stop();
+}
+
+bool pipeline_enabled() {
+    return running;
+}
+
+void pipeline_wait_step() {
+    if (running) simStage.wait();
+}
+
+void pipeline_submit(float dt, uint8_t input) {
+    simStage.wait();
+    stepDt = dt;
+    stepInput = input;
+    simStage.post();
+}
+
+void pipeline_present() {
+    uint64_t start = profile_now_ns();
+    renderStage.wait();
+    copy_pending_frame();
+    renderStage.post();
+    framePending = true;
+    stats.presentNs += profile_now_ns() - start;
+}
+
+PipelineStats pipeline_stats() {
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+//  Pipelined frames: simulation, rendering and presentation overlap.
+//
+//  Normally act() steps gameWorld and draw() renders it right after on the
+//  engine thread, so a frame costs the simulation plus the rendering. With
+//  the pipeline on, act() hands its frame time and input to a simulation
+//  thread, which steps gameWorld and publishes a copy of what drawing reads
+//  through a lock-free triple buffer (see TripleBuffer.h). draw() presents
+//  the frame a render thread finished last time, by copying its dirty
+//  rectangles (see Damage.h) from the render thread's back buffer into
+//  buffer, and hands the render thread the newest published world. While
+//  the engine shows buffer, the render thread draws the next frame and the
+//  simulation thread steps the one after, so a frame costs about
+//  max(simulation, rendering); what is shown lags the input by one frame.
+//
+//  The simulation thread owns gameWorld from pipeline_submit() until
+//  pipeline_wait_step() returns. Steps run one at a time in frame order,
+//  so recorded and replayed sessions see the same hashes as without the
+//  pipeline.
+//
+//  The profiler keeps a rolling window per thread and the overlay sums
+//  them, so with the pipeline on it shows the simulation thread's phases
+//  and the render thread's together.
+//
+
+struct PipelineStats {
+    uint64_t steps;        // act() frames run on the simulation thread
+    uint64_t rendered;     // frames the render thread drew
+    uint64_t repeated;     // rendered frames that showed no newer step than the one before
+    uint64_t simNs;        // simulation thread busy time, total
+    uint64_t renderNs;     // render thread busy time, total
+    uint64_t presentNs;    // engine thread time waiting for the render thread and copying
+    uint64_t copiedPixels; // copied into buffer by the presents
+};
+
+// Starts or stops the simulation and render threads; call between frames.
+// Stopping waits for the last step and presents it, so buffer ends up as
+// the sequential draw() would have left it.
+void pipeline_set_enabled(bool enabled);
+bool pipeline_enabled();
+
+// act(): waits until the simulation thread is done with gameWorld
+void pipeline_wait_step();
+
+// act(): starts stepping gameWorld by one frame
+void pipeline_submit(float dt, uint8_t input);
+
+// draw(): presents the last rendered frame and starts rendering the next
+void pipeline_present();
+
+// Counts since the pipeline was last enabled
+PipelineStats pipeline_stats();
@@ -0,0 +1,82 @@
+#include "Pool.h"
+#include <string.h>
+
+void PoolSlots::reserve(int n) {
+    int old = capacity();
+    if (n <= old) return;
+
+    denseToSlot.resize(n);
+    slotIndex.resize(n);
+    generation.resize(n, 0);
+
+    // push the new slots so the lowest one is handed out first
+    for (int slot = n - 1; slot >= old; slot--) {
+        slotIndex[slot] = freeHead;
+        freeHead = (uint32_t)slot;
+    }
+}
+
+void PoolSlots::clear() {
+    for (int i = 0; i < live; i++) {
+        generation[denseToSlot[i]]++;
+    }
+    live = 0;
+
+    freeHead = NO_SLOT;
+    for (int slot = capacity() - 1; slot >= 0; slot--) {
+        slotIndex[slot] = freeHead;
+        freeHead = (uint32_t)slot;
+    }
+}
+
+PoolHandle PoolSlots::allocate() {
+    uint32_t slot = freeHead;
+    freeHead = slotIndex[slot];
+
+    generation[slot]++;
+    slotIndex[slot] = (uint32_t)live;
+    denseToSlot[live] = slot;
+    live++;
+
+    PoolHandle handle = { slot, generation[slot] };
+    return handle;
+}
+
+void PoolSlots::release(int i) {
+    uint32_t slot = denseToSlot[i];
+    int last = live - 1;
+
+    if (i != last) {
+        uint32_t moved = denseToSlot[last];
+        denseToSlot[i] = moved;
+        slotIndex[moved] = (uint32_t)i;
+    }
+    live--;
+
+    generation[slot]++;
+    slotIndex[slot] = freeHead;
+    freeHead = slot;
+}
+
+// live, freeHead, then denseToSlot, slotIndex and generation at full capacity
+void PoolSlots::save_state(uint8_t* out) const {
+    size_t table = generation.size() * sizeof(uint32_t);
+    uint32_t head[2] = { (uint32_t)live, freeHead };
+    memcpy(out, head, sizeof(head));
+    out += sizeof(head);
+    memcpy(out, denseToSlot.data(), live * sizeof(uint32_t)); // the rest is unused
+    memcpy(out + table, slotIndex.data(), table);
+    memcpy(out + 2 * table, generation.data(), table);
+}
+
+void PoolSlots::restore_state(const uint8_t* in) {
+    size_t table = generation.size() * sizeof(uint32_t);
+    uint32_t head[2];
+    memcpy(head, in, sizeof(head));
+    in += sizeof(head);
+    live = (int)head[0];
+    freeHead = head[1];
+    memcpy(denseToSlot.data(), in, live * sizeof(uint32_t));
+    memcpy(slotIndex.data(), in + table, table);
+    memcpy(generation.data(), in + 2 * table, table);
+}
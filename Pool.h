@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//
+//  Handle table for fixed-capacity object pools.
+//
+//  A pool keeps its elements densely packed in [0, count) so update loops
+//  stream over them, and removal moves the last element into the hole.
+//  Dense indices therefore change; a PoolHandle does not. It names a slot,
+//  the slot remembers where its element currently is, and a generation
+//  counter turns handles to removed elements stale. Free slots are kept on
+//  an intrusive free list, so adding and removing never allocate once the
+//  capacity is reserved.
+//
+
+struct PoolHandle {
+    uint32_t slot;
+    uint32_t generation; // odd while the slot is in use
+};
+
+const PoolHandle INVALID_POOL_HANDLE = { 0xFFFFFFFFu, 0 };
+
+class PoolSlots {
+public:
+    PoolSlots() : live(0), freeHead(NO_SLOT) {}
+
+    int capacity() const { return (int)generation.size(); }
+    int count() const { return live; }
+
+    // Grows the capacity to at least n slots; existing handles stay valid
+    void reserve(int n);
+
+    // Frees every slot; all outstanding handles become stale
+    void clear();
+
+    // Takes a free slot for the element appended at index count(). The
+    // caller checks count() < capacity() first.
+    PoolHandle allocate();
+
+    // Frees the slot of element i after the pool moved its last element
+    // into i (or popped it, if i was the last)
+    void release(int i);
+
+    // The tables as state_bytes() flat bytes, so a pool can be saved and
+    // restored without allocating; restoring needs the same capacity
+    size_t state_bytes() const { return 2 * sizeof(uint32_t) + 3 * generation.size() * sizeof(uint32_t); }
+    void save_state(uint8_t* out) const;
+    void restore_state(const uint8_t* in);
+
+    PoolHandle handle_of(int i) const {
+        uint32_t slot = denseToSlot[i];
+        PoolHandle handle = { slot, generation[slot] };
+        return handle;
+    }
+
+    // Current index of the element, or -1 if it was removed
+    int index_of(PoolHandle handle) const {
+        if (handle.slot >= generation.size() || generation[handle.slot] != handle.generation) return -1;
+        return (int)slotIndex[handle.slot];
+    }
+
+private:
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    int live;
+    uint32_t freeHead;
+    std::vector<uint32_t> denseToSlot; // slot of each element
+    std::vector<uint32_t> slotIndex;   // element index of a used slot, next free slot of a free one
+    std::vector<uint32_t> generation;
+};
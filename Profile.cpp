@@ -0,0 +1,281 @@
+#include "Profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+thread_local uint64_t profilePhaseNs[PROFILE_LABEL_COUNT] = { 0 };
+
+const char* profile_phase_name(int phase) {
+    static const char* names[PROFILE_LABEL_COUNT] = {
+        "integration",
+        "bullet_collisions",
+        "ship_collisions",
+        "compaction",
+        "particle_update",
+        "clear",
+        "asteroid_raster",
+        "bullet_raster",
+        "ship_raster",
+        "particle_raster",
+        "hud_text",
+        "band_raster",
+        "capture",
+        "act",
+        "tick",
+        "draw",
+    };
+    return phase >= 0 && phase < PROFILE_LABEL_COUNT ? names[phase] : "unknown";
+}
+
+static const char* counter_name(int counter) {
+    static const char* names[PROFILE_COUNTER_COUNT] = {
+        "asteroids",
+        "bullets",
+        "particles",
+    };
+    return counter >= 0 && counter < PROFILE_COUNTER_COUNT ? names[counter] : "unknown";
+}
+
+void profile_reset_phases() {
+    memset(profilePhaseNs, 0, sizeof(profilePhaseNs));
+}
+
+uint64_t profile_now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --- Event rings ---
+
+struct ProfileEvent {
+    uint64_t start;  // ns, profile_now_ns() clock
+    uint32_t value;  // duration in ns of a scope, the sample of a counter
+    uint16_t label;  // ProfileLabel or ProfileCounter
+    uint16_t counter;
+};
+
+// One event, readable while its owner may be overwriting it: sequence is
+// the event's number + 1 once written and 0 while it is being written, so
+// a reader that finds the same number before and after copying the fields
+// has a whole event
+struct ProfileSlot {
+    std::atomic<uint64_t> sequence{ 0 };
+    std::atomic<uint64_t> start{ 0 };
+    std::atomic<uint64_t> fields{ 0 }; // value, label << 32, counter << 48
+};
+
+struct ProfileRing {
+    ProfileSlot slots[PROFILE_RING_SIZE];
+    std::atomic<uint64_t> written{ 0 }; // events ever recorded; the newest is at written - 1
+};
+
+// Rings are kept after their thread exits, so a trace still shows its events
+static std::mutex ringsMutex;
+static std::vector<ProfileRing*> rings;
+static thread_local ProfileRing* threadRing = nullptr;
+
+static void record(const ProfileEvent& event) {
+    if (!threadRing) {
+        ProfileRing* ring = new ProfileRing();
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(ring);
+        threadRing = ring;
+    }
+    // the owner is the only writer
+    uint64_t n = threadRing->written.load(std::memory_order_relaxed);
+    ProfileSlot& slot = threadRing->slots[n % PROFILE_RING_SIZE];
+    // a reader that sees either field's new value also sees the 0 before it
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.start.store(event.start, std::memory_order_release);
+    slot.fields.store(event.value | (uint64_t)event.label << 32 | (uint64_t)event.counter << 48,
+                      std::memory_order_release);
+    slot.sequence.store(n + 1, std::memory_order_release);
+    threadRing->written.store(n + 1, std::memory_order_release);
+}
+
+// Copies event n of a ring; false if it was overwritten before or while
+// it was copied
+static bool read_event(const ProfileRing& ring, uint64_t n, ProfileEvent& event) {
+    const ProfileSlot& slot = ring.slots[n % PROFILE_RING_SIZE];
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != n + 1) return false;
+    uint64_t start = slot.start.load(std::memory_order_acquire);
+    uint64_t fields = slot.fields.load(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) return false;
+
+    event.start = start;
+    event.value = (uint32_t)fields;
+    event.label = (uint16_t)(fields >> 32);
+    event.counter = (uint16_t)(fields >> 48);
+    return true;
+}
+
+void profile_record_scope(int label, uint64_t start, uint64_t end) {
+    uint64_t duration = end - start;
+    ProfileEvent event = { start, (uint32_t)std::min<uint64_t>(duration, 0xFFFFFFFFu), (uint16_t)label, 0 };
+    record(event);
+}
+
+void profile_record_counter(int counter, uint32_t value) {
+    ProfileEvent event = { profile_now_ns(), value, (uint16_t)counter, 1 };
+    record(event);
+}
+
+bool profile_write_trace(const char* path, std::string* error) {
+    struct TraceEvent {
+        int thread;
+        ProfileEvent event;
+    };
+    std::vector<TraceEvent> events;
+    int threads = 0;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        threads = (int)rings.size();
+        for (int t = 0; t < threads; t++) {
+            const ProfileRing& ring = *rings[t];
+            uint64_t end = ring.written.load(std::memory_order_acquire);
+            uint64_t begin = end > (uint64_t)PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+            for (uint64_t n = begin; n < end; n++) {
+                TraceEvent copy;
+                copy.thread = t;
+                if (read_event(ring, n, copy.event)) events.push_back(copy);
+            }
+        }
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        if (error) *error = "cannot open for writing";
+        return false;
+    }
+
+    uint64_t origin = UINT64_MAX;
+    for (const TraceEvent& e : events) origin = std::min(origin, e.event.start);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (int t = 0; t < threads; t++) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"thread %d\"}},\n", t, t);
+    }
+    for (const TraceEvent& e : events) {
+        double ts = (e.event.start - origin) / 1000.0;
+        if (e.event.counter) {
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                          "\"args\":{\"count\":%u}},\n",
+                    counter_name(e.event.label), ts, e.thread, e.event.value);
+        } else {
+            fprintf(file, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                          "\"pid\":1,\"tid\":%d},\n",
+                    profile_phase_name(e.event.label), e.event.label < PHASE_COUNT ? "phase" : "zone",
+                    ts, e.event.value / 1000.0, e.thread);
+        }
+    }
+    // metadata closes the list, so every event above can end in a comma
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"asteroids\"}}\n]}\n");
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    if (!ok && error) *error = "write failed";
+    return ok;
+}
+
+// --- Rolling window ---
+
+// One window per thread that closes frames, in a fixed table so closing
+// the first frame allocates nothing; the mutex guards every window's rows
+struct ProfileWindow {
+    uint64_t ns[PROFILE_WINDOW][PROFILE_LABEL_COUNT];
+    int framesClosed;
+};
+
+static std::mutex windowsMutex;
+static ProfileWindow windows[PROFILE_WINDOW_THREADS];
+static int windowsClaimed = 0;
+static thread_local ProfileWindow* threadWindow = nullptr;
+static thread_local uint64_t lastFrameNs[PROFILE_LABEL_COUNT];
+
+void profile_end_frame() {
+    uint64_t frame[PROFILE_LABEL_COUNT];
+    for (int label = 0; label < PROFILE_LABEL_COUNT; label++) {
+        uint64_t now = profilePhaseNs[label];
+        // a reset since the last frame restarts the count from zero
+        frame[label] = now >= lastFrameNs[label] ? now - lastFrameNs[label] : now;
+        lastFrameNs[label] = now;
+    }
+
+    std::lock_guard<std::mutex> lock(windowsMutex);
+    if (!threadWindow) {
+        if (windowsClaimed == PROFILE_WINDOW_THREADS) return;
+        threadWindow = &windows[windowsClaimed++];
+    }
+    memcpy(threadWindow->ns[threadWindow->framesClosed % PROFILE_WINDOW], frame, sizeof(frame));
+    threadWindow->framesClosed++;
+}
+
+void profile_rolling(int label, uint64_t& mean, uint64_t& max) {
+    std::lock_guard<std::mutex> lock(windowsMutex);
+    mean = max = 0;
+    for (int w = 0; w < windowsClaimed; w++) {
+        const ProfileWindow& window = windows[w];
+        int frames = std::min(window.framesClosed, PROFILE_WINDOW);
+        if (frames == 0) continue;
+
+        uint64_t sum = 0, threadMax = 0;
+        for (int f = 0; f < frames; f++) {
+            sum += window.ns[f][label];
+            threadMax = std::max(threadMax, window.ns[f][label]);
+        }
+        mean += sum / frames;
+        max += threadMax;
+    }
+}
+
+#ifdef ASTEROIDS_PROFILE
+
+// Counting replacements of the global allocation functions. The nothrow
+// forms of the standard library forward to these.
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+uint64_t profile_allocation_count() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+#else
+
+uint64_t profile_allocation_count() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//
+//  Per-phase frame timers for act() and draw().
+//  Compiled in only when ASTEROIDS_PROFILE is defined, otherwise
+//  PROFILE_PHASE() expands to nothing.
+//
+//  Every timed scope is also appended to a ring buffer of the thread it ran
+//  on. A thread only ever writes its own ring, and each slot carries a
+//  sequence number a reader checks before and after copying the event, so
+//  recording takes no lock and a reader never keeps a half-written event;
+//  the rings are registered once per thread and read by
+//  profile_write_trace(), which writes the events still held as Chrome
+//  trace-event JSON.
+//
+
+enum ProfilePhase {
+    PHASE_INTEGRATION,
+    PHASE_BULLET_COLLISIONS,
+    PHASE_SHIP_COLLISIONS,
+    PHASE_COMPACTION,
+    PHASE_PARTICLE_UPDATE,
+    PHASE_CLEAR,
+    PHASE_ASTEROID_RASTER,
+    PHASE_BULLET_RASTER,
+    PHASE_SHIP_RASTER,
+    PHASE_PARTICLE_RASTER,
+    PHASE_HUD_TEXT,
+    PHASE_BAND_RASTER,
+    PHASE_CAPTURE,
+    PHASE_COUNT,
+
+    // Scopes around whole calls, enclosing the phases above
+    ZONE_ACT = PHASE_COUNT,
+    ZONE_TICK,
+    ZONE_DRAW,
+    PROFILE_LABEL_COUNT
+};
+
+// Values sampled once per frame, shown as counter tracks in a trace
+enum ProfileCounter {
+    COUNTER_ASTEROIDS,
+    COUNTER_BULLETS,
+    COUNTER_PARTICLES,
+    PROFILE_COUNTER_COUNT
+};
+
+const char* profile_phase_name(int phase);
+
+// Nanoseconds spent in each phase or zone since the last
+// profile_reset_phases(), per thread so worlds stepped in parallel do not
+// share counters
+extern thread_local uint64_t profilePhaseNs[PROFILE_LABEL_COUNT];
+
+void profile_reset_phases();
+uint64_t profile_now_ns();
+
+// Heap allocations (operator new calls) since startup, on all threads;
+// always 0 without ASTEROIDS_PROFILE
+uint64_t profile_allocation_count();
+
+// Events kept per thread; older ones are overwritten
+const int PROFILE_RING_SIZE = 1 << 16;
+
+// Appends a finished scope or a counter sample to this thread's ring
+void profile_record_scope(int label, uint64_t start, uint64_t end);
+void profile_record_counter(int counter, uint32_t value);
+
+// Closes a frame for the rolling statistics: adds this thread's phase time
+// since the previous call to its window of the last PROFILE_WINDOW frames.
+// The first PROFILE_WINDOW_THREADS threads to close a frame get a window.
+const int PROFILE_WINDOW = 60;
+const int PROFILE_WINDOW_THREADS = 8;
+void profile_end_frame();
+
+// Mean and maximum nanoseconds of a phase or zone per frame over the
+// windows of every thread that closes frames (the simulation and render
+// threads when pipelined): the means add up, and so do the maxima, which
+// bounds the slowest frame of a phase timed on more than one thread
+void profile_rolling(int label, uint64_t& mean, uint64_t& max);
+
+// Writes every event still held in the rings as Chrome trace-event JSON
+// (chrome://tracing, Perfetto)
+bool profile_write_trace(const char* path, std::string* error);
+
+struct ProfileScope {
+    int phase;
+    uint64_t start;
+
+    explicit ProfileScope(int phase) : phase(phase), start(profile_now_ns()) {}
+    ~ProfileScope() {
+        uint64_t end = profile_now_ns();
+        profilePhaseNs[phase] += end - start;
+        profile_record_scope(phase, start, end);
+    }
+};
+
+#ifdef ASTEROIDS_PROFILE
+#  define PROFILE_CONCAT2(a, b) a##b
+#  define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#  define PROFILE_PHASE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#  define PROFILE_COUNTER(counter, value) profile_record_counter(counter, (uint32_t)(value))
+#  define PROFILE_END_FRAME() profile_end_frame()
+const bool PROFILE_ENABLED = true;
+#else
+#  define PROFILE_PHASE(phase) ((void)0)
+#  define PROFILE_COUNTER(counter, value) ((void)0)
+#  define PROFILE_END_FRAME() ((void)0)
+const bool PROFILE_ENABLED = false;
+#endif
@@ -0,0 +1,554 @@
+#include "Raster.h"
+#include "Simd.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+uint32_t (*renderTarget)[SCREEN_WIDTH] = buffer;
+
+// Every filled primitive writes its rows through here
+static inline void span(uint32_t* dst, int count, uint32_t color, BlendMode blend) {
+    switch (blend) {
+        case BLEND_OPAQUE: fill_span(dst, count, color); break;
+        case BLEND_OVER: blend_span_over(dst, count, color); break;
+        case BLEND_ADD: blend_span_add(dst, count, color); break;
+    }
+}
+
+static void raster_rect(int x, int y, int width, int height, uint32_t color, BlendMode blend, int clipY0, int clipY1) {
+    // clip once, then fill whole rows
+    int x0 = std::max(x, 0), x1 = std::min(x + width, SCREEN_WIDTH);
+    int y0 = std::max(y, clipY0), y1 = std::min(y + height, clipY1);
+    if (x0 >= x1) return;
+    
+    for (int py = y0; py < y1; py++) {
+        span(&renderTarget[py][x0], x1 - x0, color, blend);
+    }
+}
+
+static void raster_image(int x, int y, int width, int height, const uint32_t* pixels, BlendMode blend,
+                         int clipY0, int clipY1) {
+    int x0 = std::max(x, 0), x1 = std::min(x + width, SCREEN_WIDTH);
+    int y0 = std::max(y, clipY0), y1 = std::min(y + height, clipY1);
+    if (x0 >= x1) return;
+    
+    for (int py = y0; py < y1; py++) {
+        uint32_t* dst = &renderTarget[py][x0];
+        const uint32_t* src = pixels + (size_t)(py - y) * width + (x0 - x);
+        switch (blend) {
+            case BLEND_OPAQUE: memcpy(dst, src, (x1 - x0) * sizeof(uint32_t)); break;
+            case BLEND_OVER: blend_over(dst, src, x1 - x0); break;
+            case BLEND_ADD: blend_add(dst, src, x1 - x0); break;
+        }
+    }
+}
+
+static void raster_sprite(int x, int y, const SpanSprite& sprite, uint32_t color, BlendMode blend, int clipY0, int clipY1) {
+    // only the rows inside the band
+    int first = std::max(sprite.y0, clipY0 - y), last = std::min(sprite.y1, clipY1 - y);
+    for (int row = first; row < last; row++) {
+        const SpriteSpan& run = sprite.spans[row - sprite.y0];
+        int x0 = std::max(x + run.x, 0), x1 = std::min(x + run.x + run.length, SCREEN_WIDTH);
+        if (x0 < x1) span(&renderTarget[y + row][x0], x1 - x0, color, blend);
+    }
+}
+
+// Per-byte a + b, saturating at 255
+static inline uint32_t add_saturate(uint32_t a, uint32_t b) {
+    uint32_t low = (a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu); // no carry crosses a byte
+    uint32_t carry = ((a & b) | (low & (a | b))) & 0x80808080u;
+    return (low ^ ((a ^ b) & 0x80808080u)) | ((carry >> 7) * 0xFFu);
+}
+
+static void raster_points(const PointList& points, int clipY0, int clipY1) {
+    // bins whose rows are within a streak of the band
+    const int reach = POINT_STREAK_PIXELS - 1;
+    int firstBin = std::max(clipY0 - reach, 0) >> POINT_BIN_SHIFT;
+    int lastBin = std::min(clipY1 - 1 + reach, SCREEN_HEIGHT - 1) >> POINT_BIN_SHIFT;
+
+    for (int i = points.binStart[firstBin]; i < points.binStart[lastBin + 1]; i++) {
+        const PointSprite sprite = points.sprites[i]; // a copy: the pixel writes could alias it
+        int32_t x = sprite.x, y = sprite.y;
+        for (int k = 0; k <= sprite.steps; k++, x += sprite.stepX, y += sprite.stepY) {
+            // arithmetic shifts round the points just off screen down
+            int px = x >> 16, py = y >> 16;
+            if ((unsigned)px >= (unsigned)SCREEN_WIDTH || py < clipY0 || py >= clipY1) continue;
+            uint32_t& pixel = renderTarget[py][px];
+            pixel = add_saturate(pixel, sprite.color);
+        }
+    }
+}
+
+static void raster_circle(int centerX, int centerY, int radius, uint32_t color, BlendMode blend, int clipY0, int clipY1) {
+    if (radius < 0) return;
+
+    // Each row y is filled from -halfWidth to halfWidth, where halfWidth is the
+    // largest x with x * x + y * y <= radius * radius. It only shrinks as y
+    // grows, so it is found by stepping down from the previous row.
+    int halfWidth = radius;
+    for (int y = 0; y <= radius; y++) {
+        while (halfWidth * halfWidth + y * y > radius * radius) {
+            halfWidth--;
+        }
+
+        int x0 = std::max(centerX - halfWidth, 0);
+        int x1 = std::min(centerX + halfWidth, SCREEN_WIDTH - 1);
+        if (x0 > x1) continue;
+
+        int top = centerY - y;
+        int bottom = centerY + y;
+        if (top >= clipY0 && top < clipY1) {
+            span(&renderTarget[top][x0], x1 - x0 + 1, color, blend);
+        }
+        if (y != 0 && bottom >= clipY0 && bottom < clipY1) {
+            span(&renderTarget[bottom][x0], x1 - x0 + 1, color, blend);
+        }
+    }
+}
+
+// Fixed-point precision of triangle vertices: 1/256 pixel
+static const int SUBPIXEL_BITS = 8;
+static const int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// Vertices further out than this are rejected so the edge functions fit in 64 bits
+static const float TRIANGLE_COORD_LIMIT = 65536.0f;
+
+struct EdgeFunction {
+    int64_t stepX, stepY; // change per pixel to the right and per row down
+    int64_t value;        // at the current pixel, minus one if the edge is not top-left
+};
+
+// Edge a->b of a triangle whose interior lies on the positive side.
+// Pixels exactly on the edge belong to the triangle only for top and left
+// edges, so triangles sharing an edge never fill a pixel twice.
+static EdgeFunction edge_function(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t px, int64_t py) {
+    int64_t dx = bx - ax;
+    int64_t dy = by - ay;
+    bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+    
+    EdgeFunction e;
+    e.stepX = -dy * SUBPIXEL_ONE;
+    e.stepY = dx * SUBPIXEL_ONE;
+    e.value = dx * (py - ay) - dy * (px - ax) - (topLeft ? 0 : 1);
+    return e;
+}
+
+// Pixels are sampled at their integer coordinates, like the circles.
+// The bounding box is clipped to the screen once, up front.
+static bool triangle_bounds(const float* vx, const float* vy, int& minX, int& minY, int& maxX, int& maxY) {
+    float minXf = fminf(fminf(vx[0], vx[1]), vx[2]);
+    float maxXf = fmaxf(fmaxf(vx[0], vx[1]), vx[2]);
+    float minYf = fminf(fminf(vy[0], vy[1]), vy[2]);
+    float maxYf = fmaxf(fmaxf(vy[0], vy[1]), vy[2]);
+    if (!(minXf > -TRIANGLE_COORD_LIMIT && maxXf < TRIANGLE_COORD_LIMIT &&
+          minYf > -TRIANGLE_COORD_LIMIT && maxYf < TRIANGLE_COORD_LIMIT)) return false;
+    
+    minX = std::max((int)ceilf(minXf), 0);
+    maxX = std::min((int)floorf(maxXf), SCREEN_WIDTH - 1);
+    minY = std::max((int)ceilf(minYf), 0);
+    maxY = std::min((int)floorf(maxYf), SCREEN_HEIGHT - 1);
+    return minX <= maxX && minY <= maxY;
+}
+
+static void raster_triangle(const float* vx, const float* vy, uint32_t color, BlendMode blend, int clipY0, int clipY1) {
+    int minX, minY, maxX, maxY;
+    if (!triangle_bounds(vx, vy, minX, minY, maxX, maxY)) return;
+    minY = std::max(minY, clipY0);
+    maxY = std::min(maxY, clipY1 - 1);
+    if (minY > maxY) return;
+    
+    int64_t ax = llrintf(vx[0] * SUBPIXEL_ONE), ay = llrintf(vy[0] * SUBPIXEL_ONE);
+    int64_t bx = llrintf(vx[1] * SUBPIXEL_ONE), by = llrintf(vy[1] * SUBPIXEL_ONE);
+    int64_t cx = llrintf(vx[2] * SUBPIXEL_ONE), cy = llrintf(vy[2] * SUBPIXEL_ONE);
+    
+    // Orient the triangle so its interior is on the positive side of every edge
+    int64_t area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    if (area == 0) return;
+    if (area < 0) {
+        std::swap(bx, cx);
+        std::swap(by, cy);
+    }
+    
+    int64_t px = (int64_t)minX * SUBPIXEL_ONE;
+    int64_t py = (int64_t)minY * SUBPIXEL_ONE;
+    EdgeFunction e0 = edge_function(bx, by, cx, cy, px, py);
+    EdgeFunction e1 = edge_function(cx, cy, ax, ay, px, py);
+    EdgeFunction e2 = edge_function(ax, ay, bx, by, px, py);
+    
+    for (int y = minY; y <= maxY; y++) {
+        int64_t w0 = e0.value, w1 = e1.value, w2 = e2.value;
+        int start = -1, end = maxX + 1;
+        
+        for (int x = minX; x <= maxX; x++) {
+            if ((w0 | w1 | w2) >= 0) {
+                if (start < 0) start = x;
+            } else if (start >= 0) {
+                end = x; // the triangle is convex, so the row span has ended
+                break;
+            }
+            w0 += e0.stepX;
+            w1 += e1.stepX;
+            w2 += e2.stepX;
+        }
+        if (start >= 0) span(&renderTarget[y][start], end - start, color, blend);
+        
+        e0.value += e0.stepY;
+        e1.value += e1.stepY;
+        e2.value += e2.stepY;
+    }
+}
+
+// 1-bit glyph atlas: one byte per glyph row, bit x set if column x is lit.
+// Characters without a shape stay empty.
+static uint8_t glyphAtlas[256][GLYPH_HEIGHT];
+
+static void glyph_rect(uint8_t* glyph, int x, int y, int width, int height) {
+    uint8_t bits = (uint8_t)(((1 << width) - 1) << x);
+    for (int row = y; row < y + height; row++) {
+        glyph[row] |= bits;
+    }
+}
+
+// Improved text rendering with more readable characters
+static void bake_glyph(char c, uint8_t* glyph) {
+    if (c >= '0' && c <= '9') {
+        int digit = c - '0';
+        // Draw digits as more distinguishable shapes
+        switch (digit) {
+            case 0: // 0
+                glyph_rect(glyph, 0, 0, 8, 2);     // top
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                glyph_rect(glyph, 0, 0, 2, 16);     // left
+                glyph_rect(glyph, 6, 0, 2, 16);  // right
+                break;
+            case 1: // 1
+                glyph_rect(glyph, 3, 0, 2, 16);  // vertical line
+                break;
+            case 2: // 2
+                glyph_rect(glyph, 0, 0, 8, 2);      // top
+                glyph_rect(glyph, 6, 2, 2, 6); // top right
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 0, 10, 2, 6);  // bottom left
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+            case 3: // 3
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 6, 2, 2, 6); // top right
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 6, 10, 2, 6); // bottom right
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+            case 4: // 4
+                glyph_rect(glyph, 0, 0, 2, 8);      // top left
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 6, 0, 2, 16);  // right
+                break;
+            case 5: // 5
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 0, 2, 2, 6);   // top left
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 6, 10, 2, 6); // bottom right
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+            case 6: // 6
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 0, 2, 2, 14);  // left (reduced height to avoid tail)
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 6, 10, 2, 6); // bottom right
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+            case 7: // 7
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 6, 2, 2, 14); // right
+                break;
+            case 8: // 8
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 0, 0, 2, 16);      // left
+                glyph_rect(glyph, 6, 0, 2, 16);  // right
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+            case 9: // 9
+                glyph_rect(glyph, 0, 0, 8, 2);       // top
+                glyph_rect(glyph, 0, 0, 2, 8);       // top left
+                glyph_rect(glyph, 6, 0, 2, 16);  // right
+                glyph_rect(glyph, 0, 8, 8, 2);  // middle
+                glyph_rect(glyph, 0, 14, 8, 2); // bottom
+                break;
+        }
+    } else if (c >= 'A' && c <= 'Z') {
+        // Simple letter rendering - draw recognizable letter shapes
+        char letter = c;
+        switch (letter) {
+            case 'L': // L
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 14, 8, 2);   // bottom horizontal
+                break;
+            case 'I': // I
+                glyph_rect(glyph, 3, 0, 2, 16);  // vertical line
+                break;
+            case 'V': // V
+                glyph_rect(glyph, 0, 0, 2, 12);       // left diagonal
+                glyph_rect(glyph, 6, 0, 2, 12);   // right diagonal
+                glyph_rect(glyph, 2, 12, 4, 2); // bottom point
+                break;
+            case 'E': // E
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 7, 6, 2);   // middle horizontal
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            case 'S': // S
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 2, 2, 6);    // top left vertical
+                glyph_rect(glyph, 0, 8, 8, 2);   // middle horizontal
+                glyph_rect(glyph, 6, 10, 2, 6); // bottom right vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            case 'C': // C
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            case 'O': // O
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);   // right vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            case 'R': // R
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 6, 2, 2, 6); // right vertical
+                glyph_rect(glyph, 0, 8, 8, 2);   // middle horizontal
+                glyph_rect(glyph, 4, 10, 2, 6); // diagonal
+                break;
+            case 'F': // F
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 7, 6, 2);   // middle horizontal
+                break;
+            case 'N': // N
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);  // right vertical
+                glyph_rect(glyph, 2, 2, 2, 4); // diagonal
+                glyph_rect(glyph, 4, 6, 2, 4); // diagonal
+                break;
+            case 'A': // A
+                glyph_rect(glyph, 2, 0, 4, 2);      // top horizontal
+                glyph_rect(glyph, 0, 2, 2, 6);      // left diagonal
+                glyph_rect(glyph, 6, 2, 2, 6);  // right diagonal
+                glyph_rect(glyph, 0, 8, 8, 2);      // middle horizontal (crossbar)
+                glyph_rect(glyph, 0, 10, 2, 6);     // left vertical (foot)
+                glyph_rect(glyph, 6, 10, 2, 6); // right vertical (foot)
+                break;
+            case 'T': // T
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 3, 0, 2, 16);  // vertical line
+                break;
+            case 'Y': // Y
+                glyph_rect(glyph, 1, 0, 2, 6);   // left diagonal
+                glyph_rect(glyph, 5, 0, 2, 6);   // right diagonal
+                glyph_rect(glyph, 3, 6, 2, 10); // vertical line
+                break;
+            case 'G': // G
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                glyph_rect(glyph, 6, 8, 2, 8); // right vertical
+                glyph_rect(glyph, 4, 8, 4, 2); // middle extension
+                break;
+            case 'M': // M
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);  // right vertical
+                glyph_rect(glyph, 2, 0, 2, 6);    // left diagonal
+                glyph_rect(glyph, 4, 0, 2, 6);    // right diagonal
+                break;
+            case 'P': // P
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 6, 2, 2, 6); // right vertical
+                glyph_rect(glyph, 0, 8, 8, 2);   // middle horizontal
+                break;
+            case 'U': // U
+                glyph_rect(glyph, 0, 0, 2, 14);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 14);  // right vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            case 'H': // H
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);  // right vertical
+                glyph_rect(glyph, 0, 8, 8, 2);   // middle horizontal
+                break;
+            case 'D': // D
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 6, 2);       // top horizontal
+                glyph_rect(glyph, 4, 2, 2, 12); // right vertical
+                glyph_rect(glyph, 0, 14, 6, 2);  // bottom horizontal
+                break;
+            case 'B': // B
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 0, 0, 6, 2);       // top horizontal
+                glyph_rect(glyph, 4, 2, 2, 6); // right vertical
+                glyph_rect(glyph, 0, 8, 6, 2);   // middle horizontal
+                glyph_rect(glyph, 4, 10, 2, 6); // right vertical
+                glyph_rect(glyph, 0, 14, 6, 2);  // bottom horizontal
+                break;
+            case 'J': // J
+                glyph_rect(glyph, 4, 0, 2, 12);  // vertical line
+                glyph_rect(glyph, 0, 12, 6, 2);  // bottom horizontal
+                glyph_rect(glyph, 0, 14, 2, 2);  // left hook
+                break;
+            case 'K': // K
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 2, 6, 2, 2); // middle diagonal
+                glyph_rect(glyph, 4, 4, 2, 2); // upper diagonal
+                glyph_rect(glyph, 4, 8, 2, 2); // lower diagonal
+                glyph_rect(glyph, 6, 2, 2, 2); // upper right
+                glyph_rect(glyph, 6, 10, 2, 2); // lower right
+                break;
+            case 'Q': // Q
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);  // right vertical
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                glyph_rect(glyph, 4, 10, 2, 6); // tail
+                break;
+            case 'W': // W
+                glyph_rect(glyph, 0, 0, 2, 16);      // left vertical
+                glyph_rect(glyph, 6, 0, 2, 16);  // right vertical
+                glyph_rect(glyph, 2, 10, 2, 6); // left diagonal
+                glyph_rect(glyph, 4, 10, 2, 6); // right diagonal
+                break;
+            case 'X': // X
+                glyph_rect(glyph, 0, 0, 2, 6);       // top left diagonal
+                glyph_rect(glyph, 6, 0, 2, 6);   // top right diagonal
+                glyph_rect(glyph, 2, 6, 4, 2); // middle
+                glyph_rect(glyph, 0, 10, 2, 6);   // bottom left diagonal
+                glyph_rect(glyph, 6, 10, 2, 6); // bottom right diagonal
+                break;
+            case 'Z': // Z
+                glyph_rect(glyph, 0, 0, 8, 2);       // top horizontal
+                glyph_rect(glyph, 6, 2, 2, 2); // diagonal
+                glyph_rect(glyph, 4, 4, 2, 2); // diagonal
+                glyph_rect(glyph, 2, 6, 2, 2); // diagonal
+                glyph_rect(glyph, 0, 8, 2, 2);    // diagonal
+                glyph_rect(glyph, 0, 14, 8, 2);  // bottom horizontal
+                break;
+            default:
+                // Fallback for unsupported letters
+                glyph_rect(glyph, 0, 0, 8, 16);
+                break;
+        }
+    } else if (c == ':') {
+        // Colon - two dots
+        glyph_rect(glyph, 3, 4, 2, 2);
+        glyph_rect(glyph, 3, 10, 2, 2);
+    }
+}
+
+static bool bake_glyph_atlas() {
+    for (int c = 0; c < 256; c++) {
+        bake_glyph((char)c, glyphAtlas[c]);
+    }
+    return true;
+}
+
+static void raster_text(int x, int y, const char* text, uint32_t color, int clipY0, int clipY1) {
+    // baked once, on first use
+    static const bool baked = bake_glyph_atlas();
+    (void)baked;
+    
+    // Rows are clipped once per string, columns once per glyph
+    int row0 = std::max(0, clipY0 - y);
+    int row1 = std::min(GLYPH_HEIGHT, clipY1 - y);
+    if (row0 >= row1) return;
+    
+    for (int i = 0; text[i]; i++) {
+        int charX = x + i * GLYPH_ADVANCE; // Increase spacing between characters
+        int col0 = std::max(0, -charX);
+        int col1 = std::min(GLYPH_WIDTH, SCREEN_WIDTH - charX);
+        if (col0 >= col1) continue;
+        
+        const uint8_t* glyph = glyphAtlas[(unsigned char)text[i]];
+        if (col0 == 0 && col1 == GLYPH_WIDTH) {
+            blit_mask8(renderTarget[y + row0] + charX, SCREEN_WIDTH, glyph + row0, row1 - row0, color);
+            continue;
+        }
+        
+        // partly off screen horizontally
+        for (int row = row0; row < row1; row++) {
+            uint32_t* dst = renderTarget[y + row];
+            for (int col = col0; col < col1; col++) {
+                if (glyph[row] & (1 << col)) dst[charX + col] = color;
+            }
+        }
+    }
+}
+
+bool raster_bounds(const DrawCommand& cmd, int& x0, int& y0, int& x1, int& y1) {
+    switch (cmd.type) {
+        case DRAW_RECT:
+            x0 = cmd.x; y0 = cmd.y;
+            x1 = cmd.x + cmd.width; y1 = cmd.y + cmd.height;
+            break;
+        case DRAW_CIRCLE:
+            if (cmd.width < 0) return false;
+            x0 = cmd.x - cmd.width; y0 = cmd.y - cmd.width;
+            x1 = cmd.x + cmd.width + 1; y1 = cmd.y + cmd.width + 1;
+            break;
+        case DRAW_TRIANGLE:
+            if (!triangle_bounds(cmd.vx, cmd.vy, x0, y0, x1, y1)) return false;
+            x1++; y1++;
+            break;
+        case DRAW_TEXT:
+            x0 = cmd.x; y0 = cmd.y;
+            x1 = cmd.x + (int)strlen(cmd.text) * GLYPH_ADVANCE; y1 = cmd.y + GLYPH_HEIGHT;
+            break;
+        case DRAW_IMAGE:
+            x0 = cmd.x; y0 = cmd.y;
+            x1 = cmd.x + cmd.width; y1 = cmd.y + cmd.height;
+            break;
+        case DRAW_SPRITE:
+            x0 = cmd.x + cmd.sprite->x0; y0 = cmd.y + cmd.sprite->y0;
+            x1 = cmd.x + cmd.sprite->x1; y1 = cmd.y + cmd.sprite->y1;
+            break;
+        case DRAW_POINTS:
+            if (cmd.points->binStart[POINT_BINS] == 0) return false;
+            x0 = cmd.points->x0; y0 = cmd.points->y0;
+            x1 = cmd.points->x1; y1 = cmd.points->y1;
+            break;
+        default:
+            return false;
+    }
+    
+    x0 = std::max(x0, 0); x1 = std::min(x1, SCREEN_WIDTH);
+    y0 = std::max(y0, 0); y1 = std::min(y1, SCREEN_HEIGHT);
+    return x0 < x1 && y0 < y1;
+}
+
+void raster_command(const DrawCommand& cmd, int clipY0, int clipY1) {
+    switch (cmd.type) {
+        case DRAW_RECT:
+            raster_rect(cmd.x, cmd.y, cmd.width, cmd.height, cmd.color, cmd.blend, clipY0, clipY1);
+            break;
+        case DRAW_CIRCLE:
+            raster_circle(cmd.x, cmd.y, cmd.width, cmd.color, cmd.blend, clipY0, clipY1);
+            break;
+        case DRAW_TRIANGLE:
+            raster_triangle(cmd.vx, cmd.vy, cmd.color, cmd.blend, clipY0, clipY1);
+            break;
+        case DRAW_TEXT:
+            raster_text(cmd.x, cmd.y, cmd.text, cmd.color, clipY0, clipY1);
+            break;
+        case DRAW_IMAGE:
+            raster_image(cmd.x, cmd.y, cmd.width, cmd.height, cmd.pixels, cmd.blend, clipY0, clipY1);
+            break;
+        case DRAW_POINTS:
+            raster_points(*cmd.points, clipY0, clipY1);
+            break;
+        case DRAW_SPRITE:
+            raster_sprite(cmd.x, cmd.y, *cmd.sprite, cmd.color, cmd.blend, clipY0, clipY1);
+            break;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Engine.h"
+#include <stdint.h>
+
+//
+//  Software rasterizers for the backbuffer.
+//
+//  Every primitive is described by a DrawCommand and drawn only within the
+//  rows [clipY0, clipY1), so one frame can be split into horizontal bands
+//  drawn on different threads. A command drawn band by band produces
+//  exactly the same pixels as drawn in one go.
+//
+
+enum DrawType {
+    DRAW_RECT,
+    DRAW_CIRCLE,
+    DRAW_TRIANGLE,
+    DRAW_TEXT,
+    DRAW_IMAGE,
+    DRAW_POINTS,
+    DRAW_SPRITE
+};
+
+// How a command's pixels combine with the frame. The blended modes take
+// premultiplied colors and images (see premultiply() in Simd.h); text is
+// always opaque.
+enum BlendMode {
+    BLEND_OPAQUE, // replace
+    BLEND_OVER,   // source-over
+    BLEND_ADD     // additive, saturating
+};
+
+// One point of a DRAW_POINTS command: steps + 1 pixels starting at (x, y)
+// and moving (stepX, stepY) per pixel, all in 16.16 fixed point, each added
+// to the frame (BLEND_ADD) in color (premultiplied).
+struct PointSprite {
+    int32_t x, y;
+    int32_t stepX, stepY;
+    uint32_t color;
+    int32_t steps; // less than POINT_STREAK_PIXELS
+};
+
+const int POINT_STREAK_PIXELS = 4;
+
+// Points are binned by the row they start on, eight rows to a bin; points
+// above or below the screen go into the first or last bin. Drawing walks
+// the bins top to bottom, so the writes stay within a few rows at a time,
+// and a band only reads the bins its rows can be reached from.
+const int POINT_BIN_SHIFT = 3;
+const int POINT_BINS = SCREEN_HEIGHT >> POINT_BIN_SHIFT;
+
+struct PointList {
+    const PointSprite* sprites;
+    int binStart[POINT_BINS + 1]; // bin b is sprites [binStart[b], binStart[b + 1])
+    int x0, y0, x1, y1;           // screen area the points may write, for the damage tracking
+};
+
+// Run-length encoded shape of a DRAW_SPRITE command, one span per row:
+// row y0 + i fills spans[i].length pixels rightwards from spans[i].x,
+// relative to the command's x and y
+struct SpriteSpan {
+    int8_t x;
+    uint8_t length;
+};
+
+struct SpanSprite {
+    const SpriteSpan* spans; // y1 - y0 of them, top to bottom
+    int x0, y0, x1, y1;      // [x0, x1) x [y0, y1) around the command's x and y, for the damage tracking
+};
+
+struct DrawCommand {
+    DrawType type;
+    uint32_t color;
+    int x, y;          // rect, text and image origin, circle center, sprite position
+    int width, height; // rect and image size; width is the circle radius
+    float vx[3], vy[3]; // triangle vertices
+    const char* text;  // not owned
+    const uint32_t* pixels; // image rows, width apart; not owned, must outlive the frame
+    const PointList* points; // not owned, must outlive the frame
+    const SpanSprite* sprite; // not owned, must outlive the frame
+    BlendMode blend;
+};
+
+// Pixels the rasterizers and the damage clears write: buffer, unless the
+// frame is drawn off screen (see Pipeline.h)
+extern uint32_t (*renderTarget)[SCREEN_WIDTH];
+
+// Glyphs are 8x16 pixels, placed 10 pixels apart
+const int GLYPH_WIDTH = 8;
+const int GLYPH_HEIGHT = 16;
+const int GLYPH_ADVANCE = 10;
+
+// Screen area [x0, x1) x [y0, y1) the command may write; false if none
+bool raster_bounds(const DrawCommand& cmd, int& x0, int& y0, int& x1, int& y1);
+
+// Draws the part of the command inside the rows [clipY0, clipY1)
+void raster_command(const DrawCommand& cmd, int clipY0, int clipY1);
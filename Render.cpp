@@ -0,0 +1,187 @@
+#include "Render.h"
+#include "Damage.h"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const int BAND_COUNT = (SCREEN_HEIGHT + RENDER_BAND_HEIGHT - 1) / RENDER_BAND_HEIGHT;
+
+//
+//  Worker pool
+//
+//  Workers sleep between frames. run() wakes them, hands out bands through
+//  an atomic counter (the calling thread takes bands too) and returns once
+//  every band is done.
+//
+
+class BandWorkers {
+public:
+    ~BandWorkers() { resize(0); }
+
+    void resize(int workerCount) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+        threads.clear();
+
+        stopping = false;
+        for (int i = 0; i < workerCount; i++) {
+            threads.emplace_back(&BandWorkers::worker_loop, this, generation);
+        }
+    }
+
+    void run(int bandCount, void (*drawBand)(int)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = drawBand;
+            jobBands = bandCount;
+            nextBand = 0;
+            busyWorkers = (int)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        take_bands();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return busyWorkers == 0; });
+    }
+
+private:
+    void take_bands() {
+        for (int band = nextBand++; band < jobBands; band = nextBand++) {
+            job(band);
+        }
+    }
+
+    // seen is the generation at creation, so a run() that starts before the
+    // thread does is not missed
+    void worker_loop(uint64_t seen) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+
+            take_bands();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) finished.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+    uint64_t generation = 0;
+    int busyWorkers = 0;
+
+    void (*job)(int) = nullptr;
+    int jobBands = 0;
+    std::atomic<int> nextBand{ 0 };
+};
+
+static BandWorkers workers;
+static int threadCount = 0;
+
+
+//
+//  Command recording
+//
+
+struct RecordedCommand {
+    DrawCommand cmd;
+    size_t textOffset; // into textStorage, for DRAW_TEXT
+};
+
+static std::vector<RecordedCommand> commands;
+static std::vector<char> textStorage;
+static std::vector<int> bins[BAND_COUNT]; // command indices per band, in submission order
+
+void render_set_threads(int threads) {
+    if (threads < 0) threads = 0;
+    if (threads == threadCount) return;
+
+    threadCount = threads;
+    workers.resize(threads > 1 ? threads - 1 : 0);
+
+    // room for a typical frame, so recording does not allocate while the
+    // lists grow to their working size
+    commands.reserve(1024);
+    textStorage.reserve(1024);
+    for (std::vector<int>& bin : bins) bin.reserve(256);
+}
+
+int render_threads() {
+    return threadCount;
+}
+
+void render_begin_frame() {
+    damage_begin_frame();
+
+    if (threadCount == 0) {
+        damage_clear_rows(0, SCREEN_HEIGHT);
+        return;
+    }
+
+    // bands clear their own rows in render_end_frame()
+    commands.clear();
+    textStorage.clear();
+    for (std::vector<int>& bin : bins) bin.clear();
+}
+
+void render_submit(const DrawCommand& cmd) {
+    int x0, y0, x1, y1;
+    if (!raster_bounds(cmd, x0, y0, x1, y1)) return;
+    damage_mark(x0, y0, x1 - x0, y1 - y0);
+
+    if (threadCount == 0) {
+        raster_command(cmd, 0, SCREEN_HEIGHT);
+        return;
+    }
+
+    RecordedCommand recorded = { cmd, 0 };
+    if (cmd.type == DRAW_TEXT) {
+        // the caller's string may not outlive the frame
+        recorded.textOffset = textStorage.size();
+        textStorage.insert(textStorage.end(), cmd.text, cmd.text + strlen(cmd.text) + 1);
+    }
+
+    int index = (int)commands.size();
+    commands.push_back(recorded);
+    for (int band = y0 / RENDER_BAND_HEIGHT; band <= (y1 - 1) / RENDER_BAND_HEIGHT; band++) {
+        bins[band].push_back(index);
+    }
+}
+
+static void draw_band(int band) {
+    int y0 = band * RENDER_BAND_HEIGHT;
+    int y1 = std::min(y0 + RENDER_BAND_HEIGHT, SCREEN_HEIGHT);
+
+    damage_clear_rows(y0, y1);
+    for (int index : bins[band]) {
+        raster_command(commands[index].cmd, y0, y1);
+    }
+}
+
+void render_end_frame() {
+    if (threadCount > 0) {
+        // text pointers are fixed up only now, textStorage has stopped growing
+        for (RecordedCommand& recorded : commands) {
+            if (recorded.cmd.type == DRAW_TEXT) recorded.cmd.text = textStorage.data() + recorded.textOffset;
+        }
+        workers.run(BAND_COUNT, draw_band);
+    }
+
+    damage_end_frame();
+}
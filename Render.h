@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Raster.h"
+
+//
+//  Frame rendering, immediate or banded.
+//
+//  In immediate mode (the default) every command is rasterized as soon as
+//  it is submitted, on the calling thread. In banded mode the frame is
+//  recorded into a command list, each command is binned into the
+//  RENDER_BAND_HEIGHT-row bands it covers, and the bands are cleared and
+//  rasterized by a persistent worker pool. A band is only ever drawn by
+//  one thread and replays its commands in submission order, so the output
+//  is bit-identical to immediate mode.
+//
+//  Both modes keep the damage tracking of Damage.h up to date.
+//
+
+const int RENDER_BAND_HEIGHT = 32;
+
+// 0 selects immediate mode. N >= 1 selects banded mode on the calling
+// thread plus N - 1 workers. Call between frames.
+void render_set_threads(int threads);
+int render_threads();
+
+// Frame boundaries; commands are submitted in between
+void render_begin_frame();
+void render_end_frame();
+
+// Draws (immediate) or records (banded) a command; text is copied, image
+// pixels are not
+void render_submit(const DrawCommand& cmd);
@@ -0,0 +1,161 @@
+#include "Replay.h"
+#include "Game.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char REPLAY_MAGIC[4] = { 'A', 'S', 'R', 'P' };
+static const size_t HEADER_SIZE = 12;
+
+static FILE* recordFile = nullptr;
+static bool playing = false;
+
+// Playback reads straight from the loaded file
+static std::vector<uint8_t> session;
+static size_t readOffset = 0;
+static uint32_t expectedHash = 0;
+
+static float lastDt = 0;
+static ReplayStats stats = { 0, 0, -1 };
+
+static void put_u32(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void reset_session() {
+    lastDt = 0;
+    stats.frames = 0;
+    stats.mismatches = 0;
+    stats.firstMismatch = -1;
+}
+
+bool replay_begin_recording(const char* path, uint32_t seed, std::string* error) {
+    replay_finish();
+
+    recordFile = fopen(path, "wb");
+    if (!recordFile) {
+        if (error) *error = "cannot open for writing";
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, 4);
+    put_u32(header + 4, REPLAY_VERSION);
+    put_u32(header + 8, seed);
+    fwrite(header, 1, HEADER_SIZE, recordFile);
+
+    reset_session();
+    gameWorld.seed = seed;
+    return true;
+}
+
+bool replay_begin_playback(const char* path, std::string* error) {
+    replay_finish();
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+    session.clear();
+    uint8_t chunk[4096];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), file)) > 0; ) {
+        session.insert(session.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    if (session.size() < HEADER_SIZE || memcmp(session.data(), REPLAY_MAGIC, 4) != 0) {
+        if (error) *error = "not a recorded session";
+        return false;
+    }
+    if (get_u32(session.data() + 4) != REPLAY_VERSION) {
+        if (error) *error = "unsupported session version";
+        return false;
+    }
+
+    reset_session();
+    gameWorld.seed = get_u32(session.data() + 8);
+    readOffset = HEADER_SIZE;
+    playing = true;
+    return true;
+}
+
+bool replay_recording() {
+    return recordFile != nullptr;
+}
+
+bool replay_playing() {
+    return playing;
+}
+
+bool replay_next_frame(float& dt, uint8_t& input) {
+    if (!playing || readOffset >= session.size()) return false;
+
+    uint8_t bits = session[readOffset];
+    size_t frameSize = (bits & REPLAY_REPEAT_DT) ? 5 : 9;
+    if (session.size() - readOffset < frameSize) return false; // truncated last frame
+
+    const uint8_t* p = &session[readOffset + 1];
+    if (!(bits & REPLAY_REPEAT_DT)) {
+        uint32_t dtBits = get_u32(p);
+        memcpy(&lastDt, &dtBits, sizeof(lastDt));
+        p += 4;
+    }
+    expectedHash = get_u32(p);
+    readOffset += frameSize;
+
+    dt = lastDt;
+    input = bits & ~REPLAY_REPEAT_DT;
+    return true;
+}
+
+void replay_end_frame(float dt, uint8_t input, uint32_t stateHash) {
+    if (recordFile) {
+        uint8_t frame[9];
+        size_t size = 0;
+        // compare bit patterns, so a NaN or -0 dt still round-trips
+        uint32_t dtBits, lastBits;
+        memcpy(&dtBits, &dt, sizeof(dtBits));
+        memcpy(&lastBits, &lastDt, sizeof(lastBits));
+        if (stats.frames > 0 && dtBits == lastBits) {
+            frame[size++] = input | REPLAY_REPEAT_DT;
+        } else {
+            frame[size++] = input;
+            put_u32(frame + size, dtBits);
+            size += 4;
+        }
+        put_u32(frame + size, stateHash);
+        size += 4;
+        fwrite(frame, 1, size, recordFile);
+
+        lastDt = dt;
+        stats.frames++;
+    } else if (playing) {
+        if (stateHash != expectedHash) {
+            if (stats.firstMismatch < 0) stats.firstMismatch = (int64_t)stats.frames;
+            stats.mismatches++;
+        }
+        stats.frames++;
+    }
+}
+
+ReplayStats replay_stats() {
+    return stats;
+}
+
+void replay_finish() {
+    if (recordFile) {
+        fclose(recordFile);
+        recordFile = nullptr;
+    }
+    playing = false;
+    session.clear();
+    readOffset = 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+//
+//  Session recording and exact replay.
+//
+//  A session is the world seed plus, for every act() call, the dt it was
+//  given, the input bits it sampled and a hash of the game state after it
+//  ran. Replaying feeds the recorded dt and input back into act() in place
+//  of the engine's, so the game goes through the same states, and checks
+//  each frame's state hash against the recording.
+//
+//  File layout, little endian:
+//    header  "ASRP", u32 version, u32 seed
+//    frame   u8 input bits, f32 dt, u32 state hash
+//  The dt is left out when it equals the previous frame's, which is marked
+//  by REPLAY_REPEAT_DT in the input byte.
+//
+
+const uint32_t REPLAY_VERSION = 3;
+const uint8_t REPLAY_REPEAT_DT = 0x80; // above the INPUT_* bits of Game.h
+
+struct ReplayStats {
+    uint64_t frames;        // frames recorded or replayed so far
+    uint64_t mismatches;    // replayed frames whose state hash differed
+    int64_t firstMismatch;  // frame index of the first mismatch, -1 if none
+};
+
+// Starts writing a session to path; sets gameWorld.seed to seed. Call before
+// initialize().
+bool replay_begin_recording(const char* path, uint32_t seed, std::string* error);
+
+// Loads a session and sets gameWorld.seed to its seed. Call before initialize().
+bool replay_begin_playback(const char* path, std::string* error);
+
+bool replay_recording();
+bool replay_playing();
+
+// Playback: dt and input bits of the next frame, false once the session is over
+bool replay_next_frame(float& dt, uint8_t& input);
+
+// Called at the end of act(): records the frame, or checks it against the recording
+void replay_end_frame(float dt, uint8_t input, uint32_t stateHash);
+
+ReplayStats replay_stats();
+
+// Flushes and closes a recording, or ends playback
+void replay_finish();
@@ -0,0 +1,269 @@
+#include "Rollback.h"
+#include "Profile.h"
+#include <string.h>
+
+static const uint8_t PACKET_ROLLBACK_INPUT = 'R';
+static const size_t INPUT_HEADER_SIZE = 6;  // type, first frame, count
+static const size_t INPUT_TRAILER_SIZE = 12; // ack, hash frame, hash
+static const int DELAYED_PACKETS = 256;
+static const float FRAME_DT = 1.0f / ROLLBACK_FRAME_RATE;
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 24));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int ring(int frame) {
+    return frame % ROLLBACK_INPUT_RING;
+}
+
+RollbackSession::RollbackSession()
+    : peer({ 0, 0 }), state(new World()), scratch(new World()), current(0), localThrough(-1), remoteThrough(-1),
+      peerAck(-1), rollbackFrom(-1), hashedThrough(-1), delayedHead(0), delayedCount(0) {
+    counters = RollbackStats();
+}
+
+bool RollbackSession::start(const RollbackConfig& config, uint16_t port, std::string* error) {
+    if (config.localPlayer < 0 || config.localPlayer >= ROLLBACK_PLAYERS) {
+        if (error) *error = "player out of range";
+        return false;
+    }
+    if (config.inputDelay < 0 || config.inputDelay > ROLLBACK_MAX_DELAY ||
+        config.maxPrediction < 1 || config.maxPrediction > ROLLBACK_MAX_PREDICTION) {
+        if (error) *error = "input delay or prediction out of range";
+        return false;
+    }
+    if (!socket.open(port, error)) return false;
+    settings = config;
+
+    state->shipCount = ROLLBACK_PLAYERS;
+    state->seed = config.seed;
+    reset_world(*state);
+    reset_world(*scratch);
+
+    // the states a rollback can go back to, and the one being simulated
+    saved.reserve(config.maxPrediction + 2);
+    current = 0;
+    saved.save(*state, 0);
+
+    // nobody has input for the first inputDelay frames
+    memset(inputs, 0, sizeof(inputs));
+    memset(predicted, 0, sizeof(predicted));
+    localThrough = remoteThrough = peerAck = config.inputDelay - 1;
+    rollbackFrom = -1;
+    hashedThrough = -1;
+    for (int i = 0; i < ROLLBACK_INPUT_RING; i++) {
+        localHashes[i].frame = remoteHashes[i].frame = -1;
+    }
+
+    delayed.resize(DELAYED_PACKETS);
+    delayedHead = delayedCount = 0;
+    lossRandom.seed(config.lossSeed);
+    counters = RollbackStats();
+    counters.firstDesync = -1;
+    packet.reserve(INPUT_HEADER_SIZE + ROLLBACK_INPUT_RING + INPUT_TRAILER_SIZE);
+    return true;
+}
+
+uint8_t RollbackSession::input_of(int player, int frame) const {
+    if (player == settings.localPlayer) return inputs[player][ring(frame)];
+
+    // predicted: the remote keeps doing what it did last
+    if (frame > remoteThrough) frame = remoteThrough;
+    return frame >= 0 ? inputs[player][ring(frame)] : 0;
+}
+
+// Steps world, at the start of frame, to the start of the next one and
+// saves that state
+void RollbackSession::simulate(World& world, int frame) {
+    uint8_t frameInputs[MAX_SHIPS] = {};
+    for (int p = 0; p < ROLLBACK_PLAYERS; p++) frameInputs[p] = input_of(p, frame);
+    predicted[ring(frame)] = frameInputs[1 - settings.localPlayer];
+
+    step_world(world, FRAME_DT, frameInputs);
+    saved.save(world, (frame + 1) % saved.count());
+}
+
+bool RollbackSession::update(uint8_t localInput) {
+    receive();
+    if (rollbackFrom >= 0) rollback();
+    hash_final_states();
+
+    // past the prediction window, or out of room for input the remote has
+    // not acknowledged: wait for the remote
+    if (current - remoteThrough > settings.maxPrediction || localThrough + 1 - peerAck >= ROLLBACK_INPUT_RING) {
+        counters.stalls++;
+        send_input();
+        send_due(false);
+        return false;
+    }
+
+    localThrough++;
+    inputs[settings.localPlayer][ring(localThrough)] = localInput;
+    simulate(*state, current);
+    current++;
+    counters.frames++;
+
+    send_input();
+    send_due(false);
+    return true;
+}
+
+void RollbackSession::pump() {
+    receive();
+    if (rollbackFrom >= 0) rollback();
+    hash_final_states();
+    send_input();
+    send_due(false);
+}
+
+void RollbackSession::receive() {
+    uint8_t data[INPUT_HEADER_SIZE + ROLLBACK_INPUT_RING + INPUT_TRAILER_SIZE];
+    NetAddress from;
+    for (int size; (size = socket.receive(data, sizeof(data), from)) >= 0; ) {
+        if (!(from == peer) || size < (int)(INPUT_HEADER_SIZE + INPUT_TRAILER_SIZE) || data[0] != PACKET_ROLLBACK_INPUT) continue;
+        int first = (int)get_u32(data + 1);
+        int count = data[5];
+        if (size != (int)(INPUT_HEADER_SIZE + count + INPUT_TRAILER_SIZE)) continue;
+        counters.packetsReceived++;
+
+        int remote = 1 - settings.localPlayer;
+        for (int k = 0; k < count; k++) {
+            int frame = first + k;
+            if (frame <= remoteThrough) continue;
+            // a gap, or so far ahead it would overwrite input still needed
+            if (frame != remoteThrough + 1 || frame - current >= ROLLBACK_INPUT_RING - ROLLBACK_MAX_PREDICTION - 2) break;
+
+            uint8_t input = data[INPUT_HEADER_SIZE + k];
+            inputs[remote][ring(frame)] = input;
+            remoteThrough = frame;
+            if (frame < current && predicted[ring(frame)] != input && (rollbackFrom < 0 || frame < rollbackFrom)) {
+                rollbackFrom = frame;
+            }
+        }
+
+        const uint8_t* trailer = data + INPUT_HEADER_SIZE + count;
+        int ack = (int)get_u32(trailer);
+        if (ack > peerAck && ack <= localThrough) peerAck = ack;
+        int hashFrame = (int)get_u32(trailer + 4);
+        if (hashFrame >= 0) record_hash(hashFrame, get_u32(trailer + 8), true);
+    }
+}
+
+// Simulates again from the first frame that used a wrong prediction
+void RollbackSession::rollback() {
+    uint64_t start = profile_now_ns();
+    saved.restore(rollbackFrom % saved.count(), *state);
+    for (int frame = rollbackFrom; frame < current; frame++) {
+        simulate(*state, frame);
+    }
+    uint64_t ns = profile_now_ns() - start;
+
+    int frames = current - rollbackFrom;
+    counters.rollbacks++;
+    counters.resimulatedFrames += (uint64_t)frames;
+    counters.rollbackNs += ns;
+    if (ns > counters.maxRollbackNs) counters.maxRollbackNs = ns;
+    if (frames > counters.maxRollbackFrames) counters.maxRollbackFrames = frames;
+    rollbackFrom = -1;
+}
+
+void RollbackSession::hash_final_states() {
+    for (int frame = hashedThrough + 1; frame <= final_frame(); frame++) {
+        saved.restore(frame % saved.count(), *scratch);
+        record_hash(frame, hash_world(*scratch), false);
+        hashedThrough = frame;
+    }
+}
+
+// Each frame's pair of hashes is compared once, when the second one arrives
+void RollbackSession::record_hash(int frame, uint32_t value, bool remote) {
+    Hash* hashes = remote ? remoteHashes : localHashes;
+    const Hash* other = remote ? localHashes : remoteHashes;
+    Hash& entry = hashes[ring(frame)];
+    if (entry.frame == frame) return; // resent
+    entry.frame = frame;
+    entry.value = value;
+
+    if (other[ring(frame)].frame != frame) return;
+    counters.checksumsCompared++;
+    if (other[ring(frame)].value != value) {
+        counters.desyncs++;
+        if (counters.firstDesync < 0 || frame < counters.firstDesync) counters.firstDesync = frame;
+    }
+}
+
+bool RollbackSession::final_hash(int frame, uint32_t& hash) const {
+    const Hash& entry = localHashes[ring(frame)];
+    if (entry.frame != frame) return false;
+    hash = entry.value;
+    return true;
+}
+
+void RollbackSession::send_input() {
+    int first = peerAck + 1;
+    int count = localThrough - peerAck;
+
+    packet.clear();
+    packet.push_back(PACKET_ROLLBACK_INPUT);
+    put_u32(packet, (uint32_t)first);
+    packet.push_back((uint8_t)count);
+    for (int frame = first; frame <= localThrough; frame++) {
+        packet.push_back(inputs[settings.localPlayer][ring(frame)]);
+    }
+    put_u32(packet, (uint32_t)remoteThrough);
+    put_u32(packet, (uint32_t)hashedThrough);
+    put_u32(packet, hashedThrough >= 0 ? localHashes[ring(hashedThrough)].value : 0);
+
+    counters.packetsSent++;
+    counters.bytesSent += packet.size();
+    if (settings.loss > 0 && (lossRandom.next() >> 8) * (1.0f / 16777216.0f) < settings.loss) {
+        counters.packetsDropped++;
+        return;
+    }
+    if (settings.latencyMs <= 0) {
+        socket.send(peer, packet.data(), packet.size());
+        return;
+    }
+
+    // held back for the latency; a full ring loses the packet
+    if (delayedCount == DELAYED_PACKETS) {
+        counters.packetsDropped++;
+        return;
+    }
+    Delayed& held = delayed[(delayedHead + delayedCount) % DELAYED_PACKETS];
+    held.due = profile_now_ns() + (uint64_t)settings.latencyMs * 1000000;
+    held.size = (int)packet.size();
+    memcpy(held.bytes, packet.data(), packet.size());
+    delayedCount++;
+}
+
+void RollbackSession::send_due(bool all) {
+    uint64_t now = profile_now_ns();
+    while (delayedCount > 0 && (all || delayed[delayedHead].due <= now)) {
+        const Delayed& held = delayed[delayedHead];
+        socket.send(peer, held.bytes, held.size);
+        delayedHead = (delayedHead + 1) % DELAYED_PACKETS;
+        delayedCount--;
+    }
+}
+
+uint64_t RollbackSession::time_full_rollback() {
+    int from = current - settings.maxPrediction;
+    if (from < 0) from = 0;
+
+    // on the scratch world, so the session's state is left alone; the
+    // resimulated states overwrite the saved ones with the same values
+    uint64_t start = profile_now_ns();
+    saved.restore(from % saved.count(), *scratch);
+    for (int frame = from; frame < current; frame++) {
+        simulate(*scratch, frame);
+    }
+    return profile_now_ns() - start;
+}
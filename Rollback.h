@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Game.h"
+#include "Net.h"
+#include "WorldState.h"
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+//  Peer-to-peer rollback sessions for two players over UDP.
+//
+//  Both peers run the same World (two ships, the same seed) one frame of
+//  ROLLBACK_FRAME_RATE at a time, and exchange only their input bits. A
+//  player's input is applied inputDelay frames after it was sampled, which
+//  gives it that long to reach the other peer. When the remote input of a
+//  frame has not arrived yet it is predicted to be the last one that did,
+//  and the session keeps going up to maxPrediction frames past the newest
+//  confirmed remote input before it stalls.
+//
+//  The state at the start of every frame is saved into a StateArena ring
+//  (see WorldState.h). When a remote input arrives that differs from the
+//  one predicted for its frame, the session restores the state of that
+//  frame and simulates forward to the present again with the real input.
+//
+//  Once all input before a frame is confirmed its state is final on both
+//  peers; each peer hashes final states and sends the newest hash along,
+//  and the other counts any frame whose hashes differ as a desync.
+//
+//  Every packet carries all local input the remote has not acknowledged, so
+//  a lost packet costs nothing but a later correction. For testing, sent
+//  packets can be held back by a simulated latency and dropped at random.
+//
+//  Packet, little endian:
+//    input  'R', u32 first frame, u8 count, count input bits,
+//           u32 ack (newest remote frame received), u32 hash frame, u32 hash
+//  The first inputDelay frames of both players are neutral. Both peers must
+//  use the same seed and input delay.
+//
+
+const int ROLLBACK_FRAME_RATE = 60;
+const int ROLLBACK_PLAYERS = 2;
+const int ROLLBACK_INPUT_RING = 128;      // frames of input kept per player
+const int ROLLBACK_MAX_PREDICTION = 30;
+const int ROLLBACK_MAX_DELAY = 30;
+
+struct RollbackConfig {
+    int localPlayer;   // 0 or 1; the other peer plays the other
+    uint32_t seed;
+    int inputDelay;    // frames
+    int maxPrediction; // frames past the newest remote input, at most ROLLBACK_MAX_PREDICTION
+    int latencyMs;     // simulated one-way latency of sent packets
+    float loss;        // share of sent packets dropped
+    uint32_t lossSeed;
+
+    RollbackConfig() : localPlayer(0), seed(1), inputDelay(2), maxPrediction(8), latencyMs(0), loss(0), lossSeed(1) {}
+};
+
+struct RollbackStats {
+    uint64_t frames;            // simulated forward
+    uint64_t stalls;            // updates that waited for remote input
+    uint64_t rollbacks;
+    uint64_t resimulatedFrames;
+    int maxRollbackFrames;
+    uint64_t maxRollbackNs;     // slowest rollback: restore and resimulation
+    uint64_t rollbackNs;        // all rollbacks together
+    uint64_t checksumsCompared;
+    uint64_t desyncs;
+    int firstDesync;            // frame, or -1
+    uint64_t packetsSent;
+    uint64_t packetsDropped;    // by the simulated loss
+    uint64_t packetsReceived;
+    uint64_t bytesSent;
+};
+
+class RollbackSession {
+public:
+    RollbackSession();
+
+    // Opens the socket (port 0 picks a free one) and starts frame 0
+    bool start(const RollbackConfig& config, uint16_t port, std::string* error);
+    void connect(const NetAddress& remote) { peer = remote; }
+    uint16_t port() const { return socket.local_port(); }
+
+    // One frame: reads the remote's packets, rolls back if a prediction was
+    // wrong, then simulates the next frame with this local input. Returns
+    // false if it stalled on missing remote input instead.
+    bool update(uint8_t localInput);
+
+    // Reads packets and sends the held back ones and the local input,
+    // without simulating; keeps the remote supplied after the last frame
+    void pump();
+
+    // Frames simulated; the world is at the start of this frame
+    int frame() const { return current; }
+    // Newest frame whose state is final: all input before it is known
+    int final_frame() const { return remoteThrough + 1 < current ? remoteThrough + 1 : current; }
+    // Newest frame of local input the remote acknowledged
+    int acknowledged_frame() const { return peerAck; }
+    // Hash of a final state, if it is still held
+    bool final_hash(int frame, uint32_t& hash) const;
+
+    const World& world() const { return *state; }
+    const RollbackStats& stats() const { return counters; }
+
+    // Times a rollback over the whole prediction window from the current
+    // state, the worst case a late packet can cause
+    uint64_t time_full_rollback();
+
+private:
+    struct Hash {
+        int frame;
+        uint32_t value;
+    };
+
+    struct Delayed {
+        uint64_t due;
+        int size;
+        uint8_t bytes[32 + ROLLBACK_INPUT_RING];
+    };
+
+    uint8_t input_of(int player, int frame) const;
+    void simulate(World& world, int frame);
+    void receive();
+    void rollback();
+    void hash_final_states();
+    void record_hash(int frame, uint32_t value, bool remote);
+    void send_input();
+    void send_due(bool all);
+
+    RollbackConfig settings;
+    UdpSocket socket;
+    NetAddress peer;
+    std::unique_ptr<World> state, scratch;
+    StateArena saved;              // state at the start of each of the last frames
+    uint8_t inputs[ROLLBACK_PLAYERS][ROLLBACK_INPUT_RING];
+    uint8_t predicted[ROLLBACK_INPUT_RING]; // remote input each simulated frame used
+    int current;
+    int localThrough;              // newest frame with local input
+    int remoteThrough;             // newest frame with remote input
+    int peerAck;                   // newest frame of local input the remote has
+    int rollbackFrom;              // earliest mispredicted frame, or -1
+    int hashedThrough;             // newest final state hashed, or -1
+    Hash localHashes[ROLLBACK_INPUT_RING], remoteHashes[ROLLBACK_INPUT_RING];
+    std::vector<Delayed> delayed;  // ring of held back packets
+    int delayedHead, delayedCount;
+    GameRandom lossRandom;
+    RollbackStats counters;
+    std::vector<uint8_t> packet;
+};
@@ -0,0 +1,227 @@
+//
+//  Two-player rollback over UDP, one peer per process or both in one:
+//    asteroids_rollback --peer 0|1 --port P --remote HOST:PORT [options]
+//    asteroids_rollback --pair [options]
+//
+//  Each peer plays its ship with a bot for a number of frames at 60 Hz,
+//  then waits until both sides hold every frame's input. It prints its
+//  rollback counts and the worst resimulation time next to the frame
+//  budget, and fails on any desync; the pair also fails when the two final
+//  hashes differ.
+//
+
+#include "Game.h"
+#include "Rollback.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static const Clock::duration FRAME_PERIOD =
+    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / ROLLBACK_FRAME_RATE));
+
+// Turns the ship towards the nearest asteroid and fires when roughly facing
+// it; restarts finished games
+static uint8_t bot(const World& world, int ship) {
+    if (world.gameOver || world.gameWon) return INPUT_RETURN;
+    if (ship < 0 || ship >= world.shipCount || !world.ships[ship].alive || world.asteroids.count() == 0) return 0;
+
+    const Ship& self = world.ships[ship];
+    int nearest = 0;
+    float nearestDistance = 1e30f;
+    for (int i = 0; i < world.asteroids.count(); i++) {
+        float dx = world.asteroids.x[i] - self.position.x;
+        float dy = world.asteroids.y[i] - self.position.y;
+        float distance = dx * dx + dy * dy;
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = i;
+        }
+    }
+
+    float target = atan2f(world.asteroids.y[nearest] - self.position.y, world.asteroids.x[nearest] - self.position.x);
+    float turn = remainderf(target - self.angle, 6.2831853f);
+
+    uint8_t input = 0;
+    if (turn < -0.05f) input |= INPUT_LEFT;
+    if (turn > 0.05f) input |= INPUT_RIGHT;
+    if (fabsf(turn) < 0.2f) input |= INPUT_SPACE;
+    if (nearestDistance > 300.0f * 300.0f) input |= INPUT_UP;
+    return input;
+}
+
+struct PeerResult {
+    bool finished;
+    uint64_t fullRollbackNs;
+    uint32_t finalHash;
+    bool hashed;
+};
+
+// Plays frames frames, then keeps the remote supplied until both sides have
+// all input and a little longer so the last hashes cross; gives up after
+// timeout
+static void run_peer(RollbackSession& session, int player, int frames, Clock::duration timeout, PeerResult& result) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point next = start;
+    while (session.frame() < frames && Clock::now() - start < timeout) {
+        session.update(bot(session.world(), player));
+        next += FRAME_PERIOD;
+        std::this_thread::sleep_until(next);
+    }
+
+    Clock::time_point settled = Clock::time_point::max();
+    while (Clock::now() - start < timeout) {
+        session.pump();
+        bool done = session.frame() >= frames && session.final_frame() >= frames &&
+                    session.acknowledged_frame() >= frames - 1;
+        if (done && settled == Clock::time_point::max()) settled = Clock::now();
+        if (done && Clock::now() - settled > std::chrono::milliseconds(500)) break;
+        next += FRAME_PERIOD;
+        std::this_thread::sleep_until(next);
+    }
+
+    result.finished = session.frame() >= frames && session.final_frame() >= frames;
+    result.fullRollbackNs = session.time_full_rollback();
+    result.hashed = session.final_hash(frames, result.finalHash);
+}
+
+static void print_peer(int player, const RollbackSession& session, const PeerResult& result, int frames) {
+    const RollbackStats& stats = session.stats();
+    double perFrame = stats.frames ? (double)stats.frames : 1.0;
+    double meanUs = stats.rollbacks ? stats.rollbackNs / 1000.0 / stats.rollbacks : 0.0;
+
+    printf("peer %d frames=%llu stalls=%llu rollbacks=%llu resimulated_frames=%llu rollback_frames_max=%d "
+           "rollback_us_max=%.1f rollback_us_mean=%.1f full_rollback_us=%.1f frame_budget_us=%.0f "
+           "checksums=%llu desyncs=%llu first_desync=%d packets_sent=%llu packets_dropped=%llu "
+           "packets_received=%llu bytes_per_frame=%.1f final_frame=%d final_hash=%08x%s\n",
+           player, (unsigned long long)stats.frames, (unsigned long long)stats.stalls,
+           (unsigned long long)stats.rollbacks, (unsigned long long)stats.resimulatedFrames,
+           stats.maxRollbackFrames, stats.maxRollbackNs / 1000.0, meanUs, result.fullRollbackNs / 1000.0,
+           1e6 / ROLLBACK_FRAME_RATE, (unsigned long long)stats.checksumsCompared,
+           (unsigned long long)stats.desyncs, stats.firstDesync, (unsigned long long)stats.packetsSent,
+           (unsigned long long)stats.packetsDropped, (unsigned long long)stats.packetsReceived,
+           stats.bytesSent / perFrame, frames, result.hashed ? result.finalHash : 0,
+           result.finished ? "" : " unfinished");
+    fflush(stdout);
+}
+
+static void print_usage() {
+    fprintf(stderr,
+        "usage: asteroids_rollback --peer 0|1 --port P --remote HOST:PORT | --pair [options]\n"
+        "  --frames N        frames to play (default 1200)\n"
+        "  --delay N         input delay in frames (default 2)\n"
+        "  --prediction N    frames to predict before stalling (default 8, at most 30)\n"
+        "  --latency MS      hold sent packets back this long (default 0)\n"
+        "  --loss FRACTION   drop this share of sent packets (default 0)\n"
+        "  --seed N          world seed, the same on both peers (default 1)\n");
+}
+
+int main(int argc, char** argv) {
+    enum { NONE, PEER, PAIR } mode = NONE;
+    RollbackConfig config;
+    uint16_t port = 0;
+    int frames = 1200;
+    NetAddress remote = { 0, 0 };
+    bool hasRemote = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--peer") == 0 && value) {
+            config.localPlayer = atoi(value);
+            mode = PEER;
+            i++;
+        } else if (strcmp(arg, "--pair") == 0) {
+            mode = PAIR;
+        } else if (strcmp(arg, "--port") == 0 && value) {
+            port = (uint16_t)atoi(value);
+            i++;
+        } else if (strcmp(arg, "--remote") == 0 && value) {
+            if (!net_parse_address(value, remote)) {
+                fprintf(stderr, "%s: not an address\n", value);
+                return 1;
+            }
+            hasRemote = true;
+            i++;
+        } else if (strcmp(arg, "--frames") == 0 && value) {
+            frames = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--delay") == 0 && value) {
+            config.inputDelay = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--prediction") == 0 && value) {
+            config.maxPrediction = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--latency") == 0 && value) {
+            config.latencyMs = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--loss") == 0 && value) {
+            config.loss = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            config.seed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (mode == NONE || (mode == PEER && !hasRemote) || frames < 1) {
+        print_usage();
+        return 1;
+    }
+
+    // room for the other process to start, and for the slowdown of stalls
+    Clock::duration timeout = FRAME_PERIOD * frames * 2 + std::chrono::seconds(10);
+    std::string error;
+
+    if (mode == PEER) {
+        RollbackSession session;
+        config.lossSeed = config.seed * 2 + (uint32_t)config.localPlayer;
+        if (!session.start(config, port, &error)) {
+            fprintf(stderr, "peer: %s\n", error.c_str());
+            return 1;
+        }
+        session.connect(remote);
+
+        PeerResult result;
+        run_peer(session, config.localPlayer, frames, timeout, result);
+        print_peer(config.localPlayer, session, result, frames);
+        return result.finished && session.stats().desyncs == 0 ? 0 : 1;
+    }
+
+    // Pair: both peers on free ports, each on its own thread
+    RollbackSession sessions[ROLLBACK_PLAYERS];
+    for (int p = 0; p < ROLLBACK_PLAYERS; p++) {
+        RollbackConfig peerConfig = config;
+        peerConfig.localPlayer = p;
+        peerConfig.lossSeed = config.seed * 2 + (uint32_t)p;
+        if (!sessions[p].start(peerConfig, 0, &error)) {
+            fprintf(stderr, "peer %d: %s\n", p, error.c_str());
+            return 1;
+        }
+    }
+    for (int p = 0; p < ROLLBACK_PLAYERS; p++) {
+        NetAddress address;
+        net_parse_address(std::to_string(sessions[1 - p].port()).c_str(), address);
+        sessions[p].connect(address);
+    }
+
+    PeerResult results[ROLLBACK_PLAYERS];
+    std::thread other(run_peer, std::ref(sessions[1]), 1, frames, timeout, std::ref(results[1]));
+    run_peer(sessions[0], 0, frames, timeout, results[0]);
+    other.join();
+
+    bool ok = results[0].hashed && results[1].hashed && results[0].finalHash == results[1].finalHash;
+    for (int p = 0; p < ROLLBACK_PLAYERS; p++) {
+        print_peer(p, sessions[p], results[p], frames);
+        ok = ok && results[p].finished && sessions[p].stats().desyncs == 0;
+    }
+    return ok ? 0 : 1;
+}
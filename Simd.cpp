@@ -0,0 +1,668 @@
+#include "Simd.h"
+#include "Engine.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#  define SIMD_X86 1
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#    define TARGET_AVX2
+#  else
+#    include <cpuid.h>
+#    define TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#else
+#  define SIMD_X86 0
+#endif
+
+typedef void (*IntegrateWrapFn)(float*, float*, const float*, const float*, int, float);
+typedef void (*DecrementFn)(float*, int, float);
+typedef void (*UpdateParticlesFn)(float*, float*, float*, float*, float*, int, float, float);
+typedef void (*FillSpanFn)(uint32_t*, int, uint32_t);
+typedef void (*BlitMask8Fn)(uint32_t*, int, const uint8_t*, int, uint32_t);
+typedef void (*BlendSpanFn)(uint32_t*, int, uint32_t);
+typedef void (*BlendFn)(uint32_t*, const uint32_t*, int);
+typedef void (*BinRowsFn)(const float*, const float*, const float*, uint16_t*, int, float, int, uint16_t);
+
+static SimdLevel currentLevel = SIMD_SCALAR;
+static IntegrateWrapFn integrateWrapFn = nullptr;
+static DecrementFn decrementFn = nullptr;
+static UpdateParticlesFn updateParticlesFn = nullptr;
+static FillSpanFn fillSpanFn = nullptr;
+static BlitMask8Fn blitMask8Fn = nullptr;
+static BlendSpanFn blendSpanOverFn = nullptr;
+static BlendSpanFn blendSpanAddFn = nullptr;
+static BlendFn blendOverFn = nullptr;
+static BlendFn blendAddFn = nullptr;
+static BinRowsFn binRowsFn = nullptr;
+
+
+//
+//  Scalar
+//
+
+static inline float wrap_coordinate(float v, float limit) {
+    // same order as wrap_position(): below zero jumps to the far edge,
+    // past the far edge jumps to zero
+    v = v < 0 ? limit : v;
+    return v > limit ? 0.0f : v;
+}
+
+static void integrate_wrap_scalar(float* x, float* y, const float* vx, const float* vy, int count, float dt) {
+    for (int i = 0; i < count; i++) {
+        x[i] = wrap_coordinate(x[i] + vx[i] * dt, (float)SCREEN_WIDTH);
+        y[i] = wrap_coordinate(y[i] + vy[i] * dt, (float)SCREEN_HEIGHT);
+    }
+}
+
+static void decrement_scalar(float* values, int count, float dt) {
+    for (int i = 0; i < count; i++) {
+        values[i] -= dt;
+    }
+}
+
+static void update_particles_scalar(float* x, float* y, float* vx, float* vy, float* life, int count, float dt, float drag) {
+    for (int i = 0; i < count; i++) {
+        vx[i] *= drag;
+        vy[i] *= drag;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+}
+
+static void fill_span_scalar(uint32_t* dst, int count, uint32_t value) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = value;
+    }
+}
+
+static void blit_mask8_scalar(uint32_t* dst, int pitch, const uint8_t* rows, int rowCount, uint32_t color) {
+    for (int r = 0; r < rowCount; r++, dst += pitch) {
+        for (int x = 0; x < 8; x++) {
+            if (rows[r] & (1 << x)) dst[x] = color;
+        }
+    }
+}
+
+// x * a / 255 rounded to nearest, exact for x and a in [0, 255]
+static inline uint32_t mul_div255(uint32_t x, uint32_t a) {
+    uint32_t t = x * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline uint32_t blend_pixel_over(uint32_t dst, uint32_t src) {
+    uint32_t inverse = 255 - (src >> 24);
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t c = ((src >> shift) & 255) + mul_div255((dst >> shift) & 255, inverse);
+        out |= (c > 255 ? 255 : c) << shift;
+    }
+    return out;
+}
+
+static inline uint32_t blend_pixel_add(uint32_t dst, uint32_t src) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t c = ((src >> shift) & 255) + ((dst >> shift) & 255);
+        out |= (c > 255 ? 255 : c) << shift;
+    }
+    return out;
+}
+
+static void blend_span_over_scalar(uint32_t* dst, int count, uint32_t color) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend_pixel_over(dst[i], color);
+    }
+}
+
+static void blend_span_add_scalar(uint32_t* dst, int count, uint32_t color) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend_pixel_add(dst[i], color);
+    }
+}
+
+static void blend_over_scalar(uint32_t* dst, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend_pixel_over(dst[i], src[i]);
+    }
+}
+
+static void blend_add_scalar(uint32_t* dst, const uint32_t* src, int count) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = blend_pixel_add(dst[i], src[i]);
+    }
+}
+
+static void bin_rows_scalar(const float* x, const float* y, const float* life, uint16_t* bins, int count,
+                            float margin, int shift, uint16_t hidden) {
+    const float lastRow = (float)(SCREEN_HEIGHT - 1);
+    for (int i = 0; i < count; i++) {
+        // & rather than && keeps the loop free of branches
+        bool visible = (life[i] > 0.0f) & (x[i] >= -margin) & (x[i] < SCREEN_WIDTH + margin) &
+                       (y[i] >= -margin) & (y[i] < SCREEN_HEIGHT + margin);
+        float row = y[i] < 0.0f ? 0.0f : (y[i] > lastRow ? lastRow : y[i]);
+        bins[i] = visible ? (uint16_t)((int)row >> shift) : hidden;
+    }
+}
+
+
+#if SIMD_X86
+
+//
+//  SSE2, 4 objects per iteration
+//
+
+static inline __m128 wrap_sse2(__m128 v, __m128 limit) {
+    __m128 below = _mm_cmplt_ps(v, _mm_setzero_ps());
+    v = _mm_or_ps(_mm_and_ps(below, limit), _mm_andnot_ps(below, v));
+    __m128 above = _mm_cmpgt_ps(v, limit);
+    return _mm_andnot_ps(above, v);
+}
+
+static void integrate_wrap_sse2(float* x, float* y, const float* vx, const float* vy, int count, float dt) {
+    __m128 step = _mm_set1_ps(dt);
+    __m128 width = _mm_set1_ps((float)SCREEN_WIDTH);
+    __m128 height = _mm_set1_ps((float)SCREEN_HEIGHT);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), step));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), step));
+        _mm_storeu_ps(x + i, wrap_sse2(px, width));
+        _mm_storeu_ps(y + i, wrap_sse2(py, height));
+    }
+    integrate_wrap_scalar(x + i, y + i, vx + i, vy + i, count - i, dt);
+}
+
+static void decrement_sse2(float* values, int count, float dt) {
+    __m128 step = _mm_set1_ps(dt);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(values + i, _mm_sub_ps(_mm_loadu_ps(values + i), step));
+    }
+    decrement_scalar(values + i, count - i, dt);
+}
+
+static void update_particles_sse2(float* x, float* y, float* vx, float* vy, float* life, int count, float dt, float drag) {
+    __m128 step = _mm_set1_ps(dt);
+    __m128 keep = _mm_set1_ps(drag);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 velocityX = _mm_mul_ps(_mm_loadu_ps(vx + i), keep);
+        __m128 velocityY = _mm_mul_ps(_mm_loadu_ps(vy + i), keep);
+        _mm_storeu_ps(vx + i, velocityX);
+        _mm_storeu_ps(vy + i, velocityY);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(velocityX, step)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(velocityY, step)));
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), step));
+    }
+    update_particles_scalar(x + i, y + i, vx + i, vy + i, life + i, count - i, dt, drag);
+}
+
+static void fill_span_sse2(uint32_t* dst, int count, uint32_t value) {
+    __m128i v = _mm_set1_epi32((int)value);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), v);
+    }
+    fill_span_scalar(dst + i, count - i, value);
+}
+
+static void blit_mask8_sse2(uint32_t* dst, int pitch, const uint8_t* rows, int rowCount, uint32_t color) {
+    __m128i value = _mm_set1_epi32((int)color);
+    __m128i lowBits = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i highBits = _mm_setr_epi32(16, 32, 64, 128);
+
+    for (int r = 0; r < rowCount; r++, dst += pitch) {
+        // expand the row byte into one all-ones or all-zeros lane per pixel
+        __m128i bits = _mm_set1_epi32(rows[r]);
+        __m128i lowLit = _mm_cmpeq_epi32(_mm_and_si128(bits, lowBits), lowBits);
+        __m128i highLit = _mm_cmpeq_epi32(_mm_and_si128(bits, highBits), highBits);
+
+        __m128i low = _mm_loadu_si128((__m128i*)dst);
+        __m128i high = _mm_loadu_si128((__m128i*)(dst + 4));
+        low = _mm_or_si128(_mm_and_si128(lowLit, value), _mm_andnot_si128(lowLit, low));
+        high = _mm_or_si128(_mm_and_si128(highLit, value), _mm_andnot_si128(highLit, high));
+        _mm_storeu_si128((__m128i*)dst, low);
+        _mm_storeu_si128((__m128i*)(dst + 4), high);
+    }
+}
+
+// Channels are widened to 16-bit lanes, where x * a + 128 still fits
+
+static inline __m128i mul_div255_sse2(__m128i x, __m128i a) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// 255 - alpha of each pixel, in all four lanes of the pixel
+static inline __m128i inverse_alpha_sse2(__m128i wide) {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+}
+
+static void blend_span_over_sse2(uint32_t* dst, int count, uint32_t color) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i src = _mm_set1_epi32((int)color);
+    __m128i inverse = _mm_set1_epi16((short)(255 - (color >> 24)));
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i low = mul_div255_sse2(_mm_unpacklo_epi8(pixels, zero), inverse);
+        __m128i high = mul_div255_sse2(_mm_unpackhi_epi8(pixels, zero), inverse);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(_mm_packus_epi16(low, high), src));
+    }
+    blend_span_over_scalar(dst + i, count - i, color);
+}
+
+static void blend_span_add_sse2(uint32_t* dst, int count, uint32_t color) {
+    __m128i src = _mm_set1_epi32((int)color);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_loadu_si128((__m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(pixels, src));
+    }
+    blend_span_add_scalar(dst + i, count - i, color);
+}
+
+static void blend_over_sse2(uint32_t* dst, const uint32_t* src, int count) {
+    __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i source = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i pixels = _mm_loadu_si128((__m128i*)(dst + i));
+        __m128i low = mul_div255_sse2(_mm_unpacklo_epi8(pixels, zero), inverse_alpha_sse2(_mm_unpacklo_epi8(source, zero)));
+        __m128i high = mul_div255_sse2(_mm_unpackhi_epi8(pixels, zero), inverse_alpha_sse2(_mm_unpackhi_epi8(source, zero)));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(_mm_packus_epi16(low, high), source));
+    }
+    blend_over_scalar(dst + i, src + i, count - i);
+}
+
+static void blend_add_sse2(uint32_t* dst, const uint32_t* src, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i source = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i pixels = _mm_loadu_si128((__m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(pixels, source));
+    }
+    blend_add_scalar(dst + i, src + i, count - i);
+}
+
+// Bins of 4 particles in 32-bit lanes
+static inline __m128i bin_rows4_sse2(const float* x, const float* y, const float* life, float margin,
+                                     __m128i shift, __m128i hidden) {
+    __m128 px = _mm_loadu_ps(x), py = _mm_loadu_ps(y);
+    __m128 visible = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(life), _mm_setzero_ps()),
+                                _mm_and_ps(_mm_cmpge_ps(px, _mm_set1_ps(-margin)),
+                                           _mm_cmplt_ps(px, _mm_set1_ps(SCREEN_WIDTH + margin))));
+    visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmpge_ps(py, _mm_set1_ps(-margin)),
+                                             _mm_cmplt_ps(py, _mm_set1_ps(SCREEN_HEIGHT + margin))));
+    __m128 row = _mm_min_ps(_mm_max_ps(py, _mm_setzero_ps()), _mm_set1_ps((float)(SCREEN_HEIGHT - 1)));
+    __m128i bin = _mm_srl_epi32(_mm_cvttps_epi32(row), shift);
+    __m128i mask = _mm_castps_si128(visible);
+    return _mm_or_si128(_mm_and_si128(mask, bin), _mm_andnot_si128(mask, hidden));
+}
+
+static void bin_rows_sse2(const float* x, const float* y, const float* life, uint16_t* bins, int count,
+                          float margin, int shift, uint16_t hidden) {
+    __m128i bitShift = _mm_cvtsi32_si128(shift);
+    __m128i none = _mm_set1_epi32(hidden);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i low = bin_rows4_sse2(x + i, y + i, life + i, margin, bitShift, none);
+        __m128i high = bin_rows4_sse2(x + i + 4, y + i + 4, life + i + 4, margin, bitShift, none);
+        _mm_storeu_si128((__m128i*)(bins + i), _mm_packs_epi32(low, high));
+    }
+    bin_rows_scalar(x + i, y + i, life + i, bins + i, count - i, margin, shift, hidden);
+}
+
+
+//
+//  AVX2, 8 objects per iteration
+//
+
+TARGET_AVX2 static inline __m256 wrap_avx2(__m256 v, __m256 limit) {
+    __m256 below = _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ);
+    v = _mm256_blendv_ps(v, limit, below);
+    __m256 above = _mm256_cmp_ps(v, limit, _CMP_GT_OQ);
+    return _mm256_andnot_ps(above, v);
+}
+
+TARGET_AVX2 static void integrate_wrap_avx2(float* x, float* y, const float* vx, const float* vy, int count, float dt) {
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 width = _mm256_set1_ps((float)SCREEN_WIDTH);
+    __m256 height = _mm256_set1_ps((float)SCREEN_HEIGHT);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), step));
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), step));
+        _mm256_storeu_ps(x + i, wrap_avx2(px, width));
+        _mm256_storeu_ps(y + i, wrap_avx2(py, height));
+    }
+    integrate_wrap_sse2(x + i, y + i, vx + i, vy + i, count - i, dt);
+}
+
+TARGET_AVX2 static void decrement_avx2(float* values, int count, float dt) {
+    __m256 step = _mm256_set1_ps(dt);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(values + i, _mm256_sub_ps(_mm256_loadu_ps(values + i), step));
+    }
+    decrement_sse2(values + i, count - i, dt);
+}
+
+TARGET_AVX2 static void update_particles_avx2(float* x, float* y, float* vx, float* vy, float* life, int count, float dt, float drag) {
+    __m256 step = _mm256_set1_ps(dt);
+    __m256 keep = _mm256_set1_ps(drag);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 velocityX = _mm256_mul_ps(_mm256_loadu_ps(vx + i), keep);
+        __m256 velocityY = _mm256_mul_ps(_mm256_loadu_ps(vy + i), keep);
+        _mm256_storeu_ps(vx + i, velocityX);
+        _mm256_storeu_ps(vy + i, velocityY);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(velocityX, step)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(velocityY, step)));
+        _mm256_storeu_ps(life + i, _mm256_sub_ps(_mm256_loadu_ps(life + i), step));
+    }
+    update_particles_sse2(x + i, y + i, vx + i, vy + i, life + i, count - i, dt, drag);
+}
+
+TARGET_AVX2 static void fill_span_avx2(uint32_t* dst, int count, uint32_t value) {
+    __m256i v = _mm256_set1_epi32((int)value);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i), v);
+    }
+    fill_span_sse2(dst + i, count - i, value);
+}
+
+TARGET_AVX2 static void blit_mask8_avx2(uint32_t* dst, int pitch, const uint8_t* rows, int rowCount, uint32_t color) {
+    __m256i value = _mm256_set1_epi32((int)color);
+    __m256i pixelBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    for (int r = 0; r < rowCount; r++, dst += pitch) {
+        __m256i bits = _mm256_set1_epi32(rows[r]);
+        __m256i lit = _mm256_cmpeq_epi32(_mm256_and_si256(bits, pixelBits), pixelBits);
+        __m256i pixels = _mm256_loadu_si256((__m256i*)dst);
+        _mm256_storeu_si256((__m256i*)dst, _mm256_blendv_epi8(pixels, value, lit));
+    }
+}
+
+// Unpacking and packing work within 128-bit halves, so they undo each other
+// the same way as in SSE2
+
+TARGET_AVX2 static inline __m256i mul_div255_avx2(__m256i x, __m256i a) {
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 static inline __m256i inverse_alpha_avx2(__m256i wide) {
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+}
+
+TARGET_AVX2 static void blend_span_over_avx2(uint32_t* dst, int count, uint32_t color) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i src = _mm256_set1_epi32((int)color);
+    __m256i inverse = _mm256_set1_epi16((short)(255 - (color >> 24)));
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_loadu_si256((__m256i*)(dst + i));
+        __m256i low = mul_div255_avx2(_mm256_unpacklo_epi8(pixels, zero), inverse);
+        __m256i high = mul_div255_avx2(_mm256_unpackhi_epi8(pixels, zero), inverse);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(low, high), src));
+    }
+    blend_span_over_sse2(dst + i, count - i, color);
+}
+
+TARGET_AVX2 static void blend_span_add_avx2(uint32_t* dst, int count, uint32_t color) {
+    __m256i src = _mm256_set1_epi32((int)color);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_loadu_si256((__m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(pixels, src));
+    }
+    blend_span_add_sse2(dst + i, count - i, color);
+}
+
+TARGET_AVX2 static void blend_over_avx2(uint32_t* dst, const uint32_t* src, int count) {
+    __m256i zero = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i source = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i pixels = _mm256_loadu_si256((__m256i*)(dst + i));
+        __m256i low = mul_div255_avx2(_mm256_unpacklo_epi8(pixels, zero), inverse_alpha_avx2(_mm256_unpacklo_epi8(source, zero)));
+        __m256i high = mul_div255_avx2(_mm256_unpackhi_epi8(pixels, zero), inverse_alpha_avx2(_mm256_unpackhi_epi8(source, zero)));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(_mm256_packus_epi16(low, high), source));
+    }
+    blend_over_sse2(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 static void blend_add_avx2(uint32_t* dst, const uint32_t* src, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i source = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i pixels = _mm256_loadu_si256((__m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_adds_epu8(pixels, source));
+    }
+    blend_add_sse2(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 static void bin_rows_avx2(const float* x, const float* y, const float* life, uint16_t* bins, int count,
+                                      float margin, int shift, uint16_t hidden) {
+    __m256 low = _mm256_set1_ps(-margin);
+    __m256 right = _mm256_set1_ps(SCREEN_WIDTH + margin);
+    __m256 bottom = _mm256_set1_ps(SCREEN_HEIGHT + margin);
+    __m256 lastRow = _mm256_set1_ps((float)(SCREEN_HEIGHT - 1));
+    __m256 zero = _mm256_setzero_ps();
+    __m128i bitShift = _mm_cvtsi32_si128(shift);
+    __m256i none = _mm256_set1_epi32(hidden);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+        __m256 visible = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(life + i), zero, _CMP_GT_OQ),
+                                       _mm256_and_ps(_mm256_cmp_ps(px, low, _CMP_GE_OQ), _mm256_cmp_ps(px, right, _CMP_LT_OQ)));
+        visible = _mm256_and_ps(visible, _mm256_and_ps(_mm256_cmp_ps(py, low, _CMP_GE_OQ), _mm256_cmp_ps(py, bottom, _CMP_LT_OQ)));
+        __m256 row = _mm256_min_ps(_mm256_max_ps(py, zero), lastRow);
+        __m256i bin = _mm256_srl_epi32(_mm256_cvttps_epi32(row), bitShift);
+        bin = _mm256_blendv_epi8(none, bin, _mm256_castps_si256(visible));
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(bin), _mm256_extracti128_si256(bin, 1));
+        _mm_storeu_si128((__m128i*)(bins + i), packed);
+    }
+    bin_rows_sse2(x + i, y + i, life + i, bins + i, count - i, margin, shift, hidden);
+}
+
+
+//
+//  CPU feature detection
+//
+
+static void cpuid(int leaf, int subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static bool os_saves_ymm() {
+    unsigned regs[4];
+    cpuid(1, 0, regs);
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx) return false;
+
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+    // XMM and YMM state enabled by the OS
+    return (xcr0 & 6) == 6;
+}
+
+SimdLevel simd_detect() {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    unsigned maxLeaf = regs[0];
+
+    cpuid(1, 0, regs);
+    if (!(regs[3] & (1u << 26))) return SIMD_SCALAR;
+
+    if (maxLeaf >= 7 && os_saves_ymm()) {
+        cpuid(7, 0, regs);
+        if (regs[1] & (1u << 5)) return SIMD_AVX2;
+    }
+    return SIMD_SSE2;
+}
+
+#else
+
+SimdLevel simd_detect() {
+    return SIMD_SCALAR;
+}
+
+#endif
+
+
+//
+//  Dispatch
+//
+
+void simd_select(SimdLevel level) {
+    SimdLevel best = simd_detect();
+    if (level > best) level = best;
+
+    currentLevel = level;
+    integrateWrapFn = integrate_wrap_scalar;
+    decrementFn = decrement_scalar;
+    updateParticlesFn = update_particles_scalar;
+    fillSpanFn = fill_span_scalar;
+    blitMask8Fn = blit_mask8_scalar;
+    blendSpanOverFn = blend_span_over_scalar;
+    blendSpanAddFn = blend_span_add_scalar;
+    blendOverFn = blend_over_scalar;
+    blendAddFn = blend_add_scalar;
+    binRowsFn = bin_rows_scalar;
+
+#if SIMD_X86
+    if (level == SIMD_SSE2) {
+        integrateWrapFn = integrate_wrap_sse2;
+        decrementFn = decrement_sse2;
+        updateParticlesFn = update_particles_sse2;
+        fillSpanFn = fill_span_sse2;
+        blitMask8Fn = blit_mask8_sse2;
+        blendSpanOverFn = blend_span_over_sse2;
+        blendSpanAddFn = blend_span_add_sse2;
+        blendOverFn = blend_over_sse2;
+        blendAddFn = blend_add_sse2;
+        binRowsFn = bin_rows_sse2;
+    } else if (level == SIMD_AVX2) {
+        integrateWrapFn = integrate_wrap_avx2;
+        decrementFn = decrement_avx2;
+        updateParticlesFn = update_particles_avx2;
+        fillSpanFn = fill_span_avx2;
+        blitMask8Fn = blit_mask8_avx2;
+        blendSpanOverFn = blend_span_over_avx2;
+        blendSpanAddFn = blend_span_add_avx2;
+        blendOverFn = blend_over_avx2;
+        blendAddFn = blend_add_avx2;
+        binRowsFn = bin_rows_avx2;
+    }
+#endif
+}
+
+static bool select_default() {
+    if (!integrateWrapFn) simd_select(simd_detect());
+    return true;
+}
+
+static void ensure_selected() {
+    // thread-safe one-time initialization; keeps an earlier simd_select()
+    static const bool selected = select_default();
+    (void)selected;
+}
+
+SimdLevel simd_level() {
+    ensure_selected();
+    return currentLevel;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_SSE2: return "sse2";
+        case SIMD_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+void integrate_wrap(float* x, float* y, const float* vx, const float* vy, int count, float dt) {
+    ensure_selected();
+    integrateWrapFn(x, y, vx, vy, count, dt);
+}
+
+void decrement(float* values, int count, float dt) {
+    ensure_selected();
+    decrementFn(values, count, dt);
+}
+
+void update_particles(float* x, float* y, float* vx, float* vy, float* life, int count, float dt, float drag) {
+    ensure_selected();
+    updateParticlesFn(x, y, vx, vy, life, count, dt, drag);
+}
+
+void fill_span(uint32_t* dst, int count, uint32_t value) {
+    ensure_selected();
+    fillSpanFn(dst, count, value);
+}
+
+void blit_mask8(uint32_t* dst, int pitch, const uint8_t* rows, int rowCount, uint32_t color) {
+    ensure_selected();
+    blitMask8Fn(dst, pitch, rows, rowCount, color);
+}
+
+void blend_span_over(uint32_t* dst, int count, uint32_t color) {
+    ensure_selected();
+    blendSpanOverFn(dst, count, color);
+}
+
+void blend_span_add(uint32_t* dst, int count, uint32_t color) {
+    ensure_selected();
+    blendSpanAddFn(dst, count, color);
+}
+
+void blend_over(uint32_t* dst, const uint32_t* src, int count) {
+    ensure_selected();
+    blendOverFn(dst, src, count);
+}
+
+void blend_add(uint32_t* dst, const uint32_t* src, int count) {
+    ensure_selected();
+    blendAddFn(dst, src, count);
+}
+
+void bin_rows(const float* x, const float* y, const float* life, uint16_t* bins, int count,
+              float margin, int shift, uint16_t hidden) {
+    ensure_selected();
+    binRowsFn(x, y, life, bins, count, margin, shift, hidden);
+}
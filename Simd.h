@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+//
+//  Batch kernels for the per-object update in act(), the span fills in
+//  draw() and the particles' row binning, with SSE2 and AVX2
+//  versions selected at runtime from the CPU features and a scalar
+//  fallback for other targets. All versions produce bit-identical results:
+//  they use separate multiply and add (no FMA) and the same wrap rule as
+//  wrap_position().
+//
+//  The blend kernels take premultiplied colors (see premultiply()) and
+//  treat all four channels alike. Source-over computes
+//  dst = src + dst * (255 - src alpha) / 255, rounded to nearest with an
+//  exact integer division; additive computes dst = src + dst. Both
+//  saturate at 255 per channel.
+//
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+// Best level supported by this CPU and OS
+SimdLevel simd_detect();
+
+// Level used by the kernels below; defaults to simd_detect()
+SimdLevel simd_level();
+const char* simd_level_name(SimdLevel level);
+
+// Forces a level (clamped to what the CPU supports); for tests and benchmarks
+void simd_select(SimdLevel level);
+
+// x += vx * dt, y += vy * dt, then wrap to the screen like wrap_position()
+void integrate_wrap(float* x, float* y, const float* vx, const float* vy, int count, float dt);
+
+// value -= dt for every element
+void decrement(float* values, int count, float dt);
+
+// vx *= drag, x += vx * dt (the same for y) and life -= dt; particles are
+// not wrapped
+void update_particles(float* x, float* y, float* vx, float* vy, float* life, int count, float dt, float drag);
+
+// dst[0..count) = value; used for horizontal spans of the framebuffer
+void fill_span(uint32_t* dst, int count, uint32_t value);
+
+// Draws rowCount rows of an 8-pixel wide 1-bit mask: where bit x of rows[r]
+// is set, dst[r * pitch + x] = color; other pixels are left untouched
+void blit_mask8(uint32_t* dst, int pitch, const uint8_t* rows, int rowCount, uint32_t color);
+
+// Blends one premultiplied color over dst[0..count)
+void blend_span_over(uint32_t* dst, int count, uint32_t color);
+
+// Adds one premultiplied color to dst[0..count)
+void blend_span_add(uint32_t* dst, int count, uint32_t color);
+
+// Blends premultiplied src[i] over dst[i] for count pixels
+void blend_over(uint32_t* dst, const uint32_t* src, int count);
+
+// Adds premultiplied src[i] to dst[i] for count pixels
+void blend_add(uint32_t* dst, const uint32_t* src, int count);
+
+// bins[i] = row >> shift, row being y[i] truncated and clamped to the
+// screen's rows, for particles with life left inside the screen widened by
+// margin; the others get hidden
+void bin_rows(const float* x, const float* y, const float* life, uint16_t* bins, int count,
+              float margin, int shift, uint16_t hidden);
+
+// A straight-alpha ARGB color with its channels scaled by its alpha
+inline uint32_t premultiply(uint32_t color) {
+    uint32_t a = color >> 24;
+    uint32_t out = a << 24;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t t = ((color >> shift) & 255) * a + 128;
+        out |= ((t + (t >> 8)) >> 8) << shift;
+    }
+    return out;
+}
@@ -0,0 +1,483 @@
+#include "Snapshot.h"
+#include <math.h>
+#include <string.h>
+
+static const int POSITION_SCALE = 8;  // 1/8 px
+static const int VELOCITY_SCALE = 8;  // 1/8 px/s
+static const int SIZE_SCALE = 4;      // 1/4 px
+static const int WIDTH_UNITS = SCREEN_WIDTH * POSITION_SCALE;
+static const int HEIGHT_UNITS = SCREEN_HEIGHT * POSITION_SCALE;
+static const int POSITION_BITS = 13;  // both extents fit below 8192
+static const int SHIP_COUNT_BITS = 4;
+static const int BULLET_SLOT_BITS = 8;
+static const int ASTEROID_SLOT_BITS = 8;
+
+static_assert(WIDTH_UNITS <= (1 << POSITION_BITS) && HEIGHT_UNITS <= (1 << POSITION_BITS), "positions exceed their field");
+static_assert(MAX_SHIPS < (1 << SHIP_COUNT_BITS), "ship count exceeds its field");
+static_assert(MAX_BULLETS <= (1 << BULLET_SLOT_BITS) && MAX_ASTEROIDS <= (1 << ASTEROID_SLOT_BITS), "pool slots exceed their field");
+
+// Worst case sizes in bits: every residual at 34 bits, every slot changed
+static const int RESIDUAL_MAX_BITS = 34;
+static const int SHIP_MAX_BITS = 1 + 5 * RESIDUAL_MAX_BITS + 1;
+static const int BULLET_MAX_BITS = 1 + 4 * RESIDUAL_MAX_BITS;
+static const int ASTEROID_MAX_BITS = 1 + 5 * RESIDUAL_MAX_BITS;
+static const int SNAPSHOT_MAX_BITS = SHIP_COUNT_BITS + 2 * RESIDUAL_MAX_BITS + 2 + MAX_SHIPS * SHIP_MAX_BITS +
+                                     2 * (BULLET_SLOT_BITS + 1) + MAX_BULLETS * BULLET_MAX_BITS +
+                                     2 * (ASTEROID_SLOT_BITS + 1) + MAX_ASTEROIDS * ASTEROID_MAX_BITS;
+static_assert((SNAPSHOT_MAX_BITS + 7) / 8 <= SNAPSHOT_MAX_BYTES, "snapshots can outgrow SNAPSHOT_MAX_BYTES");
+
+void Snapshot::clear(uint32_t atTick) {
+    tick = atTick;
+    shipCount = 0;
+    lives = 0;
+    score = 0;
+    gameOver = false;
+    gameWon = false;
+    memset(ships, 0, sizeof(ships));
+    memset(bullets, 0, sizeof(bullets));
+    memset(asteroids, 0, sizeof(asteroids));
+}
+
+// --- Quantization ---
+
+static int wrap_units(int value, int extent) {
+    value %= extent;
+    return value < 0 ? value + extent : value;
+}
+
+static uint16_t quantize_position(float value, int extent) {
+    return (uint16_t)wrap_units((int)lrintf(value * POSITION_SCALE), extent);
+}
+
+static int16_t quantize_velocity(float value) {
+    long units = lrintf(value * VELOCITY_SCALE);
+    if (units > 32767) units = 32767;
+    if (units < -32767) units = -32767;
+    return (int16_t)units;
+}
+
+static uint16_t quantize_angle(float angle) {
+    float turns = angle * (1.0f / 6.2831853f);
+    turns -= floorf(turns);
+    return (uint16_t)((uint32_t)lrintf(turns * 65536.0f) & 0xFFFF);
+}
+
+template <typename Pool>
+static void capture_bodies(const Pool& pool, const std::vector<float>* sizes, NetBody* bodies, int capacity) {
+    memset(bodies, 0, sizeof(NetBody) * capacity);
+    for (int i = 0; i < pool.count(); i++) {
+        PoolHandle handle = pool.handle(i);
+        if ((int)handle.slot >= capacity) continue;
+
+        NetBody& body = bodies[handle.slot];
+        body.x = quantize_position(pool.x[i], WIDTH_UNITS);
+        body.y = quantize_position(pool.y[i], HEIGHT_UNITS);
+        body.vx = quantize_velocity(pool.vx[i]);
+        body.vy = quantize_velocity(pool.vy[i]);
+        body.size = sizes ? (uint8_t)fminf((*sizes)[i] * SIZE_SCALE + 0.5f, 255.0f) : 0;
+        body.present = 1;
+        body.generation = handle.generation;
+    }
+}
+
+void capture_snapshot(const World& world, uint32_t tick, Snapshot& out) {
+    out.tick = tick;
+    out.shipCount = world.shipCount;
+    out.lives = world.playerLives;
+    out.score = world.score;
+    out.gameOver = world.gameOver;
+    out.gameWon = world.gameWon;
+
+    memset(out.ships, 0, sizeof(out.ships));
+    for (int s = 0; s < world.shipCount; s++) {
+        const Ship& ship = world.ships[s];
+        NetShip& net = out.ships[s];
+        net.x = quantize_position(ship.position.x, WIDTH_UNITS);
+        net.y = quantize_position(ship.position.y, HEIGHT_UNITS);
+        net.vx = quantize_velocity(ship.velocity.x);
+        net.vy = quantize_velocity(ship.velocity.y);
+        net.angle = quantize_angle(ship.angle);
+        net.alive = ship.alive ? 1 : 0;
+    }
+
+    capture_bodies(world.bullets, nullptr, out.bullets, MAX_BULLETS);
+    capture_bodies(world.asteroids, &world.asteroids.size, out.asteroids, MAX_ASTEROIDS);
+}
+
+void apply_snapshot(const Snapshot& snapshot, World& world) {
+    world.shipCount = snapshot.shipCount;
+    for (int s = 0; s < snapshot.shipCount; s++) {
+        const NetShip& net = snapshot.ships[s];
+        Ship& ship = world.ships[s];
+        ship.position = Vector2((float)net.x / POSITION_SCALE, (float)net.y / POSITION_SCALE);
+        ship.velocity = Vector2((float)net.vx / VELOCITY_SCALE, (float)net.vy / VELOCITY_SCALE);
+        ship.angle = net.angle * (6.2831853f / 65536.0f);
+        ship.alive = net.alive != 0;
+        ship.prevPosition = ship.position;
+        ship.prevAngle = ship.angle;
+    }
+
+    world.bullets.reserve(MAX_BULLETS);
+    world.asteroids.reserve(MAX_ASTEROIDS);
+    world.bullets.clear();
+    world.asteroids.clear();
+    for (int slot = 0; slot < MAX_BULLETS; slot++) {
+        const NetBody& body = snapshot.bullets[slot];
+        if (!body.present) continue;
+        world.bullets.add(Vector2((float)body.x / POSITION_SCALE, (float)body.y / POSITION_SCALE),
+                          Vector2((float)body.vx / VELOCITY_SCALE, (float)body.vy / VELOCITY_SCALE), 1.0f);
+    }
+    for (int slot = 0; slot < MAX_ASTEROIDS; slot++) {
+        const NetBody& body = snapshot.asteroids[slot];
+        if (!body.present) continue;
+        world.asteroids.add(Vector2((float)body.x / POSITION_SCALE, (float)body.y / POSITION_SCALE),
+                            Vector2((float)body.vx / VELOCITY_SCALE, (float)body.vy / VELOCITY_SCALE),
+                            (float)body.size / SIZE_SCALE);
+    }
+
+    world.playerLives = snapshot.lives;
+    world.score = snapshot.score;
+    world.gameOver = snapshot.gameOver;
+    world.gameWon = snapshot.gameWon;
+    world.tickAccumulator = 0;
+}
+
+// FNV-1a over the sent fields
+static void hash_u32(uint32_t& hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 16777619u;
+    }
+}
+
+static void hash_bodies(uint32_t& hash, const NetBody* bodies, int capacity) {
+    for (int slot = 0; slot < capacity; slot++) {
+        const NetBody& body = bodies[slot];
+        if (!body.present) continue;
+        hash_u32(hash, (uint32_t)slot);
+        hash_u32(hash, (uint32_t)body.x << 16 | body.y);
+        hash_u32(hash, (uint32_t)(uint16_t)body.vx << 16 | (uint16_t)body.vy);
+        hash_u32(hash, body.size);
+    }
+}
+
+uint32_t hash_snapshot(const Snapshot& snapshot) {
+    uint32_t hash = 2166136261u;
+    hash_u32(hash, (uint32_t)snapshot.shipCount);
+    hash_u32(hash, (uint32_t)snapshot.lives);
+    hash_u32(hash, (uint32_t)snapshot.score);
+    hash_u32(hash, (uint32_t)snapshot.gameOver << 1 | (uint32_t)snapshot.gameWon);
+    for (int s = 0; s < snapshot.shipCount; s++) {
+        const NetShip& ship = snapshot.ships[s];
+        hash_u32(hash, (uint32_t)ship.x << 16 | ship.y);
+        hash_u32(hash, (uint32_t)(uint16_t)ship.vx << 16 | (uint16_t)ship.vy);
+        hash_u32(hash, (uint32_t)ship.angle << 8 | ship.alive);
+    }
+    hash_bodies(hash, snapshot.bullets, MAX_BULLETS);
+    hash_bodies(hash, snapshot.asteroids, MAX_ASTEROIDS);
+    return hash;
+}
+
+// --- Bit stream ---
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out), pending(0), pendingBits(0) {}
+
+    void write(uint32_t value, int bits) {
+        pending |= (uint64_t)(value & ((1ull << bits) - 1)) << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            out.push_back((uint8_t)pending);
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+
+    void flush() {
+        if (pendingBits > 0) out.push_back((uint8_t)pending);
+        pending = 0;
+        pendingBits = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    uint64_t pending;
+    int pendingBits;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size), offset(0), pending(0), pendingBits(0), overrun(false) {}
+
+    uint32_t read(int bits) {
+        while (pendingBits < bits) {
+            uint64_t byte = 0;
+            if (offset < size) byte = data[offset++];
+            else overrun = true;
+            pending |= byte << pendingBits;
+            pendingBits += 8;
+        }
+        uint32_t value = (uint32_t)(pending & ((1ull << bits) - 1));
+        pending >>= bits;
+        pendingBits -= bits;
+        return value;
+    }
+
+    bool failed() const { return overrun; }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    uint64_t pending;
+    int pendingBits;
+    bool overrun;
+};
+
+// Signed difference in a 2-bit size class: zero, 4, 8 or 32 bits of zigzag
+static void write_residual(BitWriter& writer, int32_t residual) {
+    uint32_t zigzag = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+    if (zigzag == 0) {
+        writer.write(0, 2);
+    } else if (zigzag < (1u << 4)) {
+        writer.write(1, 2);
+        writer.write(zigzag, 4);
+    } else if (zigzag < (1u << 8)) {
+        writer.write(2, 2);
+        writer.write(zigzag, 8);
+    } else {
+        writer.write(3, 2);
+        writer.write(zigzag, 32);
+    }
+}
+
+static int32_t read_residual(BitReader& reader) {
+    static const int CLASS_BITS[4] = { 0, 4, 8, 32 };
+    int bits = CLASS_BITS[reader.read(2)];
+    uint32_t zigzag = bits ? reader.read(bits) : 0;
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+// Where base's object would be after the given ticks at its velocity
+static int predict_position(int position, int velocity, uint32_t ticks, int extent) {
+    return wrap_units(position + (int)((int64_t)velocity * ticks / SNAPSHOT_RATE), extent);
+}
+
+// Shortest signed distance from predicted to actual on the wrapped axis
+static int32_t wrapped_residual(int actual, int predicted, int extent) {
+    int32_t residual = wrap_units(actual - predicted, extent);
+    return residual >= extent / 2 ? residual - extent : residual;
+}
+
+// --- Ships ---
+
+static void write_ship_full(BitWriter& writer, const NetShip& ship) {
+    writer.write(ship.x, POSITION_BITS);
+    writer.write(ship.y, POSITION_BITS);
+    writer.write((uint16_t)ship.vx, 16);
+    writer.write((uint16_t)ship.vy, 16);
+    writer.write(ship.angle, 16);
+    writer.write(ship.alive, 1);
+}
+
+static void read_ship_full(BitReader& reader, NetShip& ship) {
+    ship.x = (uint16_t)reader.read(POSITION_BITS);
+    ship.y = (uint16_t)reader.read(POSITION_BITS);
+    ship.vx = (int16_t)reader.read(16);
+    ship.vy = (int16_t)reader.read(16);
+    ship.angle = (uint16_t)reader.read(16);
+    ship.alive = (uint8_t)reader.read(1);
+}
+
+static void write_ship_delta(BitWriter& writer, const NetShip& ship, const NetShip& base, uint32_t ticks) {
+    int32_t dx = wrapped_residual(ship.x, predict_position(base.x, base.vx, ticks, WIDTH_UNITS), WIDTH_UNITS);
+    int32_t dy = wrapped_residual(ship.y, predict_position(base.y, base.vy, ticks, HEIGHT_UNITS), HEIGHT_UNITS);
+    int32_t dvx = ship.vx - base.vx;
+    int32_t dvy = ship.vy - base.vy;
+    int32_t dangle = (int16_t)(uint16_t)(ship.angle - base.angle);
+    bool same = dx == 0 && dy == 0 && dvx == 0 && dvy == 0 && dangle == 0 && ship.alive == base.alive;
+
+    writer.write(same ? 0 : 1, 1);
+    if (same) return;
+    write_residual(writer, dx);
+    write_residual(writer, dy);
+    write_residual(writer, dvx);
+    write_residual(writer, dvy);
+    write_residual(writer, dangle);
+    writer.write(ship.alive, 1);
+}
+
+static void read_ship_delta(BitReader& reader, NetShip& ship, const NetShip& base, uint32_t ticks) {
+    int px = predict_position(base.x, base.vx, ticks, WIDTH_UNITS);
+    int py = predict_position(base.y, base.vy, ticks, HEIGHT_UNITS);
+    ship = base;
+    ship.x = (uint16_t)px;
+    ship.y = (uint16_t)py;
+    if (!reader.read(1)) return;
+
+    ship.x = (uint16_t)wrap_units(px + read_residual(reader), WIDTH_UNITS);
+    ship.y = (uint16_t)wrap_units(py + read_residual(reader), HEIGHT_UNITS);
+    ship.vx = (int16_t)(base.vx + read_residual(reader));
+    ship.vy = (int16_t)(base.vy + read_residual(reader));
+    ship.angle = (uint16_t)(base.angle + read_residual(reader));
+    ship.alive = (uint8_t)reader.read(1);
+}
+
+// --- Bullets and asteroids ---
+
+static void write_body_full(BitWriter& writer, const NetBody& body, bool sized) {
+    writer.write(body.x, POSITION_BITS);
+    writer.write(body.y, POSITION_BITS);
+    writer.write((uint16_t)body.vx, 16);
+    writer.write((uint16_t)body.vy, 16);
+    if (sized) writer.write(body.size, 8);
+}
+
+static void read_body_full(BitReader& reader, NetBody& body, bool sized) {
+    body.x = (uint16_t)reader.read(POSITION_BITS);
+    body.y = (uint16_t)reader.read(POSITION_BITS);
+    body.vx = (int16_t)reader.read(16);
+    body.vy = (int16_t)reader.read(16);
+    body.size = sized ? (uint8_t)reader.read(8) : 0;
+    body.present = 1;
+    body.generation = 0;
+}
+
+static void write_body_delta(BitWriter& writer, const NetBody& body, const NetBody& base, bool sized, uint32_t ticks) {
+    int32_t dx = wrapped_residual(body.x, predict_position(base.x, base.vx, ticks, WIDTH_UNITS), WIDTH_UNITS);
+    int32_t dy = wrapped_residual(body.y, predict_position(base.y, base.vy, ticks, HEIGHT_UNITS), HEIGHT_UNITS);
+    int32_t dvx = body.vx - base.vx;
+    int32_t dvy = body.vy - base.vy;
+    int32_t dsize = body.size - base.size;
+    bool same = dx == 0 && dy == 0 && dvx == 0 && dvy == 0 && dsize == 0;
+
+    writer.write(same ? 0 : 1, 1);
+    if (same) return;
+    write_residual(writer, dx);
+    write_residual(writer, dy);
+    write_residual(writer, dvx);
+    write_residual(writer, dvy);
+    if (sized) write_residual(writer, dsize);
+}
+
+static void read_body_delta(BitReader& reader, NetBody& body, const NetBody& base, bool sized, uint32_t ticks) {
+    int px = predict_position(base.x, base.vx, ticks, WIDTH_UNITS);
+    int py = predict_position(base.y, base.vy, ticks, HEIGHT_UNITS);
+    body = base;
+    body.x = (uint16_t)px;
+    body.y = (uint16_t)py;
+    body.generation = 0;
+    if (!reader.read(1)) return;
+
+    body.x = (uint16_t)wrap_units(px + read_residual(reader), WIDTH_UNITS);
+    body.y = (uint16_t)wrap_units(py + read_residual(reader), HEIGHT_UNITS);
+    body.vx = (int16_t)(base.vx + read_residual(reader));
+    body.vy = (int16_t)(base.vy + read_residual(reader));
+    if (sized) body.size = (uint8_t)(base.size + read_residual(reader));
+}
+
+// A slot holds a different object than in base when its generation moved on;
+// the base of a full snapshot has no objects, so everything is new
+static bool same_object(const NetBody& body, const NetBody& base) {
+    return body.present && base.present && body.generation == base.generation;
+}
+
+static void encode_bodies(BitWriter& writer, const NetBody* bodies, const NetBody* base, int capacity,
+                          int slotBits, bool sized, uint32_t ticks) {
+    int removed = 0, added = 0;
+    for (int slot = 0; slot < capacity; slot++) {
+        if (base[slot].present && !same_object(bodies[slot], base[slot])) removed++;
+        if (bodies[slot].present && !same_object(bodies[slot], base[slot])) added++;
+    }
+
+    writer.write((uint32_t)removed, slotBits + 1);
+    for (int slot = 0; slot < capacity; slot++) {
+        if (base[slot].present && !same_object(bodies[slot], base[slot])) writer.write((uint32_t)slot, slotBits);
+    }
+    writer.write((uint32_t)added, slotBits + 1);
+    for (int slot = 0; slot < capacity; slot++) {
+        if (bodies[slot].present && !same_object(bodies[slot], base[slot])) {
+            writer.write((uint32_t)slot, slotBits);
+            write_body_full(writer, bodies[slot], sized);
+        }
+    }
+    for (int slot = 0; slot < capacity; slot++) {
+        if (same_object(bodies[slot], base[slot])) write_body_delta(writer, bodies[slot], base[slot], sized, ticks);
+    }
+}
+
+static bool decode_bodies(BitReader& reader, NetBody* bodies, const NetBody* base, int capacity,
+                          int slotBits, bool sized, uint32_t ticks) {
+    // 1 while the slot keeps base's object, 2 once it was filled anew
+    uint8_t state[MAX_ASTEROIDS > MAX_BULLETS ? MAX_ASTEROIDS : MAX_BULLETS];
+    for (int slot = 0; slot < capacity; slot++) {
+        state[slot] = base[slot].present ? 1 : 0;
+        memset(&bodies[slot], 0, sizeof(NetBody));
+    }
+
+    int removed = (int)reader.read(slotBits + 1);
+    if (removed > capacity) return false;
+    for (int k = 0; k < removed; k++) {
+        int slot = (int)reader.read(slotBits);
+        if (slot >= capacity || state[slot] != 1) return false;
+        state[slot] = 0;
+    }
+    int added = (int)reader.read(slotBits + 1);
+    if (added > capacity) return false;
+    for (int k = 0; k < added; k++) {
+        int slot = (int)reader.read(slotBits);
+        if (slot >= capacity || state[slot] != 0) return false;
+        read_body_full(reader, bodies[slot], sized);
+        state[slot] = 2;
+    }
+    for (int slot = 0; slot < capacity; slot++) {
+        if (state[slot] == 1) read_body_delta(reader, bodies[slot], base[slot], sized, ticks);
+    }
+    return !reader.failed();
+}
+
+// --- Snapshot ---
+
+void encode_snapshot(const Snapshot& snapshot, const Snapshot& base, std::vector<uint8_t>& out) {
+    BitWriter writer(out);
+    uint32_t ticks = snapshot.tick - base.tick;
+
+    writer.write((uint32_t)snapshot.shipCount, SHIP_COUNT_BITS);
+    write_residual(writer, snapshot.lives - base.lives);
+    write_residual(writer, snapshot.score - base.score);
+    writer.write(snapshot.gameOver ? 1 : 0, 1);
+    writer.write(snapshot.gameWon ? 1 : 0, 1);
+
+    for (int s = 0; s < snapshot.shipCount; s++) {
+        if (s < base.shipCount) write_ship_delta(writer, snapshot.ships[s], base.ships[s], ticks);
+        else write_ship_full(writer, snapshot.ships[s]);
+    }
+
+    encode_bodies(writer, snapshot.bullets, base.bullets, MAX_BULLETS, BULLET_SLOT_BITS, false, ticks);
+    encode_bodies(writer, snapshot.asteroids, base.asteroids, MAX_ASTEROIDS, ASTEROID_SLOT_BITS, true, ticks);
+    writer.flush();
+}
+
+bool decode_snapshot(const uint8_t* data, size_t size, const Snapshot& base, uint32_t tick, Snapshot& out) {
+    BitReader reader(data, size);
+    uint32_t ticks = tick - base.tick;
+
+    out.tick = tick;
+    out.shipCount = (int)reader.read(SHIP_COUNT_BITS);
+    if (out.shipCount > MAX_SHIPS) return false;
+    out.lives = base.lives + read_residual(reader);
+    out.score = base.score + read_residual(reader);
+    out.gameOver = reader.read(1) != 0;
+    out.gameWon = reader.read(1) != 0;
+
+    memset(out.ships, 0, sizeof(out.ships));
+    for (int s = 0; s < out.shipCount; s++) {
+        if (s < base.shipCount) read_ship_delta(reader, out.ships[s], base.ships[s], ticks);
+        else read_ship_full(reader, out.ships[s]);
+    }
+
+    if (!decode_bodies(reader, out.bullets, base.bullets, MAX_BULLETS, BULLET_SLOT_BITS, false, ticks)) return false;
+    if (!decode_bodies(reader, out.asteroids, base.asteroids, MAX_ASTEROIDS, ASTEROID_SLOT_BITS, true, ticks)) return false;
+    return !reader.failed();
+}
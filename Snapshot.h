@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Game.h"
+#include <stdint.h>
+#include <vector>
+
+//
+//  Quantized world snapshots and their delta coding for the network.
+//
+//  A snapshot holds what a client needs to show a World: the ships, and the
+//  bullets and asteroids by pool slot, so the same object keeps the same
+//  place from one snapshot to the next. Positions are kept in 1/8 px,
+//  velocities in 1/8 px/s, angles in 1/65536 turn and asteroid radii in
+//  1/4 px.
+//
+//  encode_snapshot() writes a snapshot as a bit stream relative to a base
+//  snapshot the receiver already has (the last one it acknowledged). Per
+//  pool it lists the slots that were emptied and the ones that were filled
+//  (those carry all of their fields); every other object is one bit when it
+//  moved as its base velocity predicts, or the changed fields in a few bits
+//  each. Against no base the whole snapshot is written.
+//
+
+// Snapshots per second; object positions are predicted from the base
+// velocity over the tick distance between two snapshots
+const int SNAPSHOT_RATE = 60;
+
+// Bound on an encoded snapshot of the pool capacities, whatever its base
+const int SNAPSHOT_MAX_BYTES = 10240;
+
+struct NetShip {
+    uint16_t x, y;
+    int16_t vx, vy;
+    uint16_t angle;
+    uint8_t alive;
+};
+
+struct NetBody {
+    uint16_t x, y;
+    int16_t vx, vy;
+    uint8_t size;        // asteroid radius; 0 for bullets
+    uint8_t present;
+    uint32_t generation; // pool slot generation, server side only
+};
+
+struct Snapshot {
+    uint32_t tick;
+    int shipCount;
+    int lives;
+    int score;
+    bool gameOver;
+    bool gameWon;
+    NetShip ships[MAX_SHIPS];
+    NetBody bullets[MAX_BULLETS];
+    NetBody asteroids[MAX_ASTEROIDS];
+
+    Snapshot() { clear(0); }
+
+    // Empty world at the given tick, the base of a full snapshot
+    void clear(uint32_t atTick);
+};
+
+void capture_snapshot(const World& world, uint32_t tick, Snapshot& out);
+
+// Rebuilds a world for display; simulation-only state (bullet lifetime,
+// cooldowns, random state) is not part of a snapshot
+void apply_snapshot(const Snapshot& snapshot, World& world);
+
+// Hash of everything a snapshot sends; both ends get the same value when
+// the client reconstructed the snapshot exactly
+uint32_t hash_snapshot(const Snapshot& snapshot);
+
+// Appends snapshot coded against base to out
+void encode_snapshot(const Snapshot& snapshot, const Snapshot& base, std::vector<uint8_t>& out);
+
+// Decodes a snapshot of the given tick coded against base; false if the
+// data is malformed
+bool decode_snapshot(const uint8_t* data, size_t size, const Snapshot& base, uint32_t tick, Snapshot& out);
@@ -0,0 +1,19 @@
+#include "SpatialGrid.h"
+
+// Smallest cell edge; keeps the cell count bounded for tiny objects.
+static const float MIN_CELL_SIZE = 8.0f;
+
+void SpatialGrid::resize(float cellSize) {
+    if (!(cellSize > MIN_CELL_SIZE)) cellSize = MIN_CELL_SIZE;
+
+    // round the cell count down so cells are never smaller than cellSize
+    cols = (int)(SCREEN_WIDTH / cellSize);
+    rows = (int)(SCREEN_HEIGHT / cellSize);
+    if (cols < 1) cols = 1;
+    if (rows < 1) rows = 1;
+
+    cellWidth = (float)SCREEN_WIDTH / cols;
+    cellHeight = (float)SCREEN_HEIGHT / rows;
+    invCellWidth = 1.0f / cellWidth;
+    invCellHeight = 1.0f / cellHeight;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Engine.h"
+#include <math.h>
+#include <vector>
+
+//
+//  Toroidal uniform grid over the screen used as a collision broadphase.
+//
+//  Rebuilt every frame with a counting sort, so items inside a cell keep
+//  their original index order. Each cell stores packed copies of the item
+//  positions and radii, and the cells of a row follow each other, so a
+//  query streams through one contiguous run per row.
+//
+//  The caller picks the cell size, typically the mean item radius plus the
+//  typical query radius, from constants rather than from the items, so
+//  the layout depends only on what is built. A query scans, row by row,
+//  the cells within its radius plus the largest item radius and tests the
+//  candidates' circles without branching, so only actual overlaps reach
+//  the caller. Cells wrap at the screen edges the same way wrap_position()
+//  wraps objects; an item on the far edge (SCREEN_WIDTH) is stored a
+//  screen over, at 0, so each run of cells sits a whole number of screens
+//  from the query and its entries need no wrapping of their own.
+//
+
+class SpatialGrid {
+public:
+    struct Entry {
+        float x, y;
+        float radius;
+        int item;
+    };
+
+    SpatialGrid() : cols(1), rows(1), invCellWidth(1.0f / SCREEN_WIDTH), invCellHeight(1.0f / SCREEN_HEIGHT),
+                    cellWidth((float)SCREEN_WIDTH), cellHeight((float)SCREEN_HEIGHT), maxRadius(0) {}
+
+    // entryOf(i) returns the Entry (position and radius) of item i
+    template <class EntryOf>
+    void build(int count, float cellSize, EntryOf entryOf) {
+        resize(cellSize);
+
+        unsorted.resize(count);
+        itemCell.resize(count);
+        cellStart.assign(cols * rows + 1, 0);
+        maxRadius = 0;
+        for (int i = 0; i < count; i++) {
+            Entry e = entryOf(i);
+            e.item = i;
+            itemCell[i] = place(e);
+            cellStart[itemCell[i]]++;
+            unsorted[i] = e;
+            if (e.radius > maxRadius) maxRadius = e.radius;
+        }
+        for (int c = 1; c <= cols * rows; c++) {
+            cellStart[c] += cellStart[c - 1];
+        }
+
+        // each cell's end counts down to its start, so filling from the last
+        // item keeps the order inside cells
+        entries.resize(count);
+        for (int i = count - 1; i >= 0; i--) {
+            entries[--cellStart[itemCell[i]]] = unsorted[i];
+        }
+    }
+
+    // Calls visit(entry) for every item whose circle overlaps the circle at
+    // (x, y), measured the short way around the screen edges
+    template <class Visit>
+    void query(float x, float y, float radius, Visit visit) const {
+        float reach = radius + maxRadius;
+        int x0 = floor_int((x - reach) * invCellWidth), x1 = floor_int((x + reach) * invCellWidth);
+        int y0 = floor_int((y - reach) * invCellHeight), y1 = floor_int((y + reach) * invCellHeight);
+
+        // a range wider than the grid would visit cells twice, and could
+        // reach an item both ways around the screen
+        if (x1 - x0 + 1 >= cols || y1 - y0 + 1 >= rows) {
+            for (const Entry& e : entries) {
+                if (overlaps(e, x, y, radius)) visit(e);
+            }
+            return;
+        }
+
+        for (int gy = y0; gy <= y1; gy++) {
+            // only the columns the reach circle spans at this row's nearest edge
+            float top = gy * cellHeight, bottom = top + cellHeight;
+            float edge = y < top ? top - y : (y > bottom ? y - bottom : 0.0f);
+            float half = sqrtf(fmaxf(reach * reach - edge * edge, 0.0f));
+            int rx0 = floor_int((x - half) * invCellWidth), rx1 = floor_int((x + half) * invCellWidth);
+
+            // a row's cells are one run of entries, or two where the row
+            // wraps; each run sits a whole number of screens from the query
+            int row = wrap(gy, rows), rowStart = row * cols;
+            int first = wrap(rx0, cols), span = rx1 - rx0 + 1;
+            int wrapped = first + span > cols ? first + span - cols : 0;
+            float dy = (float)(gy - row) / rows * SCREEN_HEIGHT - y;
+            float dx = (float)(rx0 - first) / cols * SCREEN_WIDTH - x;
+            visit_run(cellStart[rowStart + first], cellStart[rowStart + first + span - wrapped], dx, dy, radius, visit);
+            visit_run(cellStart[rowStart], cellStart[rowStart + wrapped], dx + SCREEN_WIDTH, dy, radius, visit);
+        }
+    }
+
+private:
+    void resize(float cellSize);
+
+    // The short way around an axis that wraps every size pixels
+    static float wrap_offset(float offset, float size) {
+        return offset > size * 0.5f ? offset - size : (offset < -size * 0.5f ? offset + size : offset);
+    }
+
+    static bool overlaps(const Entry& e, float x, float y, float radius) {
+        float dx = wrap_offset(e.x - x, (float)SCREEN_WIDTH);
+        float dy = wrap_offset(e.y - y, (float)SCREEN_HEIGHT);
+        float bound = radius + e.radius;
+        return dx * dx + dy * dy < bound * bound;
+    }
+
+    // Tests a run of entries, offset by (dx, dy) from the query, in
+    // batches: the indices of the overlapping ones are collected without a
+    // branch, so a candidate's test does not wait on how the previous one
+    // came out
+    template <class Visit>
+    void visit_run(int begin, int end, float dx, float dy, float radius, Visit& visit) const {
+        const int BATCH = 64;
+        int hits[BATCH];
+        while (begin < end) {
+            int stop = end - begin > BATCH ? begin + BATCH : end;
+            int count = 0;
+            for (int k = begin; k < stop; k++) {
+                float ex = entries[k].x + dx, ey = entries[k].y + dy;
+                float bound = radius + entries[k].radius;
+                hits[count] = k;
+                count += ex * ex + ey * ey < bound * bound;
+            }
+            for (int i = 0; i < count; i++) visit(entries[hits[i]]);
+            begin = stop;
+        }
+    }
+
+    // floorf() is a library call without SSE4.1
+    static int floor_int(float v) {
+        int i = (int)v;
+        return i - (v < (float)i);
+    }
+
+    static int wrap(int i, int n) {
+        if ((unsigned)i < (unsigned)n) return i;
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    // Returns the cell of e, moving it a screen over if it lies on the far
+    // edge, so every entry of a cell is inside it
+    int place(Entry& e) const {
+        int gx = floor_int(e.x * invCellWidth), gy = floor_int(e.y * invCellHeight);
+        int col = wrap(gx, cols), row = wrap(gy, rows);
+        if (gx != col) e.x -= (float)(gx - col) / cols * SCREEN_WIDTH;
+        if (gy != row) e.y -= (float)(gy - row) / rows * SCREEN_HEIGHT;
+        return row * cols + col;
+    }
+
+    int cols, rows;
+    float invCellWidth, invCellHeight;
+    float cellWidth, cellHeight;
+    float maxRadius;
+    std::vector<int> cellStart;
+    std::vector<Entry> entries;
+    std::vector<Entry> unsorted;
+    std::vector<int> itemCell;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+//
+//  Lock-free triple buffer between one writer and one reader.
+//
+//  The writer fills its back slot and publishes it by swapping it with the
+//  middle slot; the reader takes the newest value by swapping its front
+//  slot with the middle one, but only when a value was published since.
+//  Both sides swap with one atomic exchange and never wait for the other:
+//  the writer never touches the slot being read, the reader never sees a
+//  half-written one, and values the reader was too slow to take are
+//  overwritten.
+//
+
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    // Slot the writer fills before publish()
+    T& write_slot() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // The newest published value; the one read last time if nothing was
+    // published since, which fresh reports
+    const T& read(bool* fresh = nullptr) {
+        bool isFresh = (middle.load(std::memory_order_relaxed) & FRESH) != 0;
+        if (isFresh) front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        if (fresh) *fresh = isFresh;
+        return slots[front];
+    }
+
+    // All three slots, for setting them up while neither side runs
+    T& slot(int i) { return slots[i]; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T slots[3];
+    std::atomic<int> middle; // slot index, plus FRESH while the reader has not taken it
+    int back;                // owned by the writer
+    int front;               // owned by the reader
+};
@@ -0,0 +1,96 @@
+#include "WorldState.h"
+#include <stddef.h>
+#include <string.h>
+
+// The part of a world that is not in its archetypes
+struct StateScalars {
+    Ship ships[MAX_SHIPS];
+    int shipCount;
+    int playerLives;
+    int score;
+    bool gameOver;
+    bool gameWon;
+    float tickAccumulator;
+    GameRandom random;
+    uint32_t seed;
+};
+
+// Fields move straight between a world and a state's bytes, so neither
+// side builds a StateScalars, and with it MAX_SHIPS ships, on the way
+template <class T>
+static void put(uint8_t* state, size_t offset, const T& value) {
+    memcpy(state + offset, &value, sizeof(value));
+}
+
+template <class T>
+static void get(const uint8_t* state, size_t offset, T& value) {
+    memcpy(&value, state + offset, sizeof(value));
+}
+
+static size_t round_up(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+void StateArena::reserve(int count, int bullets, int asteroids) {
+    // the layout is whatever the archetypes write at these capacities
+    BulletArray bulletLayout;
+    AsteroidArray asteroidLayout;
+    bulletLayout.reserve(bullets);
+    asteroidLayout.reserve(asteroids);
+
+    states = count;
+    bulletCapacity = bullets;
+    asteroidCapacity = asteroids;
+    asteroidOffset = round_up(sizeof(StateScalars) + bulletLayout.state_bytes(), 8);
+    stride = round_up(asteroidOffset + asteroidLayout.state_bytes(), 64);
+    block.assign((size_t)count * stride, 0);
+}
+
+void StateArena::save(const World& world, int state) {
+    uint8_t* out = at(state);
+
+    put(out, offsetof(StateScalars, ships), world.ships);
+    put(out, offsetof(StateScalars, shipCount), world.shipCount);
+    put(out, offsetof(StateScalars, playerLives), world.playerLives);
+    put(out, offsetof(StateScalars, score), world.score);
+    put(out, offsetof(StateScalars, gameOver), world.gameOver);
+    put(out, offsetof(StateScalars, gameWon), world.gameWon);
+    put(out, offsetof(StateScalars, tickAccumulator), world.tickAccumulator);
+    put(out, offsetof(StateScalars, random), world.random);
+    put(out, offsetof(StateScalars, seed), world.seed);
+
+    world.bullets.save_state(out + sizeof(StateScalars));
+    world.asteroids.save_state(out + asteroidOffset);
+}
+
+void StateArena::restore(int state, World& world) const {
+    const uint8_t* in = at(state);
+
+    get(in, offsetof(StateScalars, ships), world.ships);
+    get(in, offsetof(StateScalars, shipCount), world.shipCount);
+    get(in, offsetof(StateScalars, playerLives), world.playerLives);
+    get(in, offsetof(StateScalars, score), world.score);
+    get(in, offsetof(StateScalars, gameOver), world.gameOver);
+    get(in, offsetof(StateScalars, gameWon), world.gameWon);
+    get(in, offsetof(StateScalars, tickAccumulator), world.tickAccumulator);
+    get(in, offsetof(StateScalars, random), world.random);
+    get(in, offsetof(StateScalars, seed), world.seed);
+
+    // a no-op but for a world that never had its pools reserved
+    world.bullets.reserve(bulletCapacity);
+    world.asteroids.reserve(asteroidCapacity);
+    world.bullets.restore_state(in + sizeof(StateScalars));
+    world.asteroids.restore_state(in + asteroidOffset);
+}
+
+void StateArena::copy(int from, int to) {
+    if (from != to) memcpy(at(to), at(from), stride);
+}
+
+void step_state(StateArena& arena, int from, int to, World& scratch, const uint8_t* inputs, int ticks) {
+    arena.restore(from, scratch);
+    for (int t = 0; t < ticks && !scratch.gameOver && !scratch.gameWon; t++) {
+        simulate_tick(scratch, inputs);
+    }
+    arena.save(scratch, to);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Game.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//
+//  Flat copies of a world's simulation state, for lookahead and rollback.
+//
+//  A StateArena holds a fixed number of states in one block that reserve()
+//  allocates. Every state has the same plain layout: the world's scalars
+//  and ships, then each archetype's slot table and columns at offsets that
+//  depend only on the pool capacities. save() and restore() copy between a
+//  world and a state without allocating; copy() duplicates a state with a
+//  single memcpy, so a search can branch a state as often as it likes.
+//
+//  A state is what step_world() carries from one call to the next. The
+//  world's effects (particles) and the scratch space of the tick passes are
+//  not part of it: restoring leaves the world's particles as they are.
+//
+
+class StateArena {
+public:
+    StateArena() : states(0), stride(0), bulletCapacity(0), asteroidCapacity(0), asteroidOffset(0) {}
+
+    // Room for count states of worlds with these pool capacities
+    void reserve(int count, int bullets = MAX_BULLETS, int asteroids = MAX_ASTEROIDS);
+
+    int count() const { return states; }
+    size_t state_bytes() const { return stride; }
+
+    // The world's pools must have the arena's capacities; reset_world()
+    // gives every world the default ones, and restore() reserves them in a
+    // world whose pools were never reserved
+    void save(const World& world, int state);
+    void restore(int state, World& world) const;
+
+    void copy(int from, int to);
+
+private:
+    uint8_t* at(int state) { return block.data() + (size_t)state * stride; }
+    const uint8_t* at(int state) const { return block.data() + (size_t)state * stride; }
+
+    int states;
+    size_t stride;
+    int bulletCapacity, asteroidCapacity;
+    size_t asteroidOffset; // bullets start right after the scalars
+    std::vector<uint8_t> block;
+};
+
+// Advances state from by ticks fixed ticks of act() logic, all with the
+// same input per ship, into state to (which may be from). Runs in scratch,
+// a world reset_world() has prepared; neither the engine's input nor the
+// frame is touched. Stops early once the game is over or won.
+void step_state(StateArena& arena, int from, int to, World& scratch, const uint8_t* inputs, int ticks);